@@ -43,7 +43,7 @@ copy_vector:
    lda interrupt_vectors, x
    sta NMI_VECTOR, x
    inx
-   cpx #$0C
+   cpx #$0E
    bne copy_vector
 	
 	mwa #copy_params_charset COPY_PARAMS
@@ -64,6 +64,13 @@ copy_vector:
 	ora #VSTATUS_EN_INTS
 	sta VSTATUS
 	
+; a xex loaded by the emulator may set INITAD / RUNAD
+; only its first stage is in memory, the rest is loaded after each INITAD
+	jsr storage_load_xex_stages
+	lda RUNAD+1
+	beq no_run
+	jmp (RUNAD)
+no_run:
 	jmp BOOTADDR
 
 interrupt_vectors:
@@ -73,6 +80,7 @@ interrupt_vectors:
    .word vblank_os
    .word hblank_user
    .word vblank_user
+   .word storage_user
 
 nmi_os:
    cld
@@ -86,6 +94,28 @@ nmi_done:
    rti
 
 irq_os:
+   cld
+   pha
+   lda ST_IRQ_STATUS    ; reading the causes acknowledges the storage irq
+   beq irq_done
+   sta ST_IRQ_CAUSE
+   and #ST_IRQ_DONE
+   beq irq_user         ; only tagged commands completed
+   lda ST_ASYNC_STATUS
+   cmp #ST_STATUS_PROCESSING
+   beq irq_async
+   lda ST_IRQ_CAUSE     ; synchronous command, storage_proceed polls the status
+   and #ST_IRQ_COMPLETION
+   beq irq_done         ; the user vector only sees its own commands
+   bne irq_user
+irq_async:
+   lda ST_STATUS
+   lda #ST_STATUS_DONE
+   sta ST_ASYNC_STATUS
+irq_user:
+   jsr call_storage_user
+irq_done:
+   pla
    rti
 
 hblank_os:
@@ -116,12 +146,18 @@ vblank_user:
 
 hblank_user:
    rts   
-   
+
+storage_user:
+   rts
+
 call_vblank_user:
    jmp (VBLANK_VECTOR_USER)
 
 call_hblank_user:
    jmp (HBLANK_VECTOR_USER)
+
+call_storage_user:
+   jmp (STORAGE_VECTOR_USER)
     
 set_video_mode:
    pha
@@ -161,6 +197,12 @@ os_vector_table
 	.word storage_file_read_byte
 	.word storage_file_read_block
 	.word storage_file_close
+	.word storage_wait
+	.word storage_file_read_sector_async
+	.word storage_file_read_sector_end
+	.word storage_file_read_sector_submit
+	.word storage_completion
+	.word storage_load_xex
 
 copy_params_charset:
 	.word charset, VRAM_CHARSET, CHARSET_SIZE
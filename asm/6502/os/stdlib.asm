@@ -58,6 +58,33 @@ eos:
    jmp OS_CALL
 .endp
 
+.proc file_read_sector_async
+   ldx #OS_FILE_READ_SECTOR_ASYNC
+   lda file_handle
+   jmp OS_CALL
+.endp
+
+.proc file_read_sector_submit
+   ldx #OS_FILE_READ_SECTOR_SUBMIT
+   lda file_handle
+   jmp OS_CALL
+.endp
+
+.proc file_completion
+   ldx #OS_STORAGE_COMPLETION
+   jmp OS_CALL
+.endp
+
+.proc file_read_sector_end
+   ldx #OS_FILE_READ_SECTOR_END
+   jmp OS_CALL
+.endp
+
+.proc file_load_xex
+   ldx #OS_FILE_LOAD_XEX
+   jmp OS_CALL
+.endp
+
 .proc file_close
    lda file_handle
    ldx #OS_FILE_CLOSE
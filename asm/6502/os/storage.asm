@@ -276,6 +276,139 @@ no_more_bytes:
    rts
 .endp
 
+.proc storage_file_read_sector_async
+; Start reading one sector (256 bytes max) and return without waiting
+; in:  file_handle in A
+; Completion is signaled by the storage irq: ST_ASYNC_STATUS is set to
+; ST_STATUS_DONE and STORAGE_VECTOR_USER is called.
+; Then use storage_file_read_sector_end to get the data
+; The irq stays enabled, synchronous commands completed later do not
+; call STORAGE_VECTOR_USER
+
+   tax
+   lda #ST_CMD_READ_BLOCK
+   jsr storage_write
+   txa
+   jsr storage_write
+   jmp storage_proceed_async
+.endp
+
+.proc storage_file_read_sector_submit
+; Queue the read of one sector (256 bytes max) as a tagged command
+; in:  file_handle in A
+; in:  tag in Y
+; Several commands can be queued, the storage irq is triggered when any
+; of them completes. Use storage_completion to get the tag of a completed
+; command and then storage_file_read_sector_end to get the data
+; out: status in X, ST_ERR_QUEUE_FULL if the command was not queued
+
+   tax
+   lda #ST_CMD_READ_BLOCK
+   jsr storage_write
+   txa
+   jsr storage_write
+   tya
+   jmp storage_submit
+.endp
+
+.proc storage_file_read_sector_end
+; Get the result of storage_file_read_sector_async
+; in:  destination addr in DST_ADDR
+; out: bytes read at SIZE (0 = error or eof)
+; out: status in X
+
+   mwa #0 SIZE
+   jsr storage_read ; length of response. Ignored at this time
+   jsr storage_read
+   tax
+   cpx #ST_RET_SUCCESS
+   bne read_end
+   
+   jsr storage_read ; bytes read, 0 means a full sector
+   sta SIZE
+   bne @+
+   inc SIZE+1
+@:
+   ldy #0
+copy_sector:
+   jsr storage_read
+   sta (DST_ADDR), y
+   iny
+   cpy SIZE
+   bne copy_sector
+   ldx #ST_RET_SUCCESS
+read_end:
+   rts
+.endp
+
+.proc storage_load_xex
+; Load a xex file directly into memory
+; in:  filename at SRC_ADDR
+; out: status in X
+; The file is loaded in stages, the INITAD routine is called each time
+; a segment sets it, before the rest of the file is loaded.
+; The file RUNAD is left at RUNAD, 0 if not set
+
+   lda #0
+   sta RUNAD+1
+   sta INITAD+1
+   
+   lda #ST_CMD_LOAD_XEX
+   jsr storage_write
+   
+   ldy #0
+send_filename:   
+   lda (SRC_ADDR), y
+   beq @+ 
+   jsr storage_write
+   iny
+   bne send_filename
+@: 
+   lda #0
+   jsr storage_write
+
+   jsr storage_proceed   ; the first stage is already in memory when this returns
+   
+   jsr storage_read ; length of response. Ignored at this time
+   jsr storage_read ; result of the operation
+   tax
+   cpx #ST_RET_SUCCESS
+   bne load_end
+   jmp storage_load_xex_stages
+load_end:
+   rts
+.endp
+
+.proc storage_load_xex_stages
+; Call INITAD and load the next stage of a xex until no INITAD is set
+; Used after storage_load_xex and at boot for a xex loaded by the emulator
+; out: status in X
+
+   lda INITAD+1
+   beq load_done
+   jsr call_init
+   lda #0
+   sta INITAD+1
+   
+   lda #ST_CMD_LOAD_XEX_NEXT
+   jsr storage_write
+   jsr storage_proceed
+   jsr storage_read ; length of response. Ignored at this time
+   jsr storage_read ; result of the operation
+   tax
+   cpx #ST_RET_SUCCESS
+   beq storage_load_xex_stages
+   cpx #ST_ERR_EOF  ; the last segment was the one that set INITAD
+   bne load_end
+load_done:
+   ldx #ST_RET_SUCCESS
+load_end:
+   rts
+   
+call_init:
+   jmp (INITAD)
+.endp
+
 .proc storage_file_close
    tax
    lda #ST_CMD_CLOSE
@@ -318,3 +451,50 @@ no_more_bytes:
    bne @-
    rts
 .endp
+
+.proc storage_proceed_async
+; Proceed with command using the completion irq instead of polling
+   lda #ST_STATUS_PROCESSING
+   sta ST_ASYNC_STATUS
+   lda #ST_CONTROL_IRQ
+   sta ST_CONTROL
+   sta ST_PROCEED
+   cli
+   rts
+.endp
+
+.proc storage_submit
+; Queue the command written so far as a tagged command
+; in:  tag in A
+; out: status in X, ST_ERR_QUEUE_FULL if all the slots were busy
+;      and the command was dropped
+   sta ST_TAG
+   lda #ST_CONTROL_IRQ
+   sta ST_CONTROL
+   sta ST_SUBMIT
+   cli
+   ldx #ST_RET_SUCCESS
+   lda ST_SUBMIT
+   and #ST_SUBMIT_REJECTED
+   beq @+
+   ldx #ST_ERR_QUEUE_FULL
+@:
+   rts
+.endp
+
+.proc storage_completion
+; Get the oldest completed tagged command
+; out: tag in A or ST_NO_COMPLETION
+; The response of the command can then be read with storage_read
+   lda ST_COMPLETION
+   rts
+.endp
+
+.proc storage_wait
+; Wait for the completion of an async command
+@:
+   lda ST_ASYNC_STATUS
+   cmp #ST_STATUS_DONE
+   bne @-
+   rts
+.endp
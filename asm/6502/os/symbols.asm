@@ -15,6 +15,7 @@ HBLANK_VECTOR = $14
 VBLANK_VECTOR = $16
 HBLANK_VECTOR_USER = $18
 VBLANK_VECTOR_USER = $1A
+STORAGE_VECTOR_USER = $1C
 
 RAM_TO_VRAM   = $20 ; cpu address
 VRAM_TO_RAM   = $22 ; vram address / 2
@@ -54,6 +55,9 @@ ATTRIB_DEFAULT = $20E
 KEY_PRESSED   = $210
 KEY_META      = $211
 
+RUNAD         = $2E0
+INITAD        = $2E2
+
 ST_DIR_LENGTH = $300
 ST_DIR_INDEX  = $302
 ST_DIR_HANDLE = $304
@@ -62,6 +66,8 @@ ST_FILE_SIZE  = $306
 ST_FILE_DATE  = $30A
 ST_FILE_TIME  = $312
 ST_FILE_NAME  = $318  ; up to $388
+ST_ASYNC_STATUS = $398
+ST_IRQ_CAUSE    = $399
 
 KEY_META_LSHIFT = $20
 KEY_META_LCTRL  = $08
@@ -91,6 +97,12 @@ OS_FILE_OPEN         = $0b
 OS_FILE_READ_BYTE    = $0c
 OS_FILE_READ_BLOCK   = $0d
 OS_FILE_CLOSE        = $0e
+OS_STORAGE_WAIT      = $0f
+OS_FILE_READ_SECTOR_ASYNC = $10
+OS_FILE_READ_SECTOR_END   = $11
+OS_FILE_READ_SECTOR_SUBMIT = $12
+OS_STORAGE_COMPLETION     = $13
+OS_FILE_LOAD_XEX          = $14
 
 OS_CALL  = $F000
 
@@ -124,9 +136,55 @@ ST_READ_DATA    = $9084
 ST_WRITE_RESET  = $9085 
 ST_READ_RESET   = $9086
 ST_STATUS       = $9087
+ST_CONTROL      = $9088
+ST_TAG          = $9089
+ST_SUBMIT       = $908A
+ST_COMPLETION   = $908B
+ST_PENDING      = $908C
+ST_IRQ_STATUS   = $908D
 
 KEY_STATUS      = $9090 ; up to $909F
 
+HC_ARGS         = $9200
+HC_CALL         = $9202
+HC_STATUS       = $9203
+HC_CYCLES       = $9204
+
+HC_MEMCPY  = $01
+HC_MEMSET  = $02
+HC_MUL     = $03
+HC_DIV     = $04
+HC_FORMAT  = $05
+HC_INFLATE = $06
+
+HC_OK          = $00
+HC_ERR_SERVICE = $80
+HC_ERR_ARGS    = $81
+HC_ERR_DATA    = $82
+
+CPU_CLOCK       = $9210
+CPU_CLOCK_FLAGS = $9211
+CPU_CYCLES      = $9214
+
+CPU_CLOCK_VBLANK_UNLIMITED = $01
+
+Z80_CTL         = $9220
+Z80_WINDOW      = $9221
+Z80_MAILBOX     = $9300
+Z80_WINDOW_BASE = $9400
+
+Z80_CTL_RUN = $01
+Z80_CTL_IRQ = $02
+Z80_CTL_NMI = $04
+
+MMU_BANK_LO = $9230
+MMU_BANK_HI = $9238
+MMU_BANKS   = $9240
+
+PROF_BEGIN = $9250
+PROF_END   = $9251
+PROF_RESET = $9252
+
 ST_CMD_OPEN       = $01
 ST_CMD_CLOSE      = $02
 ST_CMD_READ_BYTE  = $03
@@ -134,6 +192,8 @@ ST_CMD_READ_BLOCK = $04
 ST_CMD_DIR_OPEN   = $05
 ST_CMD_DIR_READ   = $06
 ST_CMD_DIR_CLOSE  = $07
+ST_CMD_LOAD_XEX   = $08
+ST_CMD_LOAD_XEX_NEXT = $09
 
 ST_RET_SUCCESS             = $00
 ST_ERR_INVALID_OPERATION   = $80
@@ -142,11 +202,21 @@ ST_ERR_EOF                 = $82
 ST_ERR_IO                  = $83
 ST_ERR_TOO_MANY_OPEN_FILES = $84
 ST_ERR_INVALID_FILE        = $85
+ST_ERR_INVALID_FORMAT      = $86
+ST_ERR_QUEUE_FULL          = $87
 
 ST_STATUS_IDLE       = $00
 ST_STATUS_PROCESSING = $01
 ST_STATUS_DONE       = $FF
 
+ST_CONTROL_IRQ = $01
+
+ST_IRQ_DONE       = $01
+ST_IRQ_COMPLETION = $02
+
+ST_NO_COMPLETION = $FF
+ST_SUBMIT_REJECTED = $80
+
 ST_MODE_READ  = $00
 ST_MODE_WRITE = $01
 
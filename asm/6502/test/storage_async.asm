@@ -0,0 +1,75 @@
+	icl '../os/symbols.asm'
+
+; this test reads a file using the storage completion irq
+; the border color keeps changing while each sector is being read
+
+	org BOOTADDR
+
+	lda #0
+   ldx #OS_SET_VIDEO_MODE
+   jsr OS_CALL
+
+   sta ST_WRITE_RESET
+
+   mwa DISPLAY_START VRAM_TO_RAM
+   jsr lib_vram_to_ram
+
+; Call command to open file
+   mwa #filename SRC_ADDR
+   jsr file_open_read
+   cmp #$FF
+   beq end
+
+read_next_sector:
+   jsr file_read_sector_async
+
+wait_sector:
+   inc VCOLOR0              ; keep doing something while the sector is read
+   lda ST_ASYNC_STATUS
+   cmp #ST_STATUS_DONE
+   bne wait_sector
+
+   mwa #buffer DST_ADDR
+   jsr file_read_sector_end
+   cpx #ST_RET_SUCCESS
+   bne eof
+
+   ldy #0
+copy_sector
+   lda buffer, y
+   cmp #32
+   bcc skip
+   jsr screen_putc
+skip:
+   iny
+   cpy SIZE
+   bne copy_sector
+   lda SIZE+1
+   bne read_next_sector     ; full sector read, there may be more
+
+eof:
+   jsr file_close
+
+end:
+   jmp end
+
+
+.proc screen_putc
+   sty R0
+   ldy #0
+   sta (RAM_TO_VRAM), y
+   inw RAM_TO_VRAM
+   ldy R0
+   rts
+.endp
+
+
+buffer:
+   .rept 256
+   .byte 0
+   .endr
+
+filename:
+   .by "../asm/6502/test/storage_async.asm", 0
+
+   icl '../os/stdlib.asm'
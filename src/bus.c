@@ -5,7 +5,14 @@
 #include "video/chroni.h"
 #include "sound.h"
 #include "keyb.h"
+#include "hypercall.h"
+#include "coproc.h"
+#include "mmu.h"
+#include "profile.h"
 #include "bus.h"
+#include "cpu.h"
+#include "cpuexec.h"
+#include "watch.h"
 
 /*
  * system memory map
@@ -19,6 +26,16 @@
  *   E000 - FFFF : OS ROM (8KB)
  *
  *   9000 - 907F : Chroni registers
+ *   9080 - 908F : Storage registers
+ *   9090 - 909F : Keyboard registers
+ *   9100 - 911F : Pokey registers
+ *   9200 - 920F : Hypercall registers
+ *   9210 - 921F : CPU clock registers
+ *   9220 - 922F : Z80 coprocessor registers
+ *   9230 - 924F : MMU registers, banks of extended RAM at 1000 - 8FFF
+ *   9250 - 925F : Profile marker registers
+ *   9300 - 93FF : Z80 mailbox, shared RAM
+ *   9400 - 97FF : Z80 RAM window (1KB)
  *
  */
 
@@ -28,42 +45,156 @@
 #endif
 #include "trace.h"
 
-UINT8 bus_read16(UINT16 addr) {
-	UINT8 retvalue = 0;
-	if (addr >= CHRONI_START && addr <= CHRONI_END) {
-		retvalue = chroni_register_read(addr - CHRONI_START);
-	} else if (addr >= CHRONI_MEM_START && addr <= CHRONI_MEM_END) {
+/*
+ * registers at 9000 - 97FF, dispatched by page and then by range inside the page.
+ * Addresses not used by any device are plain memory
+ */
+static UINT8 io_read(UINT16 addr) {
+	switch(addr >> 8) {
+	case CHRONI_START >> 8:
+		if (addr <= CHRONI_END)  return chroni_register_read(addr - CHRONI_START);
+		if (addr <= STORAGE_END) return storage_register_read(addr - STORAGE_START);
+		if (addr <= KEYB_END)    return keyb_register_read(addr - KEYB_START);
+		break;
+	case HYPERCALL_START >> 8:
+		if (addr <= HYPERCALL_END) return hypercall_register_read(addr - HYPERCALL_START);
+		if (addr <= CPUCLOCK_END)  return cpuexec_register_read(addr - CPUCLOCK_START);
+		if (addr <= Z80_END)       return coproc_register_read(addr - Z80_START);
+		if (addr <= MMU_END)       return mmu_register_read(addr - MMU_START);
+		if (addr <= PROFILE_END)   return profile_register_read(addr - PROFILE_START);
+		break;
+	case Z80_MAILBOX_START >> 8:
+		return coproc_mailbox_read(addr - Z80_MAILBOX_START);
+	default:
+		if (addr >= Z80_WINDOW_START && addr <= Z80_WINDOW_END) return coproc_window_read(addr - Z80_WINDOW_START);
+		break;
+	}
+	return *MEM_PTR(addr);
+}
+
+static void io_write(UINT16 addr, UINT8 value) {
+	switch(addr >> 8) {
+	case CHRONI_START >> 8:
+		if (addr <= CHRONI_END)  chroni_register_write(addr - CHRONI_START, value);
+		else if (addr <= STORAGE_END) storage_register_write(addr - STORAGE_START, value);
+		else *MEM_PTR(addr) = value;
+		break;
+	case SOUND_POKEY_START >> 8:
+		if (addr <= SOUND_POKEY_END) sound_register_write(addr - SOUND_POKEY_START, value);
+		else *MEM_PTR(addr) = value;
+		break;
+	case HYPERCALL_START >> 8:
+		if (addr <= HYPERCALL_END)     hypercall_register_write(addr - HYPERCALL_START, value);
+		else if (addr <= CPUCLOCK_END) cpuexec_register_write(addr - CPUCLOCK_START, value);
+		else if (addr <= Z80_END)      coproc_register_write(addr - Z80_START, value);
+		else if (addr <= MMU_END)      mmu_register_write(addr - MMU_START, value);
+		else if (addr <= PROFILE_END)  profile_register_write(addr - PROFILE_START, value);
+		else *MEM_PTR(addr) = value;
+		break;
+	case Z80_MAILBOX_START >> 8:
+		coproc_mailbox_write(addr - Z80_MAILBOX_START, value);
+		break;
+	default:
+		if (addr >= Z80_WINDOW_START && addr <= Z80_WINDOW_END) coproc_window_write(addr - Z80_WINDOW_START, value);
+		else *MEM_PTR(addr) = value;
+		break;
+	}
+}
+
+/* plain memory is checked first, it is most of the accesses */
+UINT8 bus_peek16(UINT16 addr) {
+	UINT8 retvalue;
+	if (addr < CHRONI_START || addr > CHRONI_MEM_END) {
+		retvalue = *MEM_PTR(addr);
+	} else if (addr >= CHRONI_MEM_START) {
 		retvalue = chroni_vram_read(addr - CHRONI_MEM_START);
-	} else if (addr >= STORAGE_START && addr <= STORAGE_END) {
-		retvalue = storage_register_read(addr - STORAGE_START);
-	} else if (addr >= KEYB_START && addr <= KEYB_END) {
-		retvalue = keyb_register_read(addr - KEYB_START);
 	} else {
-		retvalue = mem_readmem16(addr);
+		retvalue = io_read(addr);
 	}
 	LOGV(LOGTAG, "bus read %04X = %02X", addr, retvalue);
 	return retvalue;
 }
+
+/* data accesses check the watchpoint flags of the page, opcode fetches use bus_peek16 */
+UINT8 bus_read16(UINT16 addr) {
+	UINT8 retvalue = bus_peek16(addr);
+	if (watch_pages[addr >> 8] & (WATCH_READ | WATCH_TRACE | WATCH_COVERAGE)) {
+		watch_read(addr, retvalue);
+	}
+	return retvalue;
+}
+
 void  bus_write16(UINT16 addr, UINT8 value) {
 	if (addr <0xA000 || addr >= 0xD000) {
 		LOGV(LOGTAG, "bus write %04X = %02X", addr, value);
 	}
-	if (addr >= CHRONI_START && addr <= CHRONI_END) {
-		chroni_register_write(addr - CHRONI_START, value);
-	} else if (addr >= CHRONI_MEM_START && addr <= CHRONI_MEM_END) {
+	UINT8 page_flags = watch_pages[addr >> 8];
+	if (page_flags & (WATCH_WRITE | WATCH_CHANGE | WATCH_TRACE | WATCH_COVERAGE)) {
+		watch_write(addr, value);
+	}
+	if (page_flags & WATCH_CODE) {
+		cpu_code_write(addr, 1);
+	}
+	if (addr < CHRONI_START || addr > CHRONI_MEM_END) {
+		*MEM_PTR(addr) = value;
+	} else if (addr >= CHRONI_MEM_START) {
 		chroni_vram_write(addr - CHRONI_MEM_START, value);
-	} else if (addr >= STORAGE_START && addr <= STORAGE_END) {
-		storage_register_write(addr - STORAGE_START, value);
-	} else if (addr >= SOUND_POKEY_START && addr <= SOUND_POKEY_END) {
-		sound_register_write(addr - SOUND_POKEY_START, value);
 	} else {
-		mem_writemem16(addr, value);
+		io_write(addr, value);
 	}
 }
 
-void  bus_write(UINT16 addr, UINT8 *values, UINT16 size) {
-	for(int i=0; i<size && addr+i < 0x10000; i++) {
-		bus_write16(addr+i, values[i]);
+/* address ranges that are not plain memory on writes */
+static const struct {
+	UINT16 start;
+	UINT16 end;
+} write_devices[] = {
+	{CHRONI_START,      STORAGE_END},
+	{SOUND_POKEY_START, SOUND_POKEY_END},
+	{HYPERCALL_START,   PROFILE_END},
+	{Z80_MAILBOX_START, Z80_WINDOW_END},
+	{CHRONI_MEM_START,  CHRONI_MEM_END}
+};
+
+#define WRITE_DEVICES (sizeof(write_devices) / sizeof(write_devices[0]))
+
+/*
+ * bulk write, used by loaders
+ * plain memory is copied in runs, only device ranges go through bus_write16
+ */
+void  bus_write(UINT16 addr, UINT8 *values, UINT32 size) {
+	UINT32 start = addr;
+	UINT32 end   = start + size;
+	if (end > 0x10000) end = 0x10000;
+
+	while (start < end) {
+		UINT32 run_end = end;
+		bool is_device = FALSE;
+		for(int i=0; i<WRITE_DEVICES; i++) {
+			if (start >= write_devices[i].start && start <= write_devices[i].end) {
+				is_device = TRUE;
+				run_end = write_devices[i].end + 1;
+				break;
+			}
+			if (write_devices[i].start > start && write_devices[i].start < run_end) {
+				run_end = write_devices[i].start;
+			}
+		}
+		if (run_end > end) run_end = end;
+
+		if (is_device) {
+			for(UINT32 a = start; a < run_end; a++) {
+				bus_write16(a, values[a - addr]);
+			}
+		} else {
+			mem_write(start, values + (start - addr), run_end - start);
+			for(UINT32 page = start >> 8; page <= (run_end - 1) >> 8; page++) {
+				if (watch_pages[page] & WATCH_CODE) {
+					cpu_code_write(start, run_end - start);
+					break;
+				}
+			}
+		}
+		start = run_end;
 	}
 }
-
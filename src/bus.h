@@ -5,7 +5,7 @@
 #define CHRONI_END    0x907F
 
 #define STORAGE_START 0x9080
-#define STORAGE_END   0x9087
+#define STORAGE_END   0x908F
 
 #define KEYB_START    0x9090
 #define KEYB_END      0x909F
@@ -13,11 +13,33 @@
 #define SOUND_POKEY_START 0x9100
 #define SOUND_POKEY_END   0x911F
 
+#define HYPERCALL_START 0x9200
+#define HYPERCALL_END   0x920F
+
+#define CPUCLOCK_START  0x9210
+#define CPUCLOCK_END    0x921F
+
+#define Z80_START       0x9220
+#define Z80_END         0x922F
+
+#define MMU_START       0x9230
+#define MMU_END         0x924F
+
+#define PROFILE_START   0x9250
+#define PROFILE_END     0x925F
+
+#define Z80_MAILBOX_START 0x9300
+#define Z80_MAILBOX_END   0x93FF
+
+#define Z80_WINDOW_START  0x9400
+#define Z80_WINDOW_END    0x97FF
+
 #define CHRONI_MEM_START 0xA000
 #define CHRONI_MEM_END   0xDFFF
 
 UINT8 bus_read16(UINT16 addr);
+UINT8 bus_peek16(UINT16 addr);
 void  bus_write16(UINT16 addr, UINT8 value);
-void  bus_write(UINT16 addr, UINT8 *values, UINT16 size);
+void  bus_write(UINT16 addr, UINT8 *values, UINT32 size);
 
 #endif
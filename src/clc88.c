@@ -11,8 +11,19 @@
 #include "video/screen.h"
 #include "utils.h"
 #include "monitor.h"
+#include "symbols.h"
 #include "video/chroni.h"
 #include "sound.h"
+#include "sound/sound_interface.h"
+#include "xex.h"
+#include "os_rom.h"
+#include "cputrace.h"
+#include "coverage.h"
+#include "hle.h"
+#include "timer.h"
+#include "coproc.h"
+#include "mmu.h"
+#include "profile.h"
 
 #define LOGTAG "COMPY"
 #ifdef TRACE_COMPY
@@ -22,12 +33,35 @@
 
 static bool arg_monitor_enabled = FALSE;
 static bool arg_monitor_stop_on_xex = FALSE;
+static bool arg_blocks = TRUE;
+static bool arg_aot = TRUE;
+static enum CpuType arg_cpu = CPU_M6502;
+static int  arg_turbo = 1;
+static UINT8 arg_turbo_flags = 0;
 static char xexfile[1000] = "";
+static char osfile[1000] = "";
 
 static void emulator_init(int argc, char *argv[]) {
 	for(int i=1; i<argc; i++) {
 		if (!strcmp(argv[i], "-M")) arg_monitor_enabled = TRUE;
 		else if (!strcmp(argv[i], "-m")) arg_monitor_stop_on_xex = TRUE;
+		else if (!strcmp(argv[i], "-noblocks")) arg_blocks = FALSE;
+		else if (!strcmp(argv[i], "-noaot")) arg_aot = FALSE;
+		else if (!strcmp(argv[i], "-os") && i+1<argc) strcpy(osfile, argv[++i]);
+		else if (!strcmp(argv[i], "-cpu") && i+1<argc) {
+			i++;
+			if (!strcmp(argv[i], "65c02")) arg_cpu = CPU_M65C02;
+			else if (!strcmp(argv[i], "65ce02")) arg_cpu = CPU_M65CE02;
+			else if (!strcmp(argv[i], "4510")) arg_cpu = CPU_M4510;
+			else if (strcmp(argv[i], "6502")) fprintf(stderr, "unknown cpu %s, using 6502\n", argv[i]);
+		}
+		else if (!strcmp(argv[i], "-turbo") && i+1<argc) {
+			i++;
+			if (!strcmp(argv[i], "vblank")) arg_turbo_flags |= CPUCLOCK_VBLANK_UNLIMITED;
+			else arg_turbo = atoi(argv[i]);
+		}
+		else if (!strcmp(argv[i], "-ramdisk") || !strcmp(argv[i], "-trace-bus")
+				|| !strcmp(argv[i], "-exact")) continue;
 		else if (argv[i][0] == '-') i++;
 		else {
 			strcpy(xexfile, argv[i]);
@@ -43,24 +77,66 @@ static void emulator_load(char *filename) {
 	monitor_source_read_file(buffer);
 }
 
-static void scan_callback(unsigned scanline) {
-	if ((scanline % 48) == 0) {
-		sound_process();
+/*
+ * the OS is embedded in the emulator, "-os file" loads it from a xex instead
+ * its listing is only read if the monitor is used
+ */
+static void emulator_load_os() {
+	xex_file *xex;
+	if (strlen(osfile) > 0) {
+		xex = xex_read(osfile);
+	} else {
+		UINT8 *data = malloc(os_rom_size);
+		memcpy(data, os_rom, os_rom_size);
+		xex = xex_parse(data, os_rom_size);
 	}
+	if (xex) {
+		xex_load(xex);
+		xex_free(xex);
+	}
+	monitor_source_read_file("../asm/6502/os/6502os.lst");
+}
+
+/* sound registers are sampled 5 times per frame, see sound.c */
+#define SOUND_PROCESS_TICKS (CHRONI_FRAME_TICKS / 5)
+
+static void storage_timer_callback(int param) {
+	storage_update();
+}
+
+static void sound_timer_callback(int param) {
+	sound_process();
+}
+
+static void timers_init() {
+	timer_init();
+
+	timer *storage_timer = timer_alloc(storage_timer_callback, 0);
+	timer_adjust(storage_timer, CHRONI_SCANLINE_TICKS, CHRONI_SCANLINE_TICKS);
+
+	timer *sound_timer = timer_alloc(sound_timer_callback, 0);
+	timer_adjust(sound_timer, SOUND_PROCESS_TICKS, SOUND_PROCESS_TICKS);
+	sound_set_update_timer(sound_timer);
 }
 
 void compy_init(int argc, char *argv[]) {
 
+	trace_init(argc, argv);
 	emulator_init(argc, argv);
 
 	screen_init();
 	storage_init(argc, argv);
+	cputrace_init(argc, argv);
+	coverage_init(argc, argv);
+	hle_init(argc, argv);
+	profile_init(argc, argv);
 	machine_init();
 	sound_init();
 
+	symbols_init();
 	monitor_source_init();
 
-	emulator_load("../asm/6502/os/6502os");
+	emulator_load_os();
 	//utils_load_xex("../asm/test/test_sprites.xex");
 	//utils_load_xex("../asm/test/test_atari.xex");
 	//utils_load_xex("../asm/test/test_spectrum.xex");
@@ -68,10 +144,13 @@ void compy_init(int argc, char *argv[]) {
 	if (strlen(xexfile) > 0) {
 		emulator_load(xexfile);
 	}
+	hle_setup();
 
 	v_cpu *cpu;
 
-	cpu = cpu_init(CPU_M6502);
+	cpu = cpu_init(arg_cpu);
+	cpu_set_blocks(arg_blocks);
+	cpu_set_aot(arg_aot);
 	monitor_init(cpu);
 	if (arg_monitor_enabled) {
 		monitor_enable();
@@ -81,11 +160,13 @@ void compy_init(int argc, char *argv[]) {
 		monitor_breakpoint_set(0x2000);
 	}
 
+	timers_init();
 	cpuexec_init(cpu);
+	cpuexec_set_clock(arg_turbo, arg_turbo_flags);
+	coproc_init(argc, argv);
+	mmu_init(argc, argv);
 
 	chroni_init();
-
-	chroni_set_scan_callback(scan_callback);
 }
 
 void compy_run() {
@@ -94,6 +175,10 @@ void compy_run() {
 }
 
 void compy_done() {
+	coverage_done();
+	profile_done();
+	cputrace_done();
 	storage_done();
 	sound_done();
+	trace_done();
 }
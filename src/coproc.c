@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emu.h"
+#include "bus.h"
+#include "cpu.h"
+#include "cpu/cpu_interface.h"
+#include "coproc.h"
+
+#define LOGTAG "COPROC"
+#ifdef TRACE_COPROC
+#define TRACE
+#endif
+#include "trace.h"
+
+#define reg_ctl    0x00
+#define reg_window 0x01
+
+#define CTL_RUN 0x01
+#define CTL_IRQ 0x02
+#define CTL_NMI 0x04
+
+#define Z80_RAM_SIZE      0x8000
+#define Z80_MAILBOX_ADDR  0x8000
+#define Z80_MAILBOX_SIZE  0x100
+#define Z80_WINDOW_SIZE   (Z80_WINDOW_END - Z80_WINDOW_START + 1)
+
+/* Chroni WSYNC halts the main CPU, it is not a port of the Z80 */
+#define CHRONI_WSYNC      (CHRONI_START + 0x08)
+
+static v_cpu *z80;
+static UINT8 z80_ram[Z80_RAM_SIZE];
+static UINT8 mailbox[Z80_MAILBOX_SIZE];
+static UINT8 ctl;
+static UINT8 window;
+
+static int clock = 1;
+static int slice = 64;
+static int ticks_acum;
+static int cycles_stolen;
+
+static void coproc_set_ctl(UINT8 value) {
+	UINT8 old = ctl;
+	ctl = value & (CTL_RUN | CTL_IRQ | CTL_NMI);
+
+	/* the lines are set again after a reset */
+	if ((ctl & CTL_RUN) && !(old & CTL_RUN)) {
+		LOGV(LOGTAG, "z80 start");
+		z80->reset();
+		ticks_acum = 0;
+		cycles_stolen = 0;
+		old &= ~(CTL_IRQ | CTL_NMI);
+	}
+	if ((ctl ^ old) & CTL_IRQ) z80->irq(ctl & CTL_IRQ ? ASSERT_LINE : CLEAR_LINE);
+	if ((ctl ^ old) & CTL_NMI) z80->nmi(ctl & CTL_NMI ? ASSERT_LINE : CLEAR_LINE);
+}
+
+static void coproc_load(const char *filename) {
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		fprintf(stderr, "cannot open z80 file %s\n", filename);
+		return;
+	}
+	size_t size = fread(z80_ram, 1, sizeof(z80_ram), f);
+	fclose(f);
+	if (!size) {
+		fprintf(stderr, "empty z80 file %s\n", filename);
+		return;
+	}
+	LOGV(LOGTAG, "loaded %s, %d bytes", filename, (int)size);
+	coproc_set_ctl(CTL_RUN);
+}
+
+void coproc_init(int argc, char *argv[]) {
+	z80 = cpu_coproc_init(CPU_Z80);
+	ctl = 0;
+	window = 0;
+
+	for(int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "-z80-clock") && i<argc-1) {
+			clock = atoi(argv[++i]);
+			if (clock < 1) clock = 1;
+		} else if (!strcmp(argv[i], "-z80-slice") && i<argc-1) {
+			slice = atoi(argv[++i]);
+			if (slice < 1) slice = 1;
+		} else if (!strcmp(argv[i], "-z80") && i<argc-1) {
+			coproc_load(argv[++i]);
+		}
+	}
+}
+
+void coproc_run(int ticks) {
+	if (!(ctl & CTL_RUN)) return;
+
+	ticks_acum += ticks;
+	if (ticks_acum < slice) return;
+
+	int cycles_to_run = ticks_acum * clock - cycles_stolen;
+	ticks_acum = 0;
+	if (cycles_to_run <= 0) {
+		cycles_stolen = -cycles_to_run;
+		return;
+	}
+
+	/* devices that take cycles charge the Z80 while it runs */
+	v_cpu *main_cpu = cpu_set_active(z80);
+	int cycles_ran = z80->run(cycles_to_run);
+	cpu_set_active(main_cpu);
+
+	cycles_stolen = cycles_ran - cycles_to_run;
+}
+
+void coproc_register_write(UINT8 index, UINT8 value) {
+	switch(index) {
+	case reg_ctl:
+		coproc_set_ctl(value);
+		break;
+	case reg_window:
+		window = value & (Z80_RAM_SIZE / Z80_WINDOW_SIZE - 1);
+		break;
+	}
+}
+
+UINT8 coproc_register_read(UINT8 index) {
+	switch(index) {
+	case reg_ctl:
+		return ctl;
+	case reg_window:
+		return window;
+	}
+	return 0;
+}
+
+void coproc_mailbox_write(UINT8 index, UINT8 value) {
+	mailbox[index] = value;
+}
+
+UINT8 coproc_mailbox_read(UINT8 index) {
+	return mailbox[index];
+}
+
+void coproc_window_write(UINT16 offset, UINT8 value) {
+	z80_ram[window * Z80_WINDOW_SIZE + offset] = value;
+}
+
+UINT8 coproc_window_read(UINT16 offset) {
+	return z80_ram[window * Z80_WINDOW_SIZE + offset];
+}
+
+UINT8 coproc_readop(UINT16 pc) {
+	return coproc_readmem(pc);
+}
+
+UINT8 coproc_readmem(UINT16 addr) {
+	if (addr < Z80_RAM_SIZE) return z80_ram[addr];
+	if (addr - Z80_MAILBOX_ADDR < Z80_MAILBOX_SIZE) return mailbox[addr - Z80_MAILBOX_ADDR];
+	return 0xFF;
+}
+
+/* the main CPU may be polling the mailbox */
+void coproc_writemem(UINT16 addr, UINT8 value) {
+	if (addr < Z80_RAM_SIZE) {
+		z80_ram[addr] = value;
+	} else if (addr - Z80_MAILBOX_ADDR < Z80_MAILBOX_SIZE) {
+		mailbox[addr - Z80_MAILBOX_ADDR] = value;
+		cpu_wake();
+	}
+}
+
+/* device registers that are safe for a second bus master, the CPU clock belongs to the main CPU */
+static bool is_device_port(UINT16 port) {
+	return port >= CHRONI_START && port <= HYPERCALL_END && port != CHRONI_WSYNC;
+}
+
+UINT8 coproc_readport(UINT16 port) {
+	if (is_device_port(port)) return bus_read16(port);
+	if (port == Z80_START + reg_ctl) return ctl;
+	return 0xFF;
+}
+
+void coproc_writeport(UINT16 port, UINT8 value) {
+	if (is_device_port(port)) {
+		bus_write16(port, value);
+		cpu_wake();
+	} else if (port == Z80_START + reg_ctl) {
+		coproc_set_ctl(ctl & ~CTL_IRQ);
+	}
+}
+
+/* cpu_pc belongs to the main CPU */
+void coproc_change_pc(UINT16 pc) {
+}
@@ -0,0 +1,58 @@
+#ifndef _COPROC_H
+#define _COPROC_H
+
+/*
+ * Z80 coprocessor
+ *
+ * The Z80 runs next to the main CPU, on its own address space:
+ *
+ *   0000 - 7FFF : Z80 RAM (32KB)
+ *   8000 - 80FF : Mailbox, the same RAM as Z80_MAILBOX_START on the main CPU
+ *   8100 - FFFF : unmapped, reads FF
+ *
+ * Z80 I/O ports:
+ *
+ *   CHRONI_START - HYPERCALL_END : device registers of the bus, except
+ *                                  Chroni WSYNC that halts the main CPU.
+ *                                  The CPU clock registers are not mapped
+ *   Z80_START                   : reads the control register, a write
+ *                                 clears the IRQ bit (acknowledge)
+ *
+ * Main CPU side, see bus.h and asm/6502/os/symbols.asm:
+ *
+ *   Z80_START + 0  Z80_CTL     bit 0 run, 0 holds the Z80 in reset and
+ *                              setting it starts the Z80 at 0000
+ *                              bit 1 IRQ line of the Z80 (mode 1, RST 38)
+ *                              bit 2 NMI line of the Z80
+ *   Z80_START + 1  Z80_WINDOW  1KB page of Z80 RAM seen at Z80_WINDOW_START
+ *
+ * The cycle scheduler runs the Z80 after the main CPU, each time slice
+ * master clock ticks have passed. Z80 writes to the mailbox and to the
+ * devices wake the main CPU from an idle loop.
+ *
+ * -z80 file         load a raw binary at 0000 and start the Z80
+ * -z80-clock n      Z80 cycles per master clock tick (default 1)
+ * -z80-slice n      master clock ticks between Z80 runs (default 64)
+ */
+
+void  coproc_init(int argc, char *argv[]);
+
+/* called by the cycle scheduler with the master clock ticks of each main CPU run */
+void  coproc_run(int ticks);
+
+void  coproc_register_write(UINT8 index, UINT8 value);
+UINT8 coproc_register_read(UINT8 index);
+void  coproc_mailbox_write(UINT8 index, UINT8 value);
+UINT8 coproc_mailbox_read(UINT8 index);
+void  coproc_window_write(UINT16 offset, UINT8 value);
+UINT8 coproc_window_read(UINT16 offset);
+
+/* the Z80 core, see cpu/z80/z80.c */
+UINT8 coproc_readop(UINT16 pc);
+UINT8 coproc_readmem(UINT16 addr);
+void  coproc_writemem(UINT16 addr, UINT8 value);
+UINT8 coproc_readport(UINT16 port);
+void  coproc_writeport(UINT16 port, UINT8 value);
+void  coproc_change_pc(UINT16 pc);
+
+#endif
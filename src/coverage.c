@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <string.h>
+#include "emu.h"
+#include "bus.h"
+#include "cpu.h"
+#include "video/chroni.h"
+#include "watch.h"
+#include "coverage.h"
+
+#define LOGTAG "COVERAGE"
+#ifdef TRACE_COVERAGE
+#define TRACE
+#endif
+#include "trace.h"
+
+bool  coverage_enabled = FALSE;
+UINT8 coverage_cpu[COVERAGE_CPU_SIZE];
+static UINT8 coverage_vram[COVERAGE_VRAM_SIZE];
+
+static char coverage_file[1000] = "";
+
+/* 6502 instruction sizes, from the addressing modes of the disassembler */
+const UINT8 coverage_opcode_size[256] = {
+	2, 2, 1, 1, 1, 2, 2, 1, 1, 2, 1, 1, 1, 3, 3, 1, /* 00 */
+	2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1, /* 10 */
+	3, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, /* 20 */
+	2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1, /* 30 */
+	1, 2, 1, 1, 1, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, /* 40 */
+	2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1, /* 50 */
+	1, 2, 1, 1, 1, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, /* 60 */
+	2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1, /* 70 */
+	1, 2, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 3, 3, 3, 1, /* 80 */
+	2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 1, 3, 1, 1, /* 90 */
+	2, 2, 2, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, /* A0 */
+	2, 2, 1, 1, 2, 2, 2, 1, 1, 3, 1, 1, 3, 3, 3, 1, /* B0 */
+	2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, /* C0 */
+	2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1, /* D0 */
+	2, 2, 1, 1, 2, 2, 2, 1, 1, 2, 1, 1, 3, 3, 3, 1, /* E0 */
+	2, 2, 1, 1, 1, 2, 2, 1, 1, 3, 1, 1, 1, 3, 3, 1, /* F0 */
+};
+
+/* 65C02 sizes, with the bit instructions of the disassembler table */
+const UINT8 coverage_opcode_size_65c02[256] = {
+	2, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 00 */
+	2, 2, 2, 1, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 10 */
+	3, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 20 */
+	2, 2, 2, 1, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 30 */
+	1, 2, 1, 1, 1, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 40 */
+	2, 2, 2, 1, 1, 2, 2, 2, 1, 3, 1, 1, 1, 3, 3, 3, /* 50 */
+	1, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 60 */
+	2, 2, 2, 1, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 70 */
+	2, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 80 */
+	2, 2, 2, 1, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 90 */
+	2, 2, 2, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* A0 */
+	2, 2, 2, 1, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* B0 */
+	2, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* C0 */
+	2, 2, 2, 1, 1, 2, 2, 2, 1, 3, 1, 1, 1, 3, 3, 3, /* D0 */
+	2, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* E0 */
+	2, 2, 2, 1, 1, 2, 2, 2, 1, 3, 1, 1, 1, 3, 3, 3, /* F0 */
+};
+
+/* 65CE02 sizes, AUG takes three operand bytes */
+const UINT8 coverage_opcode_size_65ce02[256] = {
+	2, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 00 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 10 */
+	3, 2, 3, 3, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 20 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 30 */
+	1, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 40 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 4, 3, 3, 3, /* 50 */
+	1, 2, 2, 3, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 60 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 70 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 2, 1, 3, 3, 3, 3, 3, /* 80 */
+	2, 2, 1, 3, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* 90 */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 3, 3, 3, 3, 3, /* A0 */
+	2, 2, 1, 3, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* B0 */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 3, 3, 3, 3, 3, /* C0 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* D0 */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 3, 3, 3, 3, 3, /* E0 */
+	2, 2, 2, 3, 3, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* F0 */
+};
+
+/* 4510 sizes, MAP instead of AUG */
+const UINT8 coverage_opcode_size_4510[256] = {
+	2, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 00 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 10 */
+	3, 2, 3, 3, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 20 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 30 */
+	1, 2, 1, 1, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 40 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 1, 3, 3, 3, /* 50 */
+	1, 2, 2, 3, 2, 2, 2, 2, 1, 2, 1, 1, 3, 3, 3, 3, /* 60 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* 70 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 2, 1, 3, 3, 3, 3, 3, /* 80 */
+	2, 2, 1, 3, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* 90 */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 3, 3, 3, 3, 3, /* A0 */
+	2, 2, 1, 3, 2, 2, 2, 2, 1, 3, 1, 3, 3, 3, 3, 3, /* B0 */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 3, 3, 3, 3, 3, /* C0 */
+	2, 2, 2, 3, 2, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* D0 */
+	2, 2, 2, 2, 2, 2, 2, 2, 1, 2, 1, 3, 3, 3, 3, 3, /* E0 */
+	2, 2, 2, 3, 3, 2, 2, 2, 1, 3, 1, 1, 3, 3, 3, 3, /* F0 */
+};
+
+/* sizes used by coverage_insn, set with the CPU type */
+const UINT8 *coverage_opcode_sizes = coverage_opcode_size;
+
+void coverage_set_opcode_sizes(const UINT8 *sizes) {
+	coverage_opcode_sizes = sizes;
+}
+
+void coverage_init(int argc, char *argv[]) {
+	for(int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "-coverage") && i<argc-1) {
+			strcpy(coverage_file, argv[++i]);
+		}
+	}
+	if (!strlen(coverage_file)) return;
+
+	memset(coverage_cpu,  0, sizeof(coverage_cpu));
+	memset(coverage_vram, 0, sizeof(coverage_vram));
+	coverage_enabled = TRUE;
+	watch_set_coverage(TRUE);
+}
+
+/* data accesses, VRAM window accesses are also marked at their VRAM address */
+void coverage_access(UINT16 addr, UINT8 access) {
+	coverage_cpu[addr] |= access;
+	if (addr >= CHRONI_MEM_START && addr <= CHRONI_MEM_END) {
+		coverage_vram[chroni_vram_address(addr - CHRONI_MEM_START)] |= access;
+	}
+}
+
+static void coverage_save(const char *filename) {
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		fprintf(stderr, "cannot create coverage file %s\n", filename);
+		return;
+	}
+
+	coverage_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, COVERAGE_MAGIC, sizeof(header.magic));
+	header.version   = COVERAGE_VERSION;
+	header.cpu_size  = COVERAGE_CPU_SIZE;
+	header.vram_size = COVERAGE_VRAM_SIZE;
+
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(coverage_cpu,  1, sizeof(coverage_cpu),  f);
+	fwrite(coverage_vram, 1, sizeof(coverage_vram), f);
+	fclose(f);
+
+	LOGV(LOGTAG, "coverage written to %s", filename);
+}
+
+void coverage_done() {
+	if (!coverage_enabled) return;
+
+	coverage_enabled = FALSE;
+	watch_set_coverage(FALSE);
+	coverage_save(coverage_file);
+}
@@ -0,0 +1,58 @@
+#ifndef _COVERAGE_H
+#define _COVERAGE_H
+
+/*
+ * Execution coverage and access map
+ *
+ * One flags byte per address of the CPU space and of VRAM. Opcode and
+ * operand bytes are marked by the CPU loop, data reads and writes by the
+ * bus through the watch page flags, so nothing runs while disabled.
+ *
+ * -coverage file   enable and write the map to file on exit
+ *
+ * The map can be annotated on a listing with tools/covlist
+ */
+
+#define COVERAGE_OPCODE  0x01
+#define COVERAGE_OPERAND 0x02
+#define COVERAGE_READ    0x04
+#define COVERAGE_WRITE   0x08
+
+#define COVERAGE_MAGIC   "CLC88COV"
+#define COVERAGE_VERSION 1
+
+#define COVERAGE_CPU_SIZE  0x10000
+#define COVERAGE_VRAM_SIZE 0x20000
+
+/* file header, followed by the CPU map and the VRAM map */
+typedef struct {
+	char   magic[8];
+	UINT32 version;
+	UINT32 cpu_size;
+	UINT32 vram_size;
+	UINT32 reserved;
+} coverage_header;
+
+extern bool  coverage_enabled;
+extern UINT8 coverage_cpu[COVERAGE_CPU_SIZE];
+extern const UINT8 coverage_opcode_size[256];
+extern const UINT8 coverage_opcode_size_65c02[256];
+extern const UINT8 coverage_opcode_size_65ce02[256];
+extern const UINT8 coverage_opcode_size_4510[256];
+extern const UINT8 *coverage_opcode_sizes;
+
+void coverage_set_opcode_sizes(const UINT8 *sizes);
+
+void coverage_init(int argc, char *argv[]);
+void coverage_done();
+
+void coverage_access(UINT16 addr, UINT8 access);
+
+static inline void coverage_insn(UINT16 pc, UINT8 op) {
+	coverage_cpu[pc] |= COVERAGE_OPCODE;
+	for(int i=1; i<coverage_opcode_sizes[op]; i++) {
+		coverage_cpu[(UINT16)(pc + i)] |= COVERAGE_OPERAND;
+	}
+}
+
+#endif
@@ -3,10 +3,15 @@
 #include "emu.h"
 #include "bus.h"
 #include "cpu/m6502/m6502.h"
+#include "cpu/m6502/m65ce02.h"
+#include "cpu/m6502/m4510.h"
 #include "cpu/z80/z80.h"
 #include "cpu/cpu_interface.h"
 #include "cpu.h"
 #include "monitor.h"
+#include "cputrace.h"
+#include "coverage.h"
+#include "coproc.h"
 
 #define LOGTAG "CPU"
 #ifdef TRACE_CPU
@@ -15,33 +20,101 @@
 #include "trace.h"
 
 UINT16 cpu_pc;
+bool cpu_instrumented = FALSE;
+
+/*
+ * Idle loops: the core reports a loop that only polls memory or device
+ * registers, cpuexec skips cycles until cpu_wake on the next event
+ * (interrupt lines, chroni status changes)
+ */
+bool   cpu_idle = FALSE;
+UINT64 cpu_idle_loops  = 0;
+UINT64 cpu_idle_cycles = 0;
 
 v_cpu v_6502;
+v_cpu v_65c02;
+v_cpu v_65ce02;
+v_cpu v_4510;
 v_cpu v_z80;
 
+static v_cpu *cpu_active = &v_6502;
+
 int cpu_6502_irq_callback(int irq_line);
 
 static v_cpu* cpu_6502_init() {
 	v_6502.exec_break = FALSE;
 	m6502_init();
 	m6502_set_irq_callback(cpu_6502_irq_callback);
+	cpu_update_hooks();
 	return &v_6502;
 }
 
+/* same core and interface, with the 65C02 opcode table */
+static v_cpu* cpu_65c02_init() {
+	v_65c02.exec_break = FALSE;
+	m65c02_init();
+	m6502_set_irq_callback(cpu_6502_irq_callback);
+	coverage_set_opcode_sizes(coverage_opcode_size_65c02);
+	cpu_update_hooks();
+	return &v_65c02;
+}
+
+/*
+ * The 65CE02 and the 4510 are separate cores with a single loop, without
+ * idle loop detection, native OS routines, translated code or cached blocks
+ */
+static v_cpu* cpu_65ce02_init() {
+	v_65ce02.exec_break = FALSE;
+	coverage_set_opcode_sizes(coverage_opcode_size_65ce02);
+	cpu_update_hooks();
+	return &v_65ce02;
+}
+
+static v_cpu* cpu_4510_init() {
+	v_4510.exec_break = FALSE;
+	m4510_init();
+	coverage_set_opcode_sizes(coverage_opcode_size_4510);
+	cpu_update_hooks();
+	return &v_4510;
+}
+
 static v_cpu* cpu_z80_init() {
+	v_z80.exec_break = FALSE;
 	z80_init();
 	return &v_z80;
 }
 
-v_cpu* cpu_init(enum CpuType cpuType) {
+static v_cpu* cpu_select(enum CpuType cpuType) {
 	switch (cpuType) {
 	case CPU_M6502:
 		return cpu_6502_init();
+	case CPU_M65C02:
+		return cpu_65c02_init();
+	case CPU_M65CE02:
+		return cpu_65ce02_init();
+	case CPU_M4510:
+		return cpu_4510_init();
 	default:
 		return cpu_z80_init();
 	}
 }
 
+v_cpu* cpu_init(enum CpuType cpuType) {
+	cpu_active = cpu_select(cpuType);
+	return cpu_active;
+}
+
+/* a second CPU, it only becomes the active one while it runs */
+v_cpu* cpu_coproc_init(enum CpuType cpuType) {
+	return cpu_select(cpuType);
+}
+
+v_cpu* cpu_set_active(v_cpu *cpu) {
+	v_cpu *prev = cpu_active;
+	cpu_active = cpu;
+	return prev;
+}
+
 static void cpu_6502_reset() {
 	m6502_reset(NULL);
 }
@@ -67,7 +140,7 @@ static void cpu_6502_set_reg(int regnum, unsigned val) {
 }
 
 static bool cpu_6502_is_ret_op(unsigned addr) {
-	UINT8 op = cpu_readop(cpu_pc);
+	UINT8 op = cpu_readop(addr);
 	return op == 0x60 || op == 0x40;
 }
 
@@ -88,14 +161,165 @@ static bool cpu_6502_is_ret_frame() {
 	return cpu_6502_frame == m6502_get_reg(M6502_S);
 }
 
+static void cpu_65c02_reset() {
+	m65c02_reset(NULL);
+}
+
+static void cpu_65c02_nmi(int do_interrupt) {
+	m65c02_set_irq_line(IRQ_LINE_NMI, do_interrupt);
+}
+
+static void cpu_65ce02_reset() {
+	m65ce02_reset(NULL);
+	m65ce02_set_irq_callback(cpu_6502_irq_callback);
+}
+
+static int cpu_65ce02_run(int cycles) {
+	return m65ce02_execute(cycles);
+}
+
+static void cpu_65ce02_irq(int do_interrupt) {
+	m65ce02_set_irq_line(0, do_interrupt);
+}
+
+static void cpu_65ce02_nmi(int do_interrupt) {
+	m65ce02_set_irq_line(IRQ_LINE_NMI, do_interrupt);
+}
+
+static unsigned cpu_65ce02_get_reg(int regnum) {
+	return m65ce02_get_reg(regnum);
+}
+
+static void cpu_65ce02_set_reg(int regnum, unsigned val) {
+	m65ce02_set_reg(regnum, val);
+}
+
+static unsigned cpu_65ce02_get_pc() {
+	return m65ce02_get_reg(M65CE02_PC);
+}
+
+static unsigned cpu_65ce02_disasm(unsigned addr, char *dst) {
+	return addr + Dasm65ce02(dst, addr);
+}
+
+/* RTN #n returns too */
+static bool cpu_65ce02_is_ret_op(unsigned addr) {
+	UINT8 op = cpu_readop(addr);
+	return op == 0x60 || op == 0x40 || op == 0x62;
+}
+
+/* the stack pointer is 16 bits when the E flag is clear */
+static UINT16 cpu_65ce02_frame;
+static void cpu_65ce02_set_ret_frame() {
+	cpu_65ce02_frame = cpu_active->get_reg(M65CE02_S);
+}
+
+static bool cpu_65ce02_is_ret_frame() {
+	return cpu_65ce02_frame == cpu_active->get_reg(M65CE02_S);
+}
+
+static int cpu_65ce02_get_cycles_left() {
+	return m65ce02_ICount;
+}
+
+static void cpu_4510_reset() {
+	m4510_reset(NULL);
+	m4510_set_irq_callback(cpu_6502_irq_callback);
+}
+
+static int cpu_4510_run(int cycles) {
+	return m4510_execute(cycles);
+}
+
+static void cpu_4510_irq(int do_interrupt) {
+	m4510_set_irq_line(0, do_interrupt);
+}
+
+static void cpu_4510_nmi(int do_interrupt) {
+	m4510_set_irq_line(IRQ_LINE_NMI, do_interrupt);
+}
+
+static unsigned cpu_4510_get_reg(int regnum) {
+	return m4510_get_reg(regnum);
+}
+
+static void cpu_4510_set_reg(int regnum, unsigned val) {
+	m4510_set_reg(regnum, val);
+}
+
+static unsigned cpu_4510_get_pc() {
+	return m4510_get_reg(M4510_PC);
+}
+
+static unsigned cpu_4510_disasm(unsigned addr, char *dst) {
+	return addr + Dasm4510(dst, addr);
+}
+
+static int cpu_4510_get_cycles_left() {
+	return m4510_ICount;
+}
+
+static int cpu_z80_irq_callback(int irq_line) {
+	return 0xFF;
+}
+
+/* the reset clears the callback, mode 1 and mode 0 take RST 38 */
 static void cpu_z80_reset() {
 	z80_reset(NULL);
+	z80_set_irq_callback(cpu_z80_irq_callback);
 }
 
 static int cpu_z80_run(int cycles) {
 	return z80_execute(cycles);
 }
 
+static void cpu_z80_irq(int do_interrupt) {
+	z80_set_irq_line(0, do_interrupt);
+}
+
+static void cpu_z80_nmi(int do_interrupt) {
+	z80_set_irq_line(IRQ_LINE_NMI, do_interrupt);
+}
+
+static unsigned cpu_z80_get_reg(int regnum) {
+	return z80_get_reg(regnum);
+}
+
+static void cpu_z80_set_reg(int regnum, unsigned val) {
+	z80_set_reg(regnum, val);
+}
+
+static unsigned cpu_z80_get_pc() {
+	return z80_get_reg(Z80_PC);
+}
+
+static unsigned cpu_z80_disasm(unsigned addr, char *dst) {
+	return addr + DasmZ80(dst, addr);
+}
+
+/* RET, RETI and RETN */
+static bool cpu_z80_is_ret_op(unsigned addr) {
+	UINT8 op = coproc_readop(addr);
+	if (op == 0xED) {
+		op = coproc_readop(addr + 1);
+		return op == 0x4D || op == 0x45;
+	}
+	return op == 0xC9;
+}
+
+static UINT16 cpu_z80_frame;
+static void cpu_z80_set_ret_frame() {
+	cpu_z80_frame = z80_get_reg(Z80_SP);
+}
+
+static bool cpu_z80_is_ret_frame() {
+	return cpu_z80_frame == z80_get_reg(Z80_SP);
+}
+
+static int cpu_z80_get_cycles_left() {
+	return z80_ICount;
+}
+
 v_cpu v_6502 = {
 		CPU_M6502,
 		cpu_6502_reset,
@@ -109,28 +333,78 @@ v_cpu v_6502 = {
 		cpu_6502_is_ret_op,
 		cpu_6502_set_ret_frame,
 		cpu_6502_is_ret_frame,
+		m6502_get_cycles_left,
+};
+
+v_cpu v_65c02 = {
+		CPU_M65C02,
+		cpu_65c02_reset,
+		cpu_6502_run,
+		cpu_6502_irq,
+		cpu_65c02_nmi,
+		cpu_6502_set_reg,
+		cpu_6502_get_reg,
+		cpu_6502_get_pc,
+		cpu_6502_disasm,
+		cpu_6502_is_ret_op,
+		cpu_6502_set_ret_frame,
+		cpu_6502_is_ret_frame,
+		m6502_get_cycles_left,
+};
+
+v_cpu v_65ce02 = {
+		CPU_M65CE02,
+		cpu_65ce02_reset,
+		cpu_65ce02_run,
+		cpu_65ce02_irq,
+		cpu_65ce02_nmi,
+		cpu_65ce02_set_reg,
+		cpu_65ce02_get_reg,
+		cpu_65ce02_get_pc,
+		cpu_65ce02_disasm,
+		cpu_65ce02_is_ret_op,
+		cpu_65ce02_set_ret_frame,
+		cpu_65ce02_is_ret_frame,
+		cpu_65ce02_get_cycles_left,
+};
+
+v_cpu v_4510 = {
+		CPU_M4510,
+		cpu_4510_reset,
+		cpu_4510_run,
+		cpu_4510_irq,
+		cpu_4510_nmi,
+		cpu_4510_set_reg,
+		cpu_4510_get_reg,
+		cpu_4510_get_pc,
+		cpu_4510_disasm,
+		cpu_65ce02_is_ret_op,
+		cpu_65ce02_set_ret_frame,
+		cpu_65ce02_is_ret_frame,
+		cpu_4510_get_cycles_left,
 };
 
 v_cpu v_z80 = {
 		CPU_Z80,
 		cpu_z80_reset,
 		cpu_z80_run,
-		NULL,
-		NULL,
-		NULL,
-		NULL,
-		NULL,
-		NULL,
-		NULL,
-		NULL,
-		NULL
+		cpu_z80_irq,
+		cpu_z80_nmi,
+		cpu_z80_set_reg,
+		cpu_z80_get_reg,
+		cpu_z80_get_pc,
+		cpu_z80_disasm,
+		cpu_z80_is_ret_op,
+		cpu_z80_set_ret_frame,
+		cpu_z80_is_ret_frame,
+		cpu_z80_get_cycles_left,
 };
 
 UINT8 cpu_readop(UINT16 pc) {
-	return bus_read16(pc);
+	return bus_peek16(pc);
 }
 UINT8 cpu_readop_arg(UINT16 pc) {
-	return bus_read16(pc);
+	return bus_peek16(pc);
 }
 UINT8 cpu_readmem16(UINT16 addr) {
 	return bus_read16(addr);
@@ -145,6 +419,14 @@ void  cpu_writeport16(UINT16 addr, UINT8 value) {
 	bus_write16(addr, value);
 }
 
+/* 4510 blocks mapped past 64K wrap around, MAP relocates within the CPU space */
+UINT8 cpu_readmem20(UINT32 addr) {
+	return bus_read16(addr & 0xFFFF);
+}
+void  cpu_writemem20(UINT32 addr, UINT8 value) {
+	bus_write16(addr & 0xFFFF, value);
+}
+
 int cpu_6502_irq_callback(int irq_line) {
 	return FALSE;
 }
@@ -153,28 +435,95 @@ int   cpu_getactivecpu() {
 	return 1;
 }
 
-char dasm[200];
 void  change_pc16(UINT16 addr) {
-	if (cpu_pc == addr) return;
 	cpu_pc = addr;
+}
 
-	v_6502.exec_break = cpu_readop(cpu_pc) == 0x00;
+/* the 4510 passes the mapped address, cpu_pc is set from the hook */
+void  change_pc20(UINT32 addr) {
+}
 
-	if (monitor_is_enabled() || monitor_is_stop(addr) || v_6502.exec_break) {
-		// printf("monitor is enabled: %s, break is :%s\n", BOOLSTR(monitor_is_enabled()),	BOOLSTR(v_6502.exec_break));
+/*
+ * Select the execution loop: the plain one has no per instruction hooks,
+ * the instrumented one calls cpu_instruction_hook before each instruction.
+ * Must be called whenever the monitor or trace state changes
+ */
+#if defined(TRACE) || defined(TRACE_ALL)
+#define CPU_TRACE
+static trace_category *cpu_trace_category = NULL;
+
+static bool cpu_trace_is_verbose() {
+	if (!cpu_trace_category) cpu_trace_category = trace_get_category(LOGTAG, TRACE_DEFAULT_LEVEL);
+	return trace_enabled && cpu_trace_category->level >= TRACE_LEVEL_VERBOSE;
+}
+#endif
+
+void cpu_update_hooks() {
+	cpu_instrumented = monitor_is_active() || cputrace_enabled;
+#ifdef CPU_TRACE
+	cpu_instrumented |= cpu_trace_is_verbose();
+#endif
+	if (cpu_instrumented) cpu_wake();
+}
+
+/* leave the plain loop after the current instruction */
+void cpu_request_instrumented() {
+	cpu_instrumented = TRUE;
+	cpu_wake();
+	if (cpu_active == &v_6502 || cpu_active == &v_65c02) m6502_switch_loop();
+}
+
+void cpu_set_blocks(bool enabled) {
+	m6502_set_blocks(enabled);
+}
+
+void cpu_set_aot(bool enabled) {
+	m6502_set_aot(enabled);
+}
+
+void cpu_code_write(UINT16 addr, UINT32 size) {
+	m6502_code_write(addr, size);
+}
+
+void cpu_idle_enter(int cycles_left) {
+	cpu_idle = TRUE;
+	cpu_idle_loops++;
+	cpu_idle_cycles += cycles_left;
+}
+
+void cpu_wake() {
+	cpu_idle = FALSE;
+}
+
+#ifdef CPU_TRACE
+static char dasm[200];
+#endif
+
+void cpu_instruction_hook(UINT16 addr) {
+	cpu_pc = addr;
+
+	if (cputrace_enabled) cputrace_insn(addr);
+	if (coverage_enabled) coverage_insn(addr, cpu_readop(addr));
+
+	cpu_active->exec_break = cpu_readop(cpu_pc) == 0x00;
+
+	if (monitor_is_enabled() || monitor_is_stop(addr) || cpu_active->exec_break) {
+		// printf("monitor is enabled: %s, break is :%s\n", BOOLSTR(monitor_is_enabled()),	BOOLSTR(cpu_active->exec_break));
 		monitor_enter();
 	}
 
-	if (trace_enabled) {
+#ifdef CPU_TRACE
+	if (cpu_trace_is_verbose()) {
 
 #ifdef MAME_DEBUG
-	Dasm6502(dasm, addr);
+	cpu_active->disasm(addr, dasm);
 	LOGV(LOGTAG, "PC %04X %s", addr, dasm);
 #else
 	LOGV(LOGTAG, "PC %04X %02X", addr, cpu_readop(cpu_pc));
 #endif
 
 	}
+#endif
 }
 
 UINT16 activecpu_get_pc() {
@@ -190,5 +539,51 @@ int  get_resource_tag() {
 int  cpu_getexecutingcpu() {
 	return 0;
 }
-void activecpu_abort_timeslice(){}
+
+/* the running core stops after the current instruction, the cycles left count as run */
+void activecpu_abort_timeslice() {
+	switch (cpu_active->cpuType) {
+	case CPU_M65CE02:
+		m65ce02_ICount = 0;
+		break;
+	case CPU_M4510:
+		m4510_ICount = 0;
+		break;
+	case CPU_Z80:
+		z80_ICount = 0;
+		break;
+	default:
+		m6502_abort_timeslice();
+	}
+}
+
+/* devices that take CPU time, the cycles come out of the current run */
+void activecpu_adjust_icount(int delta) {
+	switch (cpu_active->cpuType) {
+	case CPU_M65CE02:
+		m65ce02_ICount += delta;
+		break;
+	case CPU_M4510:
+		m4510_ICount += delta;
+		break;
+	case CPU_Z80:
+		z80_ICount += delta;
+		break;
+	default:
+		m6502_ICount += delta;
+	}
+}
+
+/* A X Y P S, the 65CE02 and 4510 number them as the 6502 */
+void cpu_get_trace_regs(UINT8 *regs) {
+	if (cpu_active == &v_6502 || cpu_active == &v_65c02) {
+		m6502_get_trace_regs(regs);
+		return;
+	}
+	regs[0] = cpu_active->get_reg(M6502_A);
+	regs[1] = cpu_active->get_reg(M6502_X);
+	regs[2] = cpu_active->get_reg(M6502_Y);
+	regs[3] = cpu_active->get_reg(M6502_P);
+	regs[4] = cpu_active->get_reg(M6502_S);
+}
 
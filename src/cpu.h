@@ -3,7 +3,7 @@
 
 #define MAX_CPU 1
 
-enum CpuType {CPU_M6502, CPU_Z80};
+enum CpuType {CPU_M6502, CPU_M65C02, CPU_M65CE02, CPU_M4510, CPU_Z80};
 
 typedef struct {
 	enum CpuType cpuType;
@@ -18,10 +18,26 @@ typedef struct {
 	bool (*is_ret_op)(unsigned addr);
 	void (*set_ret_frame)();
 	bool (*is_ret_frame)();
+	int  (*get_cycles_left)();
 	bool exec_break;
 } v_cpu;
 
 v_cpu* cpu_init(enum CpuType cpuType);
+v_cpu* cpu_coproc_init(enum CpuType cpuType);
+v_cpu* cpu_set_active(v_cpu *cpu);
+void   cpu_update_hooks();
+void   cpu_request_instrumented();
+
+/* basic block cache and translated code, writes to cached code must be reported */
+void   cpu_set_blocks(bool enabled);
+void   cpu_set_aot(bool enabled);
+void   cpu_code_write(UINT16 addr, UINT32 size);
+
+/* idle loop state, the CPU does not run while cpu_idle is set */
+extern bool   cpu_idle;
+extern UINT64 cpu_idle_loops;
+extern UINT64 cpu_idle_cycles;
+void   cpu_wake();
 void   cpu_reset(v_cpu *cpu);
 int    cpu_run(v_cpu *cpu, int cycles);
 
@@ -33,5 +49,9 @@ int  cpu_getexecutingcpu();
 
 UINT16 activecpu_get_pc();
 void   activecpu_abort_timeslice();
+void   activecpu_adjust_icount(int delta);
+
+/* A X Y P and the low byte of S of the running core, for cputrace */
+void   cpu_get_trace_regs(UINT8 *regs);
 
 #endif
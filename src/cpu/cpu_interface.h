@@ -69,9 +69,27 @@ void  cpu_writeport16(UINT16 addr, UINT8 value);
 int   cpu_getactivecpu();
 void  change_pc16(UINT16 addr); // callback to inform PC was updated?
 
+/* 4510 mapped accesses, the machine decodes the low 16 bits */
+UINT8 cpu_readmem20(UINT32 addr);
+void  cpu_writemem20(UINT32 addr, UINT8 value);
+void  change_pc20(UINT32 addr);
+
+/* set while a debugger, trace or profiler needs the instrumented loop */
+extern bool cpu_instrumented;
+void  cpu_instruction_hook(UINT16 addr);
+
+/* set by the core on an idle loop with the cycles left in the slice, see cpu.c */
+extern bool cpu_idle;
+void  cpu_idle_enter(int cycles_left);
+
 #define state_save_register_INT16(A, B, C, D, E)
 #define state_save_register_INT8(A, B, C, D, E)
 #define state_save_register_UINT16(A, B, C, D, E)
 #define state_save_register_UINT8(A, B, C, D, E)
+#define state_save_UINT16(A, B, C, D, E, F)
+#define state_save_UINT8(A, B, C, D, E, F)
+#define state_load_UINT16(A, B, C, D, E, F)
+#define state_load_UINT8(A, B, C, D, E, F)
+#define state_save_register_func_postload(F)
 
 #endif
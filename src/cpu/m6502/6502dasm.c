@@ -443,7 +443,7 @@ static const UINT8 op65ce02[256][3] = {
 	{bit,zpg,ZRD},{and,zpg,ZRD},{rol,zpg,ZRW},{rmb,zpg,ZRW},
 	{plp,imp,0	},{and,imm,VAL},{rol,acc,0	},{tys,imp,0  },
 	{bit,aba,MRD},{and,aba,MRD},{rol,aba,MRW},{bbr,zpb,ZRD},
-	{bmi,rel,BRA},{and,idz,MRD},{and,zpi,MRD},{bmi,rw2,BRA},/* 30 */
+	{bmi,rel,BRA},{and,idy,MRD},{and,idz,MRD},{bmi,rw2,BRA},/* 30 */
 	{bit,zpx,ZRD},{and,zpx,ZRD},{rol,zpx,ZRW},{rmb,zpg,ZRW},
 	{sec,imp,0	},{and,aby,MRD},{dea,imp,0	},{dez,imp,0  },
 	{bit,abx,MRD},{and,abx,MRD},{rol,abx,MRW},{bbr,zpb,ZRD},
@@ -467,7 +467,7 @@ static const UINT8 op65ce02[256][3] = {
 	{sty,zpg,ZWR},{sta,zpg,ZWR},{stx,zpg,ZWR},{smb,zpg,ZRW},
 	{dey,imp,0	},{bit,imm,VAL},{txa,imp,0	},{sty,abx,MWR},
 	{sty,aba,MWR},{sta,aba,MWR},{stx,aba,MWR},{bbs,zpb,ZRD},
-	{bcc,rel,BRA},{sta,idy,MWR},{sta,inz,MWR},{bcc,rw2,BRA},/* 90 */
+	{bcc,rel,BRA},{sta,idy,MWR},{sta,idz,MWR},{bcc,rw2,BRA},/* 90 */
 	{sty,zpx,ZWR},{sta,zpx,ZWR},{stx,zpy,ZWR},{smb,zpg,ZRW},
 	{tya,imp,0	},{sta,aby,MWR},{txs,imp,0	},{stx,aby,MWR},
 	{stz2,aba,MWR},{sta,abx,MWR},{stz2,abx,MWR},{bbs,zpb,ZRD},
@@ -475,7 +475,7 @@ static const UINT8 op65ce02[256][3] = {
 	{ldy,zpg,ZRD},{lda,zpg,ZRD},{ldx,zpg,ZRD},{smb,zpg,ZRW},
 	{tay,imp,0	},{lda,imm,VAL},{tax,imp,0	},{ldz,aba,MRD},
 	{ldy,aba,MRD},{lda,aba,MRD},{ldx,aba,MRD},{bbs,zpb,ZRD},
-	{bcs,rel,BRA},{lda,idy,MRD},{lda,inz,MRD},{bcs,rw2,BRA},/* b0 */
+	{bcs,rel,BRA},{lda,idy,MRD},{lda,idz,MRD},{bcs,rw2,BRA},/* b0 */
 	{ldy,zpx,ZRD},{lda,zpx,ZRD},{ldx,zpy,ZRD},{smb,zpg,ZRW},
 	{clv,imp,0	},{lda,aby,MRD},{tsx,imp,0	},{ldz,abx,MRD},
 	{ldy,abx,MRD},{lda,abx,MRD},{ldx,aby,MRD},{bbs,zpb,ZRD},
@@ -513,7 +513,7 @@ static const UINT8 op4510[256][3] = {
 	{bit,zpg,ZRD},{and,zpg,ZRD},{rol,zpg,ZRW},{rmb,zpg,ZRW},
 	{plp,imp,0	},{and,imm,VAL},{rol,acc,0	},{tys,imp,0  },
 	{bit,aba,MRD},{and,aba,MRD},{rol,aba,MRW},{bbr,zpb,ZRD},
-	{bmi,rel,BRA},{and,idz,MRD},{and,zpi,MRD},{bmi,rw2,BRA},/* 30 */
+	{bmi,rel,BRA},{and,idy,MRD},{and,idz,MRD},{bmi,rw2,BRA},/* 30 */
 	{bit,zpx,ZRD},{and,zpx,ZRD},{rol,zpx,ZRW},{rmb,zpg,ZRW},
 	{sec,imp,0	},{and,aby,MRD},{dea,imp,0	},{dez,imp,0  },
 	{bit,abx,MRD},{and,abx,MRD},{rol,abx,MRW},{bbr,zpb,ZRD},
@@ -537,7 +537,7 @@ static const UINT8 op4510[256][3] = {
 	{sty,zpg,ZWR},{sta,zpg,ZWR},{stx,zpg,ZWR},{smb,zpg,ZRW},
 	{dey,imp,0	},{bit,imm,VAL},{txa,imp,0	},{sty,abx,MWR},
 	{sty,aba,MWR},{sta,aba,MWR},{stx,aba,MWR},{bbs,zpb,ZRD},
-	{bcc,rel,BRA},{sta,idy,MWR},{sta,inz,MWR},{bcc,rw2,BRA},/* 90 */
+	{bcc,rel,BRA},{sta,idy,MWR},{sta,idz,MWR},{bcc,rw2,BRA},/* 90 */
 	{sty,zpx,ZWR},{sta,zpx,ZWR},{stx,zpy,ZWR},{smb,zpg,ZRW},
 	{tya,imp,0	},{sta,aby,MWR},{txs,imp,0	},{stx,aby,MWR},
 	{stz2,aba,MWR},{sta,abx,MWR},{stz2,abx,MWR},{bbs,zpb,ZRD},
@@ -545,7 +545,7 @@ static const UINT8 op4510[256][3] = {
 	{ldy,zpg,ZRD},{lda,zpg,ZRD},{ldx,zpg,ZRD},{smb,zpg,ZRW},
 	{tay,imp,0	},{lda,imm,VAL},{tax,imp,0	},{ldz,aba,MRD},
 	{ldy,aba,MRD},{lda,aba,MRD},{ldx,aba,MRD},{bbs,zpb,ZRD},
-	{bcs,rel,BRA},{lda,idy,MRD},{lda,inz,MRD},{bcs,rw2,BRA},/* b0 */
+	{bcs,rel,BRA},{lda,idy,MRD},{lda,idz,MRD},{bcs,rw2,BRA},/* b0 */
 	{ldy,zpx,ZRD},{lda,zpx,ZRD},{ldx,zpy,ZRD},{smb,zpg,ZRW},
 	{clv,imp,0	},{lda,aby,MRD},{tsx,imp,0	},{ldz,abx,MRD},
 	{ldy,abx,MRD},{lda,abx,MRD},{ldx,aby,MRD},{bbs,zpb,ZRD},
@@ -827,14 +827,14 @@ unsigned Dasm6502(char *buffer, unsigned pc)
 
 #if (HAS_M65CE02 || HAS_M6509 || HAS_M6510 || HAS_M4510)
 
-#if (HAS_M65CE02 || HAS_M6510)
+#if (HAS_M65CE02 || HAS_M6510 || HAS_M4510)
 static int m6502_get_argword(int addr)
 {
 	return cpu_readop_arg(addr)+(cpu_readop_arg((addr+1)&0xffff) << 8);
 }
 #endif
 
-#if (HAS_M6509 || HAS_M4510)
+#if (HAS_M6509)
 static int m6509_get_argword(int addr)
 {
 	if ((addr&0xffff)==0xffff)
@@ -875,8 +875,13 @@ static CPU_TYPE type_m65sc02 = {
 };
 #endif
 #if (HAS_M65CE02)
+static READ_HANDLER(m65ce02_readmem)
+{
+	return cpu_readmem16( offset );
+}
+
 static CPU_TYPE type_m65ce02 = {
-	(const UINT8*)op65ce02, m65ce02_get_reg, cpu_readmem16, m6502_get_argword
+	(const UINT8*)op65ce02, m65ce02_get_reg, m65ce02_readmem, m6502_get_argword
 };
 #endif
 #if (HAS_M4510)
@@ -886,7 +891,7 @@ static READ_HANDLER(m4510_readmem)
 }
 
 static CPU_TYPE type_m4510 = {
-	(const UINT8*)op4510, m4510_get_reg, m4510_readmem, m6509_get_argword
+	(const UINT8*)op4510, m4510_get_reg, m4510_readmem, m6502_get_argword
 };
 #endif
 
@@ -1002,7 +1007,7 @@ unsigned int Dasm6502Helper(CPU_TYPE *this, char *buffer, unsigned pc)
 	case idz:
 		addr = ARGBYTE(pc++);
 		ea = (this->readmem(addr) + (this->readmem((addr+1) & 0xff) << 8)
-			  + this->get_reg(M6502_Y)) & 0xffff;
+			  + this->get_reg(M65CE02_Z)) & 0xffff;
 		symbol = set_ea_info( 0, ea, EA_UINT16, access );
 		dst += sprintf(dst,"($%02X),z", addr);
 		break;
@@ -1013,7 +1018,7 @@ unsigned int Dasm6502Helper(CPU_TYPE *this, char *buffer, unsigned pc)
 		ea = (this->readmem(addr)+(this->readmem(addr+1) << 8)+
 			   this->get_reg(M6502_Y)) & 0xffff;
 		symbol = set_ea_info( 0, ea, EA_UINT16, access );
-		dst += sprintf(dst,"(s,$%02X),y", addr);
+		dst += sprintf(dst,"($%02X,s),y", op);
 		break;
 
 	case zpi:
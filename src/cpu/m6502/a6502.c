@@ -0,0 +1,120 @@
+/*****************************************************************************
+ *
+ *	 a6502.c
+ *	 6502 translated code, included by m6502.c after b6502.c
+ *
+ *	 The functions written by tools/xex2c call the micro-ops of b6502.c
+ *	 with constant operands and stop under the same conditions as a cached
+ *	 block: each instruction runs only while cycles are left, no IRQ is
+ *	 pending and the code was not written. The instruction that ends a run
+ *	 is left to the interpreter.
+ *
+ *	 The bytes of a block are hashed when the PC first enters it and again
+ *	 after a write to them. A block that does not match runs in the
+ *	 interpreter or the block cache.
+ *
+ *****************************************************************************/
+
+#include "a6502.h"
+
+#define AOT_UOP(nn, addr, next, operand)								\
+	{																	\
+		static const m6502_uop u = {m6502_uop_##nn, operand, next, 0};	\
+		PPC = addr; 													\
+		PCW = next; 													\
+		m6502_uop_##nn(&u); 											\
+	}																	\
+	if (m6502_ICount <= 0 || m6502.pending_irq || block_abort) return
+
+/* images translated at build time, see the Makefile */
+#ifdef M6502_AOT
+#include "os_aot.c"
+#endif
+
+static const m6502_aot_block *aot_images[] = {
+#ifdef M6502_AOT
+	os_aot,
+#endif
+	NULL
+};
+
+#define AOT_UNCHECKED 0
+#define AOT_VALID     1
+#define AOT_STALE     2
+
+int m6502_aot_enabled = 1;
+
+/* block of each instruction and of each byte, state by block start */
+static const m6502_aot_block *aot_entry[0x10000];
+static const m6502_aot_block *aot_owner[0x10000];
+static UINT8 aot_state[0x10000];
+
+static void m6502_aot_init(void)
+{
+	for(int i = 0; aot_images[i]; i++)
+	{
+		for(const m6502_aot_block *b = aot_images[i]; b->run; b++)
+		{
+			if (!m6502_block_cacheable(b->start) || !m6502_block_cacheable(b->start + b->size - 1))
+				continue;
+
+			for(int n = 0; n < b->entries_count; n++)
+				aot_entry[b->entries[n]] = b;
+			for(unsigned addr = b->start; addr < b->start + b->size; addr++)
+				aot_owner[addr] = b;
+		}
+	}
+}
+
+/* the cache flush also dropped the code marks of the checked blocks */
+static void m6502_aot_flush(void)
+{
+	memset(aot_state, AOT_UNCHECKED, sizeof(aot_state));
+}
+
+static void m6502_aot_code_write(unsigned addr)
+{
+	if (aot_owner[addr])
+		aot_state[aot_owner[addr]->start] = AOT_UNCHECKED;
+}
+
+static bool m6502_aot_check(const m6502_aot_block *b)
+{
+	UINT32 hash = M6502_AOT_HASH_INIT;
+	for(unsigned addr = b->start; addr < b->start + b->size; addr++)
+		hash = m6502_aot_hash(hash, cpu_readop(addr));
+
+	/* marked as code either way, so a write checks it again */
+	m6502_block_mark_code(b->start, b->size);
+	aot_state[b->start] = hash == b->hash ? AOT_VALID : AOT_STALE;
+
+	LOGV(LOGTAG, "translated block %04X-%04X %s", b->start, b->start + b->size - 1,
+			hash == b->hash ? "matches" : "was modified");
+	return hash == b->hash;
+}
+
+void m6502_set_aot(int enabled)
+{
+	m6502_aot_enabled = enabled;
+}
+
+/*
+ * run the translated block at PC, returns FALSE if there is none
+ * called from the plain loop with the same conditions as an instruction
+ */
+static int m6502_aot_run(void)
+{
+	if (!m6502_aot_enabled) return FALSE;
+
+	const m6502_aot_block *b = aot_entry[PCW];
+	if (!b) return FALSE;
+
+	if (aot_state[b->start] != AOT_VALID)
+	{
+		if (aot_state[b->start] == AOT_STALE || !m6502_aot_check(b)) return FALSE;
+	}
+
+	block_abort = FALSE;
+	b->run(PCW);
+	return TRUE;
+}
@@ -0,0 +1,32 @@
+/*****************************************************************************
+ *
+ *	 a6502.h
+ *	 Translated code for fixed images, shared by a6502.c and tools/xex2c
+ *
+ *	 tools/xex2c writes a C file with one function per run of straight
+ *	 line code and a table of m6502_aot_block, the file is included by
+ *	 a6502.c. The hash of the bytes of each block is checked before the
+ *	 block runs, so the image may be replaced or modified at run time.
+ *
+ *****************************************************************************/
+
+#ifndef _A6502_H
+#define _A6502_H
+
+typedef struct {
+	UINT16 start;
+	UINT16 size;              /* bytes covered by the block */
+	UINT32 hash;              /* of those bytes, see m6502_aot_hash */
+	void  (*run)(UINT16 pc);  /* entered at any instruction of the block */
+	const UINT16 *entries;    /* address of each instruction */
+	UINT16 entries_count;
+} m6502_aot_block;
+
+#define M6502_AOT_HASH_INIT 0x811C9DC5
+
+/* FNV-1a, one byte at a time */
+static inline UINT32 m6502_aot_hash(UINT32 hash, UINT8 value) {
+	return (hash ^ value) * 0x01000193;
+}
+
+#endif
@@ -0,0 +1,577 @@
+/*****************************************************************************
+ *
+ *	 b6502.c
+ *	 6502 basic block cache, included by m6502.c
+ *
+ *	 A block is the straight line code starting at an entry PC, up to the
+ *	 first branch, jump, stack frame or interrupt flag instruction. It is
+ *	 decoded once into micro-ops with the operand bytes already fetched,
+ *	 the micro-ops reuse the opcode macros so timing and flags are the
+ *	 same as the interpreter.
+ *
+ *	 The micro-ops run under the same conditions as the plain loop: each
+ *	 one only while cycles are left and no IRQ is pending, so blocks can
+ *	 stop in the middle and slices, DLIs and WSYNC are not affected. The
+ *	 instruction that ends a block is run by the plain loop.
+ *
+ *	 N and Z results overwritten later in the block are not computed, the
+ *	 last one is kept and restored if the block stops before the overwrite.
+ *
+ *	 Only code in RAM is cached, writes to cached code go through the
+ *	 WATCH_CODE page flag of the bus and drop the blocks that hold it.
+ *
+ *****************************************************************************/
+
+#define BLOCK_MAX_UOPS   16
+#define BLOCK_MAX_BYTES  (BLOCK_MAX_UOPS * 3)
+#define BLOCK_POOL_SIZE  4096
+
+typedef struct m6502_uop m6502_uop;
+
+struct m6502_uop {
+	void   (*exec)(const m6502_uop *u);
+	UINT16 arg;     /* operand bytes */
+	UINT16 next;    /* address of the next instruction */
+	UINT8  nz_fix;  /* N and Z of the last writer up to here were not computed */
+};
+
+typedef struct {
+	UINT8 count;
+	m6502_uop uops[BLOCK_MAX_UOPS];
+} m6502_block;
+
+typedef struct {
+	void (*exec)(const m6502_uop *u);
+	void (*exec_dead)(const m6502_uop *u);  /* same without computing N and Z */
+	UINT8 size;
+	bool  writes_nz;
+} m6502_uop_info;
+
+int m6502_blocks_enabled = 1;
+
+static m6502_block *block_cache[0x10000];
+static m6502_block  block_pool[BLOCK_POOL_SIZE];
+static int          block_pool_used = 0;
+static m6502_block  block_empty;
+
+/* bytes that belong to a cached block */
+static UINT8 block_code[0x10000];
+
+static bool block_abort = FALSE;
+static int  block_nz;
+
+/* translated code shares the code marks, see a6502.c */
+static void m6502_aot_flush(void);
+static void m6502_aot_code_write(unsigned addr);
+
+/***************************************************************
+ * micro-ops, the operand comes from the decoded argument
+ ***************************************************************/
+#define UOP(nn) static void m6502_uop_##nn(const m6502_uop *u)
+#define UOP_DEAD(nn) static void m6502_uop_##nn##_dead(const m6502_uop *u)
+
+#define UEA_ZPG ZPL = u->arg; EAD = ZPD
+#define UEA_ZPX ZPL = u->arg + X; EAD = ZPD
+#define UEA_ZPY ZPL = u->arg + Y; EAD = ZPD
+#define UEA_ABS EAD = u->arg
+#define UEA_ABX UEA_ABS; EAW += X
+#define UEA_ABY UEA_ABS; EAW += Y
+#define UEA_IDX ZPL = u->arg + X; EAL = RDMEM(ZPD); ZPL++; EAH = RDMEM(ZPD)
+#define UEA_IDY 												\
+	ZPL = u->arg;												\
+	EAL = RDMEM(ZPD);											\
+	ZPL++;														\
+	EAH = RDMEM(ZPD);											\
+	if (EAL + Y > 0xff) 										\
+		m6502_ICount--; 										\
+	EAW += Y
+
+#define URD_IMM tmp = u->arg
+#define URD_ZPG UEA_ZPG; tmp = RDMEM(EAD)
+#define URD_ZPX UEA_ZPX; tmp = RDMEM(EAD)
+#define URD_ZPY UEA_ZPY; tmp = RDMEM(EAD)
+#define URD_ABS UEA_ABS; tmp = RDMEM(EAD)
+#define URD_ABX UEA_ABX; tmp = RDMEM(EAD)
+#define URD_ABY UEA_ABY; tmp = RDMEM(EAD)
+#define URD_IDX UEA_IDX; tmp = RDMEM(EAD)
+#define URD_IDY UEA_IDY; tmp = RDMEM(EAD)
+
+#define UWR_ZPG UEA_ZPG; WRMEM(EAD, tmp)
+#define UWR_ZPX UEA_ZPX; WRMEM(EAD, tmp)
+#define UWR_ZPY UEA_ZPY; WRMEM(EAD, tmp)
+#define UWR_ABS UEA_ABS; WRMEM(EAD, tmp)
+#define UWR_ABX UEA_ABX; WRMEM(EAD, tmp)
+#define UWR_ABY UEA_ABY; WRMEM(EAD, tmp)
+#define UWR_IDX UEA_IDX; WRMEM(EAD, tmp)
+#define UWR_IDY UEA_IDY; WRMEM(EAD, tmp)
+
+UOP(a0) { int tmp; m6502_ICount -= 2; URD_IMM; LDY;		  } /* 2 LDY IMM */
+UOP(c0) { int tmp; m6502_ICount -= 2; URD_IMM; CPY;		  } /* 2 CPY IMM */
+UOP(e0) { int tmp; m6502_ICount -= 2; URD_IMM; CPX;		  } /* 2 CPX IMM */
+UOP(01) { int tmp; m6502_ICount -= 6; URD_IDX; ORA;		  } /* 6 ORA IDX */
+UOP(21) { int tmp; m6502_ICount -= 6; URD_IDX; AND;		  } /* 6 AND IDX */
+UOP(41) { int tmp; m6502_ICount -= 6; URD_IDX; EOR;		  } /* 6 EOR IDX */
+UOP(61) { int tmp; m6502_ICount -= 6; URD_IDX; ADC;		  } /* 6 ADC IDX */
+UOP(81) { int tmp; m6502_ICount -= 6;		 STA; UWR_IDX; } /* 6 STA IDX */
+UOP(a1) { int tmp; m6502_ICount -= 6; URD_IDX; LDA;		  } /* 6 LDA IDX */
+UOP(c1) { int tmp; m6502_ICount -= 6; URD_IDX; CMP;		  } /* 6 CMP IDX */
+UOP(e1) { int tmp; m6502_ICount -= 6; URD_IDX; SBC;		  } /* 6 SBC IDX */
+UOP(11) { int tmp; m6502_ICount -= 5; URD_IDY; ORA;		  } /* 5 ORA IDY */
+UOP(31) { int tmp; m6502_ICount -= 5; URD_IDY; AND;		  } /* 5 AND IDY */
+UOP(51) { int tmp; m6502_ICount -= 5; URD_IDY; EOR;		  } /* 5 EOR IDY */
+UOP(71) { int tmp; m6502_ICount -= 5; URD_IDY; ADC;		  } /* 5 ADC IDY */
+UOP(91) { int tmp; m6502_ICount -= 6;		 STA; UWR_IDY; } /* 6 STA IDY */
+UOP(b1) { int tmp; m6502_ICount -= 5; URD_IDY; LDA;		  } /* 5 LDA IDY */
+UOP(d1) { int tmp; m6502_ICount -= 5; URD_IDY; CMP;		  } /* 5 CMP IDY */
+UOP(f1) { int tmp; m6502_ICount -= 5; URD_IDY; SBC;		  } /* 5 SBC IDY */
+UOP(a2) { int tmp; m6502_ICount -= 2; URD_IMM; LDX;		  } /* 2 LDX IMM */
+UOP(24) { int tmp; m6502_ICount -= 3; URD_ZPG; BIT;		  } /* 3 BIT ZPG */
+UOP(84) { int tmp; m6502_ICount -= 3;		 STY; UWR_ZPG; } /* 3 STY ZPG */
+UOP(a4) { int tmp; m6502_ICount -= 3; URD_ZPG; LDY;		  } /* 3 LDY ZPG */
+UOP(c4) { int tmp; m6502_ICount -= 3; URD_ZPG; CPY;		  } /* 3 CPY ZPG */
+UOP(e4) { int tmp; m6502_ICount -= 3; URD_ZPG; CPX;		  } /* 3 CPX ZPG */
+UOP(94) { int tmp; m6502_ICount -= 4;		 STY; UWR_ZPX; } /* 4 STY ZPX */
+UOP(b4) { int tmp; m6502_ICount -= 4; URD_ZPX; LDY;		  } /* 4 LDY ZPX */
+UOP(05) { int tmp; m6502_ICount -= 3; URD_ZPG; ORA;		  } /* 3 ORA ZPG */
+UOP(25) { int tmp; m6502_ICount -= 3; URD_ZPG; AND;		  } /* 3 AND ZPG */
+UOP(45) { int tmp; m6502_ICount -= 3; URD_ZPG; EOR;		  } /* 3 EOR ZPG */
+UOP(65) { int tmp; m6502_ICount -= 3; URD_ZPG; ADC;		  } /* 3 ADC ZPG */
+UOP(85) { int tmp; m6502_ICount -= 3;		 STA; UWR_ZPG; } /* 3 STA ZPG */
+UOP(a5) { int tmp; m6502_ICount -= 3; URD_ZPG; LDA;		  } /* 3 LDA ZPG */
+UOP(c5) { int tmp; m6502_ICount -= 3; URD_ZPG; CMP;		  } /* 3 CMP ZPG */
+UOP(e5) { int tmp; m6502_ICount -= 3; URD_ZPG; SBC;		  } /* 3 SBC ZPG */
+UOP(15) { int tmp; m6502_ICount -= 4; URD_ZPX; ORA;		  } /* 4 ORA ZPX */
+UOP(35) { int tmp; m6502_ICount -= 4; URD_ZPX; AND;		  } /* 4 AND ZPX */
+UOP(55) { int tmp; m6502_ICount -= 4; URD_ZPX; EOR;		  } /* 4 EOR ZPX */
+UOP(75) { int tmp; m6502_ICount -= 4; URD_ZPX; ADC;		  } /* 4 ADC ZPX */
+UOP(95) { int tmp; m6502_ICount -= 4;		 STA; UWR_ZPX; } /* 4 STA ZPX */
+UOP(b5) { int tmp; m6502_ICount -= 4; URD_ZPX; LDA;		  } /* 4 LDA ZPX */
+UOP(d5) { int tmp; m6502_ICount -= 4; URD_ZPX; CMP;		  } /* 4 CMP ZPX */
+UOP(f5) { int tmp; m6502_ICount -= 4; URD_ZPX; SBC;		  } /* 4 SBC ZPX */
+UOP(06) { int tmp; m6502_ICount -= 5; URD_ZPG; ASL; WB_EA;  } /* 5 ASL ZPG */
+UOP(26) { int tmp; m6502_ICount -= 5; URD_ZPG; ROL; WB_EA;  } /* 5 ROL ZPG */
+UOP(46) { int tmp; m6502_ICount -= 5; URD_ZPG; LSR; WB_EA;  } /* 5 LSR ZPG */
+UOP(66) { int tmp; m6502_ICount -= 5; URD_ZPG; ROR; WB_EA;  } /* 5 ROR ZPG */
+UOP(86) { int tmp; m6502_ICount -= 3;		 STX; UWR_ZPG; } /* 3 STX ZPG */
+UOP(a6) { int tmp; m6502_ICount -= 3; URD_ZPG; LDX;		  } /* 3 LDX ZPG */
+UOP(c6) { int tmp; m6502_ICount -= 5; URD_ZPG; DEC; WB_EA;  } /* 5 DEC ZPG */
+UOP(e6) { int tmp; m6502_ICount -= 5; URD_ZPG; INC; WB_EA;  } /* 5 INC ZPG */
+UOP(16) { int tmp; m6502_ICount -= 6; URD_ZPX; ASL; WB_EA;  } /* 6 ASL ZPX */
+UOP(36) { int tmp; m6502_ICount -= 6; URD_ZPX; ROL; WB_EA;  } /* 6 ROL ZPX */
+UOP(56) { int tmp; m6502_ICount -= 6; URD_ZPX; LSR; WB_EA;  } /* 6 LSR ZPX */
+UOP(76) { int tmp; m6502_ICount -= 6; URD_ZPX; ROR; WB_EA;  } /* 6 ROR ZPX */
+UOP(96) { int tmp; m6502_ICount -= 4;		 STX; UWR_ZPY; } /* 4 STX ZPY */
+UOP(b6) { int tmp; m6502_ICount -= 4; URD_ZPY; LDX;		  } /* 4 LDX ZPY */
+UOP(d6) { int tmp; m6502_ICount -= 6; URD_ZPX; DEC; WB_EA;  } /* 6 DEC ZPX */
+UOP(f6) { int tmp; m6502_ICount -= 6; URD_ZPX; INC; WB_EA;  } /* 6 INC ZPX */
+UOP(48) {		  m6502_ICount -= 3;		 PHA;		  } /* 2 PHA */
+UOP(68) {		  m6502_ICount -= 4;		 PLA;		  } /* 2 PLA */
+UOP(88) {		  m6502_ICount -= 2;		 DEY;		  } /* 2 DEY */
+UOP(a8) {		  m6502_ICount -= 2;		 TAY;		  } /* 2 TAY */
+UOP(c8) {		  m6502_ICount -= 2;		 INY;		  } /* 2 INY */
+UOP(e8) {		  m6502_ICount -= 2;		 INX;		  } /* 2 INX */
+UOP(18) {		  m6502_ICount -= 2;		 CLC;		  } /* 2 CLC */
+UOP(38) {		  m6502_ICount -= 2;		 SEC;		  } /* 2 SEC */
+UOP(98) {		  m6502_ICount -= 2;		 TYA;		  } /* 2 TYA */
+UOP(b8) {		  m6502_ICount -= 2;		 CLV;		  } /* 2 CLV */
+UOP(d8) {		  m6502_ICount -= 2;		 CLD;		  } /* 2 CLD */
+UOP(f8) {		  m6502_ICount -= 2;		 SED;		  } /* 2 SED */
+UOP(09) { int tmp; m6502_ICount -= 2; URD_IMM; ORA;		  } /* 2 ORA IMM */
+UOP(29) { int tmp; m6502_ICount -= 2; URD_IMM; AND;		  } /* 2 AND IMM */
+UOP(49) { int tmp; m6502_ICount -= 2; URD_IMM; EOR;		  } /* 2 EOR IMM */
+UOP(69) { int tmp; m6502_ICount -= 2; URD_IMM; ADC;		  } /* 2 ADC IMM */
+UOP(a9) { int tmp; m6502_ICount -= 2; URD_IMM; LDA;		  } /* 2 LDA IMM */
+UOP(c9) { int tmp; m6502_ICount -= 2; URD_IMM; CMP;		  } /* 2 CMP IMM */
+UOP(e9) { int tmp; m6502_ICount -= 2; URD_IMM; SBC;		  } /* 2 SBC IMM */
+UOP(19) { int tmp; m6502_ICount -= 4; URD_ABY; ORA;		  } /* 4 ORA ABY */
+UOP(39) { int tmp; m6502_ICount -= 4; URD_ABY; AND;		  } /* 4 AND ABY */
+UOP(59) { int tmp; m6502_ICount -= 4; URD_ABY; EOR;		  } /* 4 EOR ABY */
+UOP(79) { int tmp; m6502_ICount -= 4; URD_ABY; ADC;		  } /* 4 ADC ABY */
+UOP(99) { int tmp; m6502_ICount -= 5;		 STA; UWR_ABY; } /* 5 STA ABY */
+UOP(b9) { int tmp; m6502_ICount -= 4; URD_ABY; LDA;		  } /* 4 LDA ABY */
+UOP(d9) { int tmp; m6502_ICount -= 4; URD_ABY; CMP;		  } /* 4 CMP ABY */
+UOP(f9) { int tmp; m6502_ICount -= 4; URD_ABY; SBC;		  } /* 4 SBC ABY */
+UOP(0a) { int tmp; m6502_ICount -= 2; RD_ACC; ASL; WB_ACC; } /* 2 ASL A */
+UOP(2a) { int tmp; m6502_ICount -= 2; RD_ACC; ROL; WB_ACC; } /* 2 ROL A */
+UOP(4a) { int tmp; m6502_ICount -= 2; RD_ACC; LSR; WB_ACC; } /* 2 LSR A */
+UOP(6a) { int tmp; m6502_ICount -= 2; RD_ACC; ROR; WB_ACC; } /* 2 ROR A */
+UOP(8a) {		  m6502_ICount -= 2;		 TXA;		  } /* 2 TXA */
+UOP(aa) {		  m6502_ICount -= 2;		 TAX;		  } /* 2 TAX */
+UOP(ca) {		  m6502_ICount -= 2;		 DEX;		  } /* 2 DEX */
+UOP(ea) {		  m6502_ICount -= 2;		 NOP;		  } /* 2 NOP */
+UOP(9a) {		  m6502_ICount -= 2;		 TXS;		  } /* 2 TXS */
+UOP(ba) {		  m6502_ICount -= 2;		 TSX;		  } /* 2 TSX */
+UOP(2c) { int tmp; m6502_ICount -= 4; URD_ABS; BIT;		  } /* 4 BIT ABS */
+UOP(8c) { int tmp; m6502_ICount -= 4;		 STY; UWR_ABS; } /* 4 STY ABS */
+UOP(ac) { int tmp; m6502_ICount -= 4; URD_ABS; LDY;		  } /* 4 LDY ABS */
+UOP(cc) { int tmp; m6502_ICount -= 4; URD_ABS; CPY;		  } /* 4 CPY ABS */
+UOP(ec) { int tmp; m6502_ICount -= 4; URD_ABS; CPX;		  } /* 4 CPX ABS */
+UOP(bc) { int tmp; m6502_ICount -= 4; URD_ABX; LDY;		  } /* 4 LDY ABX */
+UOP(0d) { int tmp; m6502_ICount -= 4; URD_ABS; ORA;		  } /* 4 ORA ABS */
+UOP(2d) { int tmp; m6502_ICount -= 4; URD_ABS; AND;		  } /* 4 AND ABS */
+UOP(4d) { int tmp; m6502_ICount -= 4; URD_ABS; EOR;		  } /* 4 EOR ABS */
+UOP(6d) { int tmp; m6502_ICount -= 4; URD_ABS; ADC;		  } /* 4 ADC ABS */
+UOP(8d) { int tmp; m6502_ICount -= 4;		 STA; UWR_ABS; } /* 4 STA ABS */
+UOP(ad) { int tmp; m6502_ICount -= 4; URD_ABS; LDA;		  } /* 4 LDA ABS */
+UOP(cd) { int tmp; m6502_ICount -= 4; URD_ABS; CMP;		  } /* 4 CMP ABS */
+UOP(ed) { int tmp; m6502_ICount -= 4; URD_ABS; SBC;		  } /* 4 SBC ABS */
+UOP(1d) { int tmp; m6502_ICount -= 4; URD_ABX; ORA;		  } /* 4 ORA ABX */
+UOP(3d) { int tmp; m6502_ICount -= 4; URD_ABX; AND;		  } /* 4 AND ABX */
+UOP(5d) { int tmp; m6502_ICount -= 4; URD_ABX; EOR;		  } /* 4 EOR ABX */
+UOP(7d) { int tmp; m6502_ICount -= 4; URD_ABX; ADC;		  } /* 4 ADC ABX */
+UOP(9d) { int tmp; m6502_ICount -= 5;		 STA; UWR_ABX; } /* 5 STA ABX */
+UOP(bd) { int tmp; m6502_ICount -= 4; URD_ABX; LDA;		  } /* 4 LDA ABX */
+UOP(dd) { int tmp; m6502_ICount -= 4; URD_ABX; CMP;		  } /* 4 CMP ABX */
+UOP(fd) { int tmp; m6502_ICount -= 4; URD_ABX; SBC;		  } /* 4 SBC ABX */
+UOP(0e) { int tmp; m6502_ICount -= 6; URD_ABS; ASL; WB_EA;  } /* 6 ASL ABS */
+UOP(2e) { int tmp; m6502_ICount -= 6; URD_ABS; ROL; WB_EA;  } /* 6 ROL ABS */
+UOP(4e) { int tmp; m6502_ICount -= 6; URD_ABS; LSR; WB_EA;  } /* 6 LSR ABS */
+UOP(6e) { int tmp; m6502_ICount -= 6; URD_ABS; ROR; WB_EA;  } /* 6 ROR ABS */
+UOP(8e) { int tmp; m6502_ICount -= 5;		 STX; UWR_ABS; } /* 5 STX ABS */
+UOP(ae) { int tmp; m6502_ICount -= 4; URD_ABS; LDX;		  } /* 4 LDX ABS */
+UOP(ce) { int tmp; m6502_ICount -= 6; URD_ABS; DEC; WB_EA;  } /* 6 DEC ABS */
+UOP(ee) { int tmp; m6502_ICount -= 6; URD_ABS; INC; WB_EA;  } /* 6 INC ABS */
+UOP(1e) { int tmp; m6502_ICount -= 7; URD_ABX; ASL; WB_EA;  } /* 7 ASL ABX */
+UOP(3e) { int tmp; m6502_ICount -= 7; URD_ABX; ROL; WB_EA;  } /* 7 ROL ABX */
+UOP(5e) { int tmp; m6502_ICount -= 7; URD_ABX; LSR; WB_EA;  } /* 7 LSR ABX */
+UOP(7e) { int tmp; m6502_ICount -= 7; URD_ABX; ROR; WB_EA;  } /* 7 ROR ABX */
+UOP(be) { int tmp; m6502_ICount -= 4; URD_ABY; LDX;		  } /* 4 LDX ABY */
+UOP(de) { int tmp; m6502_ICount -= 7; URD_ABX; DEC; WB_EA;  } /* 7 DEC ABX */
+UOP(fe) { int tmp; m6502_ICount -= 7; URD_ABX; INC; WB_EA;  } /* 7 INC ABX */
+
+/* N and Z are kept aside, the flags are set by a later micro-op */
+#undef  SET_NZ
+#define SET_NZ(n) block_nz = (n)
+
+UOP_DEAD(a0) { int tmp; m6502_ICount -= 2; URD_IMM; LDY;		  } /* 2 LDY IMM */
+UOP_DEAD(01) { int tmp; m6502_ICount -= 6; URD_IDX; ORA;		  } /* 6 ORA IDX */
+UOP_DEAD(21) { int tmp; m6502_ICount -= 6; URD_IDX; AND;		  } /* 6 AND IDX */
+UOP_DEAD(41) { int tmp; m6502_ICount -= 6; URD_IDX; EOR;		  } /* 6 EOR IDX */
+UOP_DEAD(a1) { int tmp; m6502_ICount -= 6; URD_IDX; LDA;		  } /* 6 LDA IDX */
+UOP_DEAD(11) { int tmp; m6502_ICount -= 5; URD_IDY; ORA;		  } /* 5 ORA IDY */
+UOP_DEAD(31) { int tmp; m6502_ICount -= 5; URD_IDY; AND;		  } /* 5 AND IDY */
+UOP_DEAD(51) { int tmp; m6502_ICount -= 5; URD_IDY; EOR;		  } /* 5 EOR IDY */
+UOP_DEAD(b1) { int tmp; m6502_ICount -= 5; URD_IDY; LDA;		  } /* 5 LDA IDY */
+UOP_DEAD(a2) { int tmp; m6502_ICount -= 2; URD_IMM; LDX;		  } /* 2 LDX IMM */
+UOP_DEAD(a4) { int tmp; m6502_ICount -= 3; URD_ZPG; LDY;		  } /* 3 LDY ZPG */
+UOP_DEAD(b4) { int tmp; m6502_ICount -= 4; URD_ZPX; LDY;		  } /* 4 LDY ZPX */
+UOP_DEAD(05) { int tmp; m6502_ICount -= 3; URD_ZPG; ORA;		  } /* 3 ORA ZPG */
+UOP_DEAD(25) { int tmp; m6502_ICount -= 3; URD_ZPG; AND;		  } /* 3 AND ZPG */
+UOP_DEAD(45) { int tmp; m6502_ICount -= 3; URD_ZPG; EOR;		  } /* 3 EOR ZPG */
+UOP_DEAD(a5) { int tmp; m6502_ICount -= 3; URD_ZPG; LDA;		  } /* 3 LDA ZPG */
+UOP_DEAD(15) { int tmp; m6502_ICount -= 4; URD_ZPX; ORA;		  } /* 4 ORA ZPX */
+UOP_DEAD(35) { int tmp; m6502_ICount -= 4; URD_ZPX; AND;		  } /* 4 AND ZPX */
+UOP_DEAD(55) { int tmp; m6502_ICount -= 4; URD_ZPX; EOR;		  } /* 4 EOR ZPX */
+UOP_DEAD(b5) { int tmp; m6502_ICount -= 4; URD_ZPX; LDA;		  } /* 4 LDA ZPX */
+UOP_DEAD(a6) { int tmp; m6502_ICount -= 3; URD_ZPG; LDX;		  } /* 3 LDX ZPG */
+UOP_DEAD(b6) { int tmp; m6502_ICount -= 4; URD_ZPY; LDX;		  } /* 4 LDX ZPY */
+UOP_DEAD(88) {		  m6502_ICount -= 2;		 DEY;		  } /* 2 DEY */
+UOP_DEAD(a8) {		  m6502_ICount -= 2;		 TAY;		  } /* 2 TAY */
+UOP_DEAD(c8) {		  m6502_ICount -= 2;		 INY;		  } /* 2 INY */
+UOP_DEAD(e8) {		  m6502_ICount -= 2;		 INX;		  } /* 2 INX */
+UOP_DEAD(98) {		  m6502_ICount -= 2;		 TYA;		  } /* 2 TYA */
+UOP_DEAD(09) { int tmp; m6502_ICount -= 2; URD_IMM; ORA;		  } /* 2 ORA IMM */
+UOP_DEAD(29) { int tmp; m6502_ICount -= 2; URD_IMM; AND;		  } /* 2 AND IMM */
+UOP_DEAD(49) { int tmp; m6502_ICount -= 2; URD_IMM; EOR;		  } /* 2 EOR IMM */
+UOP_DEAD(a9) { int tmp; m6502_ICount -= 2; URD_IMM; LDA;		  } /* 2 LDA IMM */
+UOP_DEAD(19) { int tmp; m6502_ICount -= 4; URD_ABY; ORA;		  } /* 4 ORA ABY */
+UOP_DEAD(39) { int tmp; m6502_ICount -= 4; URD_ABY; AND;		  } /* 4 AND ABY */
+UOP_DEAD(59) { int tmp; m6502_ICount -= 4; URD_ABY; EOR;		  } /* 4 EOR ABY */
+UOP_DEAD(b9) { int tmp; m6502_ICount -= 4; URD_ABY; LDA;		  } /* 4 LDA ABY */
+UOP_DEAD(8a) {		  m6502_ICount -= 2;		 TXA;		  } /* 2 TXA */
+UOP_DEAD(aa) {		  m6502_ICount -= 2;		 TAX;		  } /* 2 TAX */
+UOP_DEAD(ca) {		  m6502_ICount -= 2;		 DEX;		  } /* 2 DEX */
+UOP_DEAD(ac) { int tmp; m6502_ICount -= 4; URD_ABS; LDY;		  } /* 4 LDY ABS */
+UOP_DEAD(bc) { int tmp; m6502_ICount -= 4; URD_ABX; LDY;		  } /* 4 LDY ABX */
+UOP_DEAD(0d) { int tmp; m6502_ICount -= 4; URD_ABS; ORA;		  } /* 4 ORA ABS */
+UOP_DEAD(2d) { int tmp; m6502_ICount -= 4; URD_ABS; AND;		  } /* 4 AND ABS */
+UOP_DEAD(4d) { int tmp; m6502_ICount -= 4; URD_ABS; EOR;		  } /* 4 EOR ABS */
+UOP_DEAD(ad) { int tmp; m6502_ICount -= 4; URD_ABS; LDA;		  } /* 4 LDA ABS */
+UOP_DEAD(1d) { int tmp; m6502_ICount -= 4; URD_ABX; ORA;		  } /* 4 ORA ABX */
+UOP_DEAD(3d) { int tmp; m6502_ICount -= 4; URD_ABX; AND;		  } /* 4 AND ABX */
+UOP_DEAD(5d) { int tmp; m6502_ICount -= 4; URD_ABX; EOR;		  } /* 4 EOR ABX */
+UOP_DEAD(bd) { int tmp; m6502_ICount -= 4; URD_ABX; LDA;		  } /* 4 LDA ABX */
+UOP_DEAD(ae) { int tmp; m6502_ICount -= 4; URD_ABS; LDX;		  } /* 4 LDX ABS */
+UOP_DEAD(be) { int tmp; m6502_ICount -= 4; URD_ABY; LDX;		  } /* 4 LDX ABY */
+
+#undef  SET_NZ
+#define SET_NZ(n)				\
+	if ((n) == 0) P = (P & ~F_N) | F_Z; else P = (P & ~(F_N | F_Z)) | ((n) & F_N)
+
+static const m6502_uop_info uop_info[256] = {
+	[0x01] = {m6502_uop_01, m6502_uop_01_dead, 2, TRUE},
+	[0x05] = {m6502_uop_05, m6502_uop_05_dead, 2, TRUE},
+	[0x06] = {m6502_uop_06, NULL, 2, TRUE},
+	[0x09] = {m6502_uop_09, m6502_uop_09_dead, 2, TRUE},
+	[0x0a] = {m6502_uop_0a, NULL, 1, TRUE},
+	[0x0d] = {m6502_uop_0d, m6502_uop_0d_dead, 3, TRUE},
+	[0x0e] = {m6502_uop_0e, NULL, 3, TRUE},
+	[0x11] = {m6502_uop_11, m6502_uop_11_dead, 2, TRUE},
+	[0x15] = {m6502_uop_15, m6502_uop_15_dead, 2, TRUE},
+	[0x16] = {m6502_uop_16, NULL, 2, TRUE},
+	[0x18] = {m6502_uop_18, NULL, 1, FALSE},
+	[0x19] = {m6502_uop_19, m6502_uop_19_dead, 3, TRUE},
+	[0x1d] = {m6502_uop_1d, m6502_uop_1d_dead, 3, TRUE},
+	[0x1e] = {m6502_uop_1e, NULL, 3, TRUE},
+	[0x21] = {m6502_uop_21, m6502_uop_21_dead, 2, TRUE},
+	[0x24] = {m6502_uop_24, NULL, 2, TRUE},
+	[0x25] = {m6502_uop_25, m6502_uop_25_dead, 2, TRUE},
+	[0x26] = {m6502_uop_26, NULL, 2, TRUE},
+	[0x29] = {m6502_uop_29, m6502_uop_29_dead, 2, TRUE},
+	[0x2a] = {m6502_uop_2a, NULL, 1, TRUE},
+	[0x2c] = {m6502_uop_2c, NULL, 3, TRUE},
+	[0x2d] = {m6502_uop_2d, m6502_uop_2d_dead, 3, TRUE},
+	[0x2e] = {m6502_uop_2e, NULL, 3, TRUE},
+	[0x31] = {m6502_uop_31, m6502_uop_31_dead, 2, TRUE},
+	[0x35] = {m6502_uop_35, m6502_uop_35_dead, 2, TRUE},
+	[0x36] = {m6502_uop_36, NULL, 2, TRUE},
+	[0x38] = {m6502_uop_38, NULL, 1, FALSE},
+	[0x39] = {m6502_uop_39, m6502_uop_39_dead, 3, TRUE},
+	[0x3d] = {m6502_uop_3d, m6502_uop_3d_dead, 3, TRUE},
+	[0x3e] = {m6502_uop_3e, NULL, 3, TRUE},
+	[0x41] = {m6502_uop_41, m6502_uop_41_dead, 2, TRUE},
+	[0x45] = {m6502_uop_45, m6502_uop_45_dead, 2, TRUE},
+	[0x46] = {m6502_uop_46, NULL, 2, TRUE},
+	[0x48] = {m6502_uop_48, NULL, 1, FALSE},
+	[0x49] = {m6502_uop_49, m6502_uop_49_dead, 2, TRUE},
+	[0x4a] = {m6502_uop_4a, NULL, 1, TRUE},
+	[0x4d] = {m6502_uop_4d, m6502_uop_4d_dead, 3, TRUE},
+	[0x4e] = {m6502_uop_4e, NULL, 3, TRUE},
+	[0x51] = {m6502_uop_51, m6502_uop_51_dead, 2, TRUE},
+	[0x55] = {m6502_uop_55, m6502_uop_55_dead, 2, TRUE},
+	[0x56] = {m6502_uop_56, NULL, 2, TRUE},
+	[0x59] = {m6502_uop_59, m6502_uop_59_dead, 3, TRUE},
+	[0x5d] = {m6502_uop_5d, m6502_uop_5d_dead, 3, TRUE},
+	[0x5e] = {m6502_uop_5e, NULL, 3, TRUE},
+	[0x61] = {m6502_uop_61, NULL, 2, TRUE},
+	[0x65] = {m6502_uop_65, NULL, 2, TRUE},
+	[0x66] = {m6502_uop_66, NULL, 2, TRUE},
+	[0x68] = {m6502_uop_68, NULL, 1, TRUE},
+	[0x69] = {m6502_uop_69, NULL, 2, TRUE},
+	[0x6a] = {m6502_uop_6a, NULL, 1, TRUE},
+	[0x6d] = {m6502_uop_6d, NULL, 3, TRUE},
+	[0x6e] = {m6502_uop_6e, NULL, 3, TRUE},
+	[0x71] = {m6502_uop_71, NULL, 2, TRUE},
+	[0x75] = {m6502_uop_75, NULL, 2, TRUE},
+	[0x76] = {m6502_uop_76, NULL, 2, TRUE},
+	[0x79] = {m6502_uop_79, NULL, 3, TRUE},
+	[0x7d] = {m6502_uop_7d, NULL, 3, TRUE},
+	[0x7e] = {m6502_uop_7e, NULL, 3, TRUE},
+	[0x81] = {m6502_uop_81, NULL, 2, FALSE},
+	[0x84] = {m6502_uop_84, NULL, 2, FALSE},
+	[0x85] = {m6502_uop_85, NULL, 2, FALSE},
+	[0x86] = {m6502_uop_86, NULL, 2, FALSE},
+	[0x88] = {m6502_uop_88, m6502_uop_88_dead, 1, TRUE},
+	[0x8a] = {m6502_uop_8a, m6502_uop_8a_dead, 1, TRUE},
+	[0x8c] = {m6502_uop_8c, NULL, 3, FALSE},
+	[0x8d] = {m6502_uop_8d, NULL, 3, FALSE},
+	[0x8e] = {m6502_uop_8e, NULL, 3, FALSE},
+	[0x91] = {m6502_uop_91, NULL, 2, FALSE},
+	[0x94] = {m6502_uop_94, NULL, 2, FALSE},
+	[0x95] = {m6502_uop_95, NULL, 2, FALSE},
+	[0x96] = {m6502_uop_96, NULL, 2, FALSE},
+	[0x98] = {m6502_uop_98, m6502_uop_98_dead, 1, TRUE},
+	[0x99] = {m6502_uop_99, NULL, 3, FALSE},
+	[0x9a] = {m6502_uop_9a, NULL, 1, FALSE},
+	[0x9d] = {m6502_uop_9d, NULL, 3, FALSE},
+	[0xa0] = {m6502_uop_a0, m6502_uop_a0_dead, 2, TRUE},
+	[0xa1] = {m6502_uop_a1, m6502_uop_a1_dead, 2, TRUE},
+	[0xa2] = {m6502_uop_a2, m6502_uop_a2_dead, 2, TRUE},
+	[0xa4] = {m6502_uop_a4, m6502_uop_a4_dead, 2, TRUE},
+	[0xa5] = {m6502_uop_a5, m6502_uop_a5_dead, 2, TRUE},
+	[0xa6] = {m6502_uop_a6, m6502_uop_a6_dead, 2, TRUE},
+	[0xa8] = {m6502_uop_a8, m6502_uop_a8_dead, 1, TRUE},
+	[0xa9] = {m6502_uop_a9, m6502_uop_a9_dead, 2, TRUE},
+	[0xaa] = {m6502_uop_aa, m6502_uop_aa_dead, 1, TRUE},
+	[0xac] = {m6502_uop_ac, m6502_uop_ac_dead, 3, TRUE},
+	[0xad] = {m6502_uop_ad, m6502_uop_ad_dead, 3, TRUE},
+	[0xae] = {m6502_uop_ae, m6502_uop_ae_dead, 3, TRUE},
+	[0xb1] = {m6502_uop_b1, m6502_uop_b1_dead, 2, TRUE},
+	[0xb4] = {m6502_uop_b4, m6502_uop_b4_dead, 2, TRUE},
+	[0xb5] = {m6502_uop_b5, m6502_uop_b5_dead, 2, TRUE},
+	[0xb6] = {m6502_uop_b6, m6502_uop_b6_dead, 2, TRUE},
+	[0xb8] = {m6502_uop_b8, NULL, 1, FALSE},
+	[0xb9] = {m6502_uop_b9, m6502_uop_b9_dead, 3, TRUE},
+	[0xba] = {m6502_uop_ba, NULL, 1, TRUE},
+	[0xbc] = {m6502_uop_bc, m6502_uop_bc_dead, 3, TRUE},
+	[0xbd] = {m6502_uop_bd, m6502_uop_bd_dead, 3, TRUE},
+	[0xbe] = {m6502_uop_be, m6502_uop_be_dead, 3, TRUE},
+	[0xc0] = {m6502_uop_c0, NULL, 2, TRUE},
+	[0xc1] = {m6502_uop_c1, NULL, 2, TRUE},
+	[0xc4] = {m6502_uop_c4, NULL, 2, TRUE},
+	[0xc5] = {m6502_uop_c5, NULL, 2, TRUE},
+	[0xc6] = {m6502_uop_c6, NULL, 2, TRUE},
+	[0xc8] = {m6502_uop_c8, m6502_uop_c8_dead, 1, TRUE},
+	[0xc9] = {m6502_uop_c9, NULL, 2, TRUE},
+	[0xca] = {m6502_uop_ca, m6502_uop_ca_dead, 1, TRUE},
+	[0xcc] = {m6502_uop_cc, NULL, 3, TRUE},
+	[0xcd] = {m6502_uop_cd, NULL, 3, TRUE},
+	[0xce] = {m6502_uop_ce, NULL, 3, TRUE},
+	[0xd1] = {m6502_uop_d1, NULL, 2, TRUE},
+	[0xd5] = {m6502_uop_d5, NULL, 2, TRUE},
+	[0xd6] = {m6502_uop_d6, NULL, 2, TRUE},
+	[0xd8] = {m6502_uop_d8, NULL, 1, FALSE},
+	[0xd9] = {m6502_uop_d9, NULL, 3, TRUE},
+	[0xdd] = {m6502_uop_dd, NULL, 3, TRUE},
+	[0xde] = {m6502_uop_de, NULL, 3, TRUE},
+	[0xe0] = {m6502_uop_e0, NULL, 2, TRUE},
+	[0xe1] = {m6502_uop_e1, NULL, 2, TRUE},
+	[0xe4] = {m6502_uop_e4, NULL, 2, TRUE},
+	[0xe5] = {m6502_uop_e5, NULL, 2, TRUE},
+	[0xe6] = {m6502_uop_e6, NULL, 2, TRUE},
+	[0xe8] = {m6502_uop_e8, m6502_uop_e8_dead, 1, TRUE},
+	[0xe9] = {m6502_uop_e9, NULL, 2, TRUE},
+	[0xea] = {m6502_uop_ea, NULL, 1, FALSE},
+	[0xec] = {m6502_uop_ec, NULL, 3, TRUE},
+	[0xed] = {m6502_uop_ed, NULL, 3, TRUE},
+	[0xee] = {m6502_uop_ee, NULL, 3, TRUE},
+	[0xf1] = {m6502_uop_f1, NULL, 2, TRUE},
+	[0xf5] = {m6502_uop_f5, NULL, 2, TRUE},
+	[0xf6] = {m6502_uop_f6, NULL, 2, TRUE},
+	[0xf8] = {m6502_uop_f8, NULL, 1, FALSE},
+	[0xf9] = {m6502_uop_f9, NULL, 3, TRUE},
+	[0xfd] = {m6502_uop_fd, NULL, 3, TRUE},
+	[0xfe] = {m6502_uop_fe, NULL, 3, TRUE},
+};
+
+/***************************************************************
+ * block cache
+ ***************************************************************/
+
+/* RAM only, the VRAM window and the registers can change under the same address */
+static INLINE bool m6502_block_cacheable(unsigned addr)
+{
+	return addr < 0x10000 && (addr < 0x9000 || addr >= 0xE000);
+}
+
+static void m6502_block_flush(void)
+{
+	memset(block_cache, 0, sizeof(block_cache));
+	memset(block_code,  0, sizeof(block_code));
+	block_pool_used = 0;
+	for(int page = 0; page < 0x100; page++)
+		watch_pages[page] &= ~WATCH_CODE;
+	m6502_aot_flush();
+}
+
+static void m6502_block_mark_code(unsigned addr, unsigned size)
+{
+	for(unsigned i = 0; i < size; i++)
+	{
+		block_code[addr + i] = 1;
+		watch_pages[(addr + i) >> 8] |= WATCH_CODE;
+	}
+}
+
+static m6502_block *m6502_block_build(UINT16 pc)
+{
+	if (!m6502_block_cacheable(pc) || uop_info[cpu_readop(pc)].exec == NULL)
+	{
+		/* remembered so the opcode is not decoded again, a write to it drops it */
+		if (m6502_block_cacheable(pc)) m6502_block_mark_code(pc, 1);
+		block_cache[pc] = &block_empty;
+		return &block_empty;
+	}
+
+	if (block_pool_used == BLOCK_POOL_SIZE) m6502_block_flush();
+	m6502_block *b = &block_pool[block_pool_used++];
+
+	const m6502_uop_info *info[BLOCK_MAX_UOPS];
+	unsigned addr = pc;
+	b->count = 0;
+	while (b->count < BLOCK_MAX_UOPS)
+	{
+		const m6502_uop_info *i = &uop_info[cpu_readop(addr)];
+		if (i->exec == NULL || !m6502_block_cacheable(addr + i->size - 1)) break;
+
+		m6502_uop *u = &b->uops[b->count];
+		u->exec = i->exec;
+		u->arg  = 0;
+		if (i->size > 1) u->arg  = cpu_readop_arg(addr + 1);
+		if (i->size > 2) u->arg |= cpu_readop_arg(addr + 2) << 8;
+		u->next = addr + i->size;
+
+		info[b->count++] = i;
+		addr += i->size;
+	}
+	m6502_block_mark_code(pc, addr - pc);
+
+	/* N and Z are dead when a later micro-op sets them again */
+	bool dead[BLOCK_MAX_UOPS];
+	bool later_writer = FALSE;
+	for(int n = b->count - 1; n >= 0; n--)
+	{
+		dead[n] = FALSE;
+		if (!info[n]->writes_nz) continue;
+		if (later_writer && info[n]->exec_dead)
+		{
+			b->uops[n].exec = info[n]->exec_dead;
+			dead[n] = TRUE;
+		}
+		later_writer = TRUE;
+	}
+
+	bool nz_fix = FALSE;
+	for(int n = 0; n < b->count; n++)
+	{
+		if (info[n]->writes_nz) nz_fix = dead[n];
+		b->uops[n].nz_fix = nz_fix;
+	}
+
+	block_cache[pc] = b;
+	return b;
+}
+
+/* drop the blocks that hold the written bytes */
+void m6502_code_write(unsigned addr, unsigned size)
+{
+	for(unsigned a = addr; a < addr + size && a < 0x10000; a++)
+	{
+		if (!block_code[a]) continue;
+		block_code[a] = 0;
+
+		unsigned first = a >= BLOCK_MAX_BYTES - 1 ? a - (BLOCK_MAX_BYTES - 1) : 0;
+		for(unsigned pc = first; pc <= a; pc++)
+			block_cache[pc] = NULL;
+		m6502_aot_code_write(a);
+		block_abort = TRUE;
+	}
+}
+
+void m6502_set_blocks(int enabled)
+{
+	m6502_blocks_enabled = enabled;
+	m6502_block_flush();
+}
+
+/*
+ * run the block at PC, returns FALSE if there is none
+ * called from the plain loop with the same conditions as an instruction
+ */
+static int m6502_block_run(void)
+{
+	if (!m6502_blocks_enabled) return FALSE;
+
+	m6502_block *b = block_cache[PCW];
+	if (!b) b = m6502_block_build(PCW);
+	if (!b->count) return FALSE;
+
+	UINT16 start = PCW;
+	const m6502_uop *u   = b->uops;
+	const m6502_uop *end = u + b->count;
+
+	block_abort = FALSE;
+	for(;;)
+	{
+		PCW = u->next;
+		u->exec(u);
+		if (++u == end || m6502_ICount <= 0 || m6502.pending_irq || block_abort) break;
+	}
+
+	if (u[-1].nz_fix)
+	{
+		SET_NZ(block_nz);
+	}
+	PPC = u - 1 == b->uops ? start : u[-2].next;
+	return TRUE;
+}
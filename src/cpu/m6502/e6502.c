@@ -0,0 +1,106 @@
+/*****************************************************************************
+ *
+ *	 e6502.c
+ *	 6502 execution loop, included three times by m6502.c:
+ *
+ *	 M6502_INSTRUMENTED 0  plain loop, no debugger or trace hooks
+ *	 M6502_COVERAGE     1  plain loop that also marks the coverage map
+ *	 M6502_INSTRUMENTED 1  calls cpu_instruction_hook() before each
+ *	                       instruction, runs while cpu_instrumented is set
+ *
+ *	 The plain loop leaves on a BRK with the PC still at the BRK opcode,
+ *	 so the instrumented loop can stop there.
+ *
+ *	 Only the plain loop runs native OS routines, translated code and
+ *	 cached blocks, see hle.c, a6502.c and b6502.c
+ *
+ *	 The loops run until m6502_ICount is exhausted or the mode changes,
+ *	 m6502_execute switches between them.
+ *
+ *****************************************************************************/
+
+#if M6502_INSTRUMENTED
+static void m6502_execute_instrumented(void)
+#elif M6502_COVERAGE
+static void m6502_execute_coverage(void)
+#else
+static void m6502_execute_plain(void)
+#endif
+{
+	do
+	{
+		UINT8 op;
+		PPC = PCD;
+
+		/* if an irq is pending, take it now */
+		if( m6502.pending_irq )
+			m6502_take_irq();
+
+#if M6502_INSTRUMENTED
+		/* after the irq so the hook sees the first instruction of the handler */
+		cpu_instruction_hook(PCD);
+#endif
+
+#if !M6502_INSTRUMENTED && !M6502_COVERAGE
+		/* OS routines run in C, see hle.c */
+		if( hle_pages[PCH] && m6502.subtype == SUBTYPE_6502 )
+		{
+			int cycles = hle_run(PCW);
+			if( cycles )
+			{
+				m6502_ICount -= cycles;
+				continue;
+			}
+		}
+
+		/* translated or cached straight line code, the instruction that ends it runs below */
+		if( m6502.subtype == SUBTYPE_6502 && (m6502_aot_run() || m6502_block_run()) )
+		{
+			if( m6502.pending_irq )
+				m6502_take_irq();
+			continue;
+		}
+#endif
+
+		op = RDOP();
+
+#if !M6502_INSTRUMENTED
+		if( op == 0x00 )
+		{
+			PCW--;
+			cpu_instrumented = TRUE;
+			break;
+		}
+#endif
+
+#if M6502_COVERAGE
+		coverage_insn(PCW - 1, op);
+#endif
+
+		(*m6502.insn[op])();
+
+		/* check if the I flag was just reset (interrupts enabled) */
+		if( m6502.after_cli )
+		{
+			LOG(("M6502#%d after_cli was >0", cpu_getactivecpu()));
+			m6502.after_cli = 0;
+			if (m6502.irq_state != CLEAR_LINE)
+			{
+				LOG((": irq line is asserted: set pending IRQ\n"));
+				m6502.pending_irq = 1;
+			}
+			else
+			{
+				LOG((": irq line is clear\n"));
+			}
+		}
+		else
+		if( m6502.pending_irq )
+			m6502_take_irq();
+
+#if M6502_INSTRUMENTED
+	} while (m6502_ICount > 0 && cpu_instrumented);
+#else
+	} while (m6502_ICount > 0);
+#endif
+}
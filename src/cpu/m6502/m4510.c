@@ -101,9 +101,9 @@ z:      xxxx address bits a19 .. a16 for memory accesses with a15 1 ?
  */
 
 #include <stdio.h>
-#include "driver.h"
-#include "state.h"
-#include "mamedbg.h"
+#include "../../emu.h"
+#include "../cpu_interface.h"
+#include "../../coverage.h"
 #include "m6502.h"
 #include "m4510.h"
 
@@ -360,12 +360,14 @@ int m4510_execute(int cycles)
 		UINT8 op;
 		PPC = PCD;
 
-		CALL_MAME_DEBUG;
-
 		/* if an irq is pending, take it now */
 		if( m4510.pending_irq )
 			m4510_take_irq();
 
+		/* a single loop, the hook also marks the coverage map and stops on BRK */
+		if( cpu_instrumented || coverage_enabled || PEEK_OP() == 0x00 )
+			cpu_instruction_hook(PCD);
+
 		op = RDOP();
 		(*insn4510[op])();
 
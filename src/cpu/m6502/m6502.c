@@ -25,11 +25,16 @@
 /* 13.September 2000 PeT N2A03 jmp indirect */
 
 #include <stdio.h>
+#include <string.h>
 #include "m6502.h"
+#define M6502_IDLE_CHECK() m6502_idle_check()
 #include "ops02.h"
 #include "ill02.h"
 #include "../../emu.h"
 #include "../../trace.h"
+#include "../../coverage.h"
+#include "../../watch.h"
+#include "../../hle.h"
 #include "../cpu_interface.h"
 
 #define LOGTAG "6502"
@@ -134,10 +139,97 @@ int m6502_ICount = 0;
 
 static m6502_Regs m6502;
 
+/***************************************************************
+ * idle loop detection
+ *
+ * A taken backward branch closing a short loop that only loads, compares
+ * and branches is waiting on memory or device registers. When registers
+ * are unchanged after a full iteration, the next ones will be the same
+ * until an external event, so the core reports the CPU as idle and
+ * cpuexec skips cycles until it is woken.
+ ***************************************************************/
+#define IDLE_LOOP_MAX_SIZE 16
+
+/* sizes of the instructions allowed in an idle loop, 0 for the rest */
+static const UINT8 idle_opcode_size[256] = {
+	/* LDA LDX LDY */
+	[0xA9] = 2, [0xA5] = 2, [0xB5] = 2, [0xAD] = 3, [0xBD] = 3, [0xB9] = 3, [0xA1] = 2, [0xB1] = 2,
+	[0xA2] = 2, [0xA6] = 2, [0xB6] = 2, [0xAE] = 3, [0xBE] = 3,
+	[0xA0] = 2, [0xA4] = 2, [0xB4] = 2, [0xAC] = 3, [0xBC] = 3,
+	/* CMP CPX CPY BIT */
+	[0xC9] = 2, [0xC5] = 2, [0xD5] = 2, [0xCD] = 3, [0xDD] = 3, [0xD9] = 3, [0xC1] = 2, [0xD1] = 2,
+	[0xE0] = 2, [0xE4] = 2, [0xEC] = 3,
+	[0xC0] = 2, [0xC4] = 2, [0xCC] = 3,
+	[0x24] = 2, [0x2C] = 3,
+	/* AND ORA EOR */
+	[0x29] = 2, [0x25] = 2, [0x35] = 2, [0x2D] = 3, [0x3D] = 3, [0x39] = 3, [0x21] = 2, [0x31] = 2,
+	[0x09] = 2, [0x05] = 2, [0x15] = 2, [0x0D] = 3, [0x1D] = 3, [0x19] = 3, [0x01] = 2, [0x11] = 2,
+	[0x49] = 2, [0x45] = 2, [0x55] = 2, [0x4D] = 3, [0x5D] = 3, [0x59] = 3, [0x41] = 2, [0x51] = 2,
+	/* branches, NOP */
+	[0x10] = 2, [0x30] = 2, [0x50] = 2, [0x70] = 2, [0x90] = 2, [0xB0] = 2, [0xD0] = 2, [0xF0] = 2,
+	[0xEA] = 1,
+};
+
+static struct {
+	UINT16 start;
+	UINT16 branch;
+	bool   pure;
+	bool   seen;    /* registers below are from a previous iteration */
+	UINT8  a, x, y, p;
+} idle_loop;
+
+static bool m6502_is_idle_loop(UINT16 start, UINT16 branch)
+{
+	if (branch - start > IDLE_LOOP_MAX_SIZE) return FALSE;
+
+	UINT16 addr = start;
+	while (addr < branch) {
+		UINT8 size = idle_opcode_size[cpu_readop(addr)];
+		if (size == 0) return FALSE;
+		addr += size;
+	}
+	return addr == branch;
+}
+
+/* called on taken backward branches, PPC is the branch and PC the loop start */
+static void m6502_idle_check(void)
+{
+	if (cpu_instrumented || m6502.pending_irq || m6502.after_cli) return;
+
+	if (idle_loop.start != PCW || idle_loop.branch != PPC)
+	{
+		idle_loop.start  = PCW;
+		idle_loop.branch = PPC;
+		idle_loop.pure   = m6502_is_idle_loop(PCW, PPC);
+		idle_loop.seen   = FALSE;
+	}
+	if (!idle_loop.pure) return;
+
+	if (idle_loop.seen && idle_loop.a == m6502.a && idle_loop.x == m6502.x
+		&& idle_loop.y == m6502.y && idle_loop.p == m6502.p)
+	{
+		idle_loop.seen = FALSE;
+		if (m6502_ICount > 0)
+		{
+			cpu_idle_enter(m6502_ICount);
+			m6502_ICount = 0;
+		}
+		return;
+	}
+
+	idle_loop.seen = TRUE;
+	idle_loop.a = m6502.a;
+	idle_loop.x = m6502.x;
+	idle_loop.y = m6502.y;
+	idle_loop.p = m6502.p;
+}
+
 /***************************************************************
  * include the opcode macros, functions and tables
  ***************************************************************/
 #include "t6502.c"
+#include "b6502.c"
+#include "a6502.c"
 
 #if (HAS_M6510)
 #include "t6510.c"
@@ -191,6 +283,7 @@ void m6502_init(void)
 	m6502.subtype = SUBTYPE_6502;
 	m6502.insn = insn6502;
 	m6502_state_register("m6502");
+	m6502_aot_init();
 }
 
 void m6502_reset(void *param)
@@ -302,6 +395,10 @@ static INLINE void m6502_take_irq(void)
 		PUSH(PCL);
 		PUSH(P & ~F_B);
 		P |= F_I;		/* set I flag */
+#if (HAS_M65C02)
+		if( m6502.subtype == SUBTYPE_65C02 )
+			P &= ~F_D;	/* the 65C02 also knocks out D */
+#endif
 		PCL = RDMEM(EAD);
 		PCH = RDMEM(EAD+1);
 		LOG(("M6502#%d takes IRQ ($%04x)\n", cpu_getactivecpu(), PCD));
@@ -313,59 +410,72 @@ static INLINE void m6502_take_irq(void)
 	m6502.pending_irq = 0;
 }
 
+/* plain, coverage and instrumented variants of the execution loop */
+#define M6502_INSTRUMENTED 0
+#define M6502_COVERAGE     0
+#include "e6502.c"
+#undef  M6502_COVERAGE
+
+#define M6502_COVERAGE     1
+#include "e6502.c"
+#undef  M6502_COVERAGE
+#undef  M6502_INSTRUMENTED
+
+#define M6502_INSTRUMENTED 1
+#include "e6502.c"
+#undef  M6502_INSTRUMENTED
+
+/* cycles put aside by m6502_switch_loop */
+static int m6502_ICount_deferred = 0;
+
 int m6502_execute(int cycles)
 {
 	m6502_ICount = cycles;
+	m6502_ICount_deferred = 0;
 
 	do
 	{
-		UINT8 op;
-		PPC = PCD;
-		change_pc16(PCD);
-
-		/* CALL_MAME_DEBUG; */
-
-#if 1
-		/* if an irq is pending, take it now */
-		if( m6502.pending_irq )
-			m6502_take_irq();
+		if (cpu_instrumented)
+			m6502_execute_instrumented();
+		else if (coverage_enabled)
+			m6502_execute_coverage();
+		else
+			m6502_execute_plain();
 
-		op = RDOP();
-		(*m6502.insn[op])();
-#else
-		/* thought as irq request while executing sei */
-        /* sei sets I flag on the stack*/
-		op = RDOP();
+		m6502_ICount += m6502_ICount_deferred;
+		m6502_ICount_deferred = 0;
+	} while (m6502_ICount > 0);
 
-		/* if an irq is pending, take it now */
-		if( m6502.pending_irq && (op == 0x78) )
-			m6502_take_irq();
+	return cycles - m6502_ICount;
+}
 
-		(*m6502.insn[op])();
-#endif
+int m6502_get_cycles_left(void)
+{
+	return m6502_ICount + m6502_ICount_deferred;
+}
 
-		/* check if the I flag was just reset (interrupts enabled) */
-		if( m6502.after_cli )
-		{
-			LOG(("M6502#%d after_cli was >0", cpu_getactivecpu()));
-			m6502.after_cli = 0;
-			if (m6502.irq_state != CLEAR_LINE)
-			{
-				LOG((": irq line is asserted: set pending IRQ\n"));
-				m6502.pending_irq = 1;
-			}
-			else
-			{
-				LOG((": irq line is clear\n"));
-			}
-		}
-		else
-		if( m6502.pending_irq )
-			m6502_take_irq();
+/* registers in the order A X Y P S, for the execution trace */
+void m6502_get_trace_regs(unsigned char *regs)
+{
+	regs[0] = m6502.a;
+	regs[1] = m6502.x;
+	regs[2] = m6502.y;
+	regs[3] = m6502.p;
+	regs[4] = m6502.sp.b.l;
+}
 
-	} while (m6502_ICount > 0);
+/* end the running loop after the current instruction, m6502_execute picks the loop again */
+void m6502_switch_loop(void)
+{
+	m6502_ICount_deferred += m6502_ICount;
+	m6502_ICount = 0;
+}
 
-	return cycles - m6502_ICount;
+/* end the run after the current instruction, the cycles left are dropped */
+void m6502_abort_timeslice(void)
+{
+	m6502_ICount_deferred = 0;
+	m6502_ICount = 0;
 }
 
 void m6502_set_irq_line(int irqline, int state)
@@ -668,69 +778,10 @@ void m65c02_reset (void *param)
 
 void m65c02_exit  (void) { m6502_exit(); }
 
-static INLINE void m65c02_take_irq(void)
-{
-	if( !(P & F_I) )
-	{
-		EAD = M6502_IRQ_VEC;
-		m6502_ICount -= 7;
-		PUSH(PCH);
-		PUSH(PCL);
-		PUSH(P & ~F_B);
-		P = (P & ~F_D) | F_I;		/* knock out D and set I flag */
-		PCL = RDMEM(EAD);
-		PCH = RDMEM(EAD+1);
-		LOG(("M65c02#%d takes IRQ ($%04x)\n", cpu_getactivecpu(), PCD));
-		/* call back the cpuintrf to let it clear the line */
-		if (m6502.irq_callback) (*m6502.irq_callback)(0);
-		change_pc16(PCD);
-	}
-	m6502.pending_irq = 0;
-}
-
+/* the same loops as the 6502, they follow m6502.insn and take the IRQ as a 65C02 */
 int m65c02_execute(int cycles)
 {
-	m6502_ICount = cycles;
-
-	change_pc16(PCD);
-
-	do
-	{
-		UINT8 op;
-		PPC = PCD;
-
-		CALL_MAME_DEBUG;
-
-		op = RDOP();
-		(*m6502.insn[op])();
-
-		/* if an irq is pending, take it now */
-		if( m6502.pending_irq )
-			m65c02_take_irq();
-
-
-		/* check if the I flag was just reset (interrupts enabled) */
-		if( m6502.after_cli )
-		{
-			LOG(("M6502#%d after_cli was >0", cpu_getactivecpu()));
-			m6502.after_cli = 0;
-			if (m6502.irq_state != CLEAR_LINE)
-			{
-				LOG((": irq line is asserted: set pending IRQ\n"));
-				m6502.pending_irq = 1;
-			}
-			else
-			{
-				LOG((": irq line is clear\n"));
-			}
-		}
-		else
-		if( m6502.pending_irq )
-			m65c02_take_irq();
-
-	} while (m6502_ICount > 0);
-
-	return cycles - m6502_ICount;
+	return m6502_execute(cycles);
 }
 
 unsigned m65c02_get_context (void *dst) { return m6502_get_context(dst); }
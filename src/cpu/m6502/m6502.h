@@ -76,6 +76,13 @@ extern void m6502_set_context(void *src);
 extern unsigned m6502_get_reg(int regnum);
 extern void m6502_set_reg(int regnum, unsigned val);
 extern void m6502_set_irq_line(int irqline, int state);
+extern void m6502_switch_loop(void);
+extern void m6502_abort_timeslice(void);
+extern int  m6502_get_cycles_left(void);
+extern void m6502_get_trace_regs(unsigned char *regs);
+extern void m6502_set_blocks(int enabled);
+extern void m6502_code_write(unsigned addr, unsigned size);
+extern void m6502_set_aot(int enabled);
 extern void m6502_set_irq_callback(int (*callback)(int irqline));
 extern const char *m6502_info(void *context, int regnum);
 extern unsigned m6502_dasm(char *buffer, unsigned pc);
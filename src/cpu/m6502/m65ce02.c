@@ -38,15 +38,22 @@
 */
 
 #include <stdio.h>
-#include "driver.h"
-#include "state.h"
-#include "mamedbg.h"
+#include "../../emu.h"
+#include "../cpu_interface.h"
+#include "../../coverage.h"
 #include "m65ce02.h"
 
 #include "ops02.h"
 #include "opsc02.h"
 #include "opsce02.h"
 
+#define M6502_NMI_VEC	0xfffa
+#define M6502_RST_VEC	0xfffc
+#define M6502_IRQ_VEC	0xfffe
+#define M65CE02_RST_VEC	M6502_RST_VEC
+#define M65CE02_IRQ_VEC	M6502_IRQ_VEC
+#define M65CE02_NMI_VEC	M6502_NMI_VEC
+
 #define VERBOSE 0
 
 #if VERBOSE
@@ -250,12 +257,14 @@ int m65ce02_execute(int cycles)
 		UINT8 op;
 		PPC = PCD;
 
-		CALL_MAME_DEBUG;
-
 		/* if an irq is pending, take it now */
 		if( m65ce02.pending_irq )
 			m65ce02_take_irq();
 
+		/* a single loop, the hook also marks the coverage map and stops on BRK */
+		if( cpu_instrumented || coverage_enabled || PEEK_OP() == 0x00 )
+			cpu_instruction_hook(PCD);
+
 		op = RDOP();
 		(*insn65ce02[op])();
 
@@ -322,7 +331,6 @@ void m65ce02_set_irq_callback(int (*callback)(int))
 
 void m65ce02_state_save(void *file)
 {
-	int cpu = cpu_getactivecpu();
 	/* insn is set at restore since it's a pointer */
 	state_save_UINT16(file,"m65ce02",cpu,"PC",&m65ce02.pc.w.l,2);
 	state_save_UINT16(file,"m65ce02",cpu,"SP",&m65ce02.sp.w.l,2);
@@ -340,7 +348,6 @@ void m65ce02_state_save(void *file)
 
 void m65ce02_state_load(void *file)
 {
-	int cpu = cpu_getactivecpu();
 	m65ce02.insn = insn65ce02;
 	state_load_UINT16(file,"m65ce02",cpu,"PC",&m65ce02.pc.w.l,2);
 	state_load_UINT16(file,"m65ce02",cpu,"SP",&m65ce02.sp.w.l,2);
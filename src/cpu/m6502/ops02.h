@@ -105,6 +105,11 @@ extern	UINT8	*RAM;
 #define WRMEM(addr,data) cpu_writemem16(addr,data)
 #endif
 
+/* cores with idle loop detection define this, see m6502.c */
+#ifndef M6502_IDLE_CHECK
+#define M6502_IDLE_CHECK()
+#endif
+
 /***************************************************************
  *	BRA  branch relative
  *	extra cycle if page boundary is crossed
@@ -117,6 +122,8 @@ extern	UINT8	*RAM;
 		m6502_ICount -= (PCH == EAH) ? 3 : 4;					\
 		PCD = EAD;												\
 		CHANGE_PC;												\
+		if( PCW < PPC )											\
+			M6502_IDLE_CHECK(); 								\
 	}															\
 	else														\
 	{															\
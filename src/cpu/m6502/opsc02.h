@@ -177,14 +177,14 @@
  *	DEA Decrement accumulator
  ***************************************************************/
 #define DEA 													\
-	A = (UINT8)--A; 											\
+	A = (UINT8)(A - 1); 										\
 	SET_NZ(A)
 
 /* 65C02 *******************************************************
  *	INA Increment accumulator
  ***************************************************************/
 #define INA 													\
-	A = (UINT8)++A; 											\
+	A = (UINT8)(A + 1); 										\
 	SET_NZ(A)
 
 /* 65C02 *******************************************************
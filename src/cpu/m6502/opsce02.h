@@ -157,16 +157,16 @@
 	}
 
 /* 65ce02 ******************************************************
- *	cle clear disable extended stack flag
+ *	cle clear disable extended stack flag, 16 bit stack
  ***************************************************************/
 #define CLE 													\
-		P|=F_E
+		P&=~F_E
 
 /* 65ce02 ******************************************************
- *	see set disable extended stack flag
+ *	see set disable extended stack flag, 8 bit stack
  ***************************************************************/
 #define SEE 													\
-		P&=~F_E
+		P|=F_E
 
 /* 65ce02 ******************************************************
  *	augment
@@ -174,7 +174,7 @@
 #define AUG 													\
  t1=RDOPARG(); t2=RDOPARG(); t3=RDOPARG(); \
  logerror("m65ce02 at pc:%.4x reserved op aug %.2x %.2x %.2x\n", \
-  t1,t2,t3);
+  PPC,t1,t2,t3);
 
 /* 65ce02 ******************************************************
  *	rts imm
@@ -205,7 +205,7 @@
  ***************************************************************/
 /* not sure about how 16 bit memory modifying is executed */
 #define ASW 													\
-	tmp.w.l = tmp.w.l << 1; 									\
+	tmp.d = tmp.d << 1; 										\
 	P = (P & ~F_C) | (tmp.b.h2 & F_C);							\
 	SET_NZ_WORD(tmp);											
 
@@ -217,7 +217,7 @@
 #define ROW 													\
 	tmp.d =(tmp.d << 1);										\
 	tmp.w.l |= (P & F_C);										\
-	P = (P & ~F_C) | (tmp.w.l & F_C);							\
+	P = (P & ~F_C) | (tmp.b.h2 & F_C);							\
 	SET_NZ_WORD(tmp);											\
 
 /* 65ce02 ******************************************************
@@ -233,7 +233,7 @@
  *	DEZ Decrement index Z
  ***************************************************************/
 #define DEZ 													\
-	Z = (UINT8)--Z; 											\
+	Z = (UINT8)(Z - 1);											\
 	SET_NZ(Z)
 
 /* 65ce02 ******************************************************
@@ -241,21 +241,21 @@
  ***************************************************************/
 /* not sure about this */
 #define DEW 													\
-	tmp.w.l = --tmp.w.l;										\
+	tmp.w.l--;													\
 	SET_NZ_WORD(tmp)
 
 /* 65ce02 ******************************************************
  *	DEZ Decrement index Z
  ***************************************************************/
 #define INZ 													\
-	Z = (UINT8)++Z; 											\
+	Z = (UINT8)(Z + 1);											\
 	SET_NZ(Z)
 
 /* 65ce02 ******************************************************
  *	INW Increment memory word
  ***************************************************************/
 #define INW 													\
-	tmp.w.l = ++tmp.w.l;										\
+	tmp.w.l++;													\
 	SET_NZ_WORD(tmp)
 
 /* 65ce02 ******************************************************
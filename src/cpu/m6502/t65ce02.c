@@ -73,7 +73,7 @@ OP(02) {		  m65ce02_ICount-=2;		 CLE;		  } /* ? CLE */
 OP(22) {		  m65ce02_ICount-=7;		 JSR_IND;	  } /* ? JSR IND */
 OP(42) {		  m65ce02_ICount-=2;		 NEG;		  } /* 2 NEG */
 OP(62) { int tmp; m65ce02_ICount-=7; RD_IMM;  RTN;		  } /* ? RTN IMM */
-OP(82) { int tmp; m65ce02_ICount-=6; RD_INSY; STA;		  } /* 5 STA INSY */
+OP(82) { int tmp; m65ce02_ICount-=6;		  STA; WR_INSY; } /* 5 STA INSY */
 OP(a2) { int tmp; m65ce02_ICount-=2; RD_IMM; LDX;		  } /* 2 LDX IMM */
 OP(c2) { int tmp; m65ce02_ICount-=2; RD_IMM; CPZ;		  } /* 2 CPZ IMM */
 OP(e2) { int tmp; m65ce02_ICount-=6; RD_INSY; LDA;		  } /* ? LDA INSY */
@@ -82,7 +82,7 @@ OP(12) { int tmp; m65ce02_ICount-=5; RD_IDZ; ORA;		  } /* 5 ORA IDZ */
 OP(32) { int tmp; m65ce02_ICount-=5; RD_IDZ; AND;		  } /* 5 AND IDZ */
 OP(52) { int tmp; m65ce02_ICount-=5; RD_IDZ; EOR;		  } /* 5 EOR IDZ */
 OP(72) { int tmp; m65ce02_ICount-=5; RD_IDZ; ADC;		  } /* 5 ADC IDZ */
-OP(92) { int tmp; m65ce02_ICount-=5; RD_IDZ; STA;		  } /* 5 STA IDZ */
+OP(92) { int tmp; m65ce02_ICount-=5;		 STA; WR_IDZ; } /* 5 STA IDZ */
 OP(b2) { int tmp; m65ce02_ICount-=5; RD_IDZ; LDA;		  } /* 5 LDA IDZ */
 OP(d2) { int tmp; m65ce02_ICount-=5; RD_IDZ; CMP;		  } /* 5 CMP IDZ */
 OP(f2) { int tmp; m65ce02_ICount-=5; RD_IDZ; SBC;		  } /* 5 SBC IDZ */
@@ -86,6 +86,16 @@
 #include "z80port.h"
 #include "z80.h"
 
+/* the Z80 runs as the coprocessor, on its own address space, see coproc.c */
+#include "../../coproc.h"
+#define cpu_readop(pc)           coproc_readop(pc)
+#define cpu_readop_arg(pc)       coproc_readop(pc)
+#define cpu_readmem16(addr)      coproc_readmem(addr)
+#define cpu_writemem16(addr, v)  coproc_writemem(addr, v)
+#define cpu_readport16(port)     coproc_readport(port)
+#define cpu_writeport16(port, v) coproc_writeport(port, v)
+#define change_pc16(pc)          coproc_change_pc(pc)
+
 #define VERBOSE 0
 
 #if VERBOSE
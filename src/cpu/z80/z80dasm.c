@@ -29,6 +29,11 @@
 #include "../../emu.h"
 #include "../cpu_interface.h"
 
+/* reads the coprocessor address space, see coproc.c */
+#include "../../coproc.h"
+#define cpu_readop(pc)           coproc_readop(pc)
+#define cpu_readop_arg(pc)       coproc_readop(pc)
+
 enum e_mnemonics {
 	zADC  ,zADD  ,zAND	,zBIT  ,zCALL ,zCCF  ,zCP	,zCPD  ,
 	zCPDR ,zCPI  ,zCPIR ,zCPL  ,zDAA  ,zDB	 ,zDEC	,zDI   ,
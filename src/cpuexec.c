@@ -1,6 +1,9 @@
 #include <stdio.h>
 #include "emu.h"
 #include "cpu.h"
+#include "cpuexec.h"
+#include "coproc.h"
+#include "timer.h"
 #include "trace.h"
 #include "frontend/frontend.h"
 
@@ -8,44 +11,136 @@
 
 #define MIN_CYCLES 4
 
+#define reg_clock_mult  0x00
+#define reg_clock_flags 0x01
+#define reg_cycles      0x04
+
 static v_cpu *cpu;
-static long cycles;
+static UINT64 cycles;
+static int  cycles_running;
 static int  cycles_acum;
 static int  cycles_stolen;
 static int  halt;
 
+/* CPU cycles per master clock tick, the master clock and the devices keep their rate */
+static int   clock_mult  = 1;
+static UINT8 clock_flags = 0;
+static bool  in_vblank   = FALSE;
+
+/* a read of the low byte latches the whole counter for the other bytes */
+static UINT32 cycles_latch;
+
+static int cpu_cycles(int ticks) {
+	if (in_vblank && (clock_flags & CPUCLOCK_VBLANK_UNLIMITED)) return ticks * CPUCLOCK_UNLIMITED_MULT;
+	return ticks * clock_mult;
+}
+
 void cpuexec_init(v_cpu *vcpu) {
 	cpu = vcpu;
 	cpu->reset();
 
 	halt   = 0;
 	cycles = 0;
+	cycles_running = 0;
 	cycles_acum   = 0;
 	cycles_stolen = 0;
 }
 
-void cpuexec_run(int cycles_to_add) {
-	if (halt || !frontend_running()) return;
+static void cpuexec_run_main(int cycles_to_add) {
+	if (halt) return;
 
-	cycles_acum += cycles_to_add;
+	if (cpu_idle) {
+		cycles += cpu_cycles(cycles_to_add);
+		cpu_idle_cycles += cpu_cycles(cycles_to_add);
+		return;
+	}
+
+	cycles_acum += cpu_cycles(cycles_to_add);
 
 	int cycles_to_run = cycles_acum - cycles_stolen;
 	if (cycles_to_run < MIN_CYCLES) return;
 
+	cycles_running = cycles_to_run;
 	int cycles_ran = cpu->run(cycles_to_run);
+	cycles_running = 0;
 	cycles += cycles_ran;
 	cycles_stolen = cycles_ran - cycles_to_run;
 	cycles_acum = 0;
 }
 
+void cpuexec_run(int cycles_to_add) {
+	/* the master clock runs also while the CPU is halted */
+	timer_advance(cycles_to_add);
+
+	if (!frontend_running()) return;
+
+	cpuexec_run_main(cycles_to_add);
+
+	/* the coprocessor keeps running while the main CPU is halted or idle */
+	coproc_run(cycles_to_add);
+}
+
+/* cycles executed so far, also in the middle of a run */
+UINT64 cpuexec_get_cycles() {
+	if (!cycles_running) return cycles;
+	return cycles + cycles_running - cpu->get_cycles_left();
+}
+
+/* a halt from the running main CPU ends its run, it does not go on until the end of the slice */
 void cpuexec_halt(int halted) {
 	halt = halted;
+	if (halted && cycles_running) activecpu_abort_timeslice();
 }
 
 void cpuexec_irq(int do_interrupt) {
+	cpu_wake();
 	cpu->irq(do_interrupt);
 }
 
 void cpuexec_nmi(int do_interrupt) {
+	cpu_wake();
 	cpu->nmi(do_interrupt);
 }
+
+void cpuexec_set_clock(int mult, UINT8 flags) {
+	if (mult < 1) mult = 1;
+	if (mult > CPUCLOCK_MAX_MULT) mult = CPUCLOCK_MAX_MULT;
+	clock_mult  = mult;
+	clock_flags = flags & CPUCLOCK_VBLANK_UNLIMITED;
+	LOGV(LOGTAG, "cpu clock x%d%s", clock_mult,
+			(clock_flags & CPUCLOCK_VBLANK_UNLIMITED) ? ", unlimited in vblank" : "");
+}
+
+void cpuexec_set_vblank(bool vblank) {
+	in_vblank = vblank;
+}
+
+void cpuexec_register_write(UINT8 index, UINT8 value) {
+	switch(index) {
+	case reg_clock_mult:
+		cpuexec_set_clock(value, clock_flags);
+		break;
+	case reg_clock_flags:
+		cpuexec_set_clock(clock_mult, value);
+		break;
+	}
+}
+
+UINT8 cpuexec_register_read(UINT8 index) {
+	switch(index) {
+	case reg_clock_mult:
+		return clock_mult;
+	case reg_clock_flags:
+		return clock_flags;
+	case reg_cycles:
+		cycles_latch = cpuexec_get_cycles();
+		return cycles_latch & 0xFF;
+	case reg_cycles + 1:
+		return (cycles_latch >> 8) & 0xFF;
+	case reg_cycles + 2:
+		return (cycles_latch >> 16) & 0xFF;
+	case reg_cycles + 3:
+		return cycles_latch >> 24;
+	}
+	return 0;
+}
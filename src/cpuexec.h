@@ -11,4 +11,26 @@ void cpuexec_halt(int halted);
 void cpuexec_irq(int do_interrupt);
 void cpuexec_nmi(int do_interrupt);
 
+UINT64 cpuexec_get_cycles();
+
+/*
+ * CPU clock, registers at CPUCLOCK_START (see bus.h):
+ *
+ *   0  CPU_CLOCK        CPU cycles per master clock tick, 1 to CPUCLOCK_MAX_MULT
+ *   1  CPU_CLOCK_FLAGS  bit 0: CPUCLOCK_UNLIMITED_MULT cycles per tick during VBLANK
+ *   4-7  CPU_CYCLES     CPU cycles executed, 32 bits, read only. Reading
+ *                       byte 4 latches the counter for bytes 5 to 7
+ *
+ * Chroni, POKEY and the timers run on the master clock and keep their
+ * timing, the CPU gets more cycles in each slice
+ */
+#define CPUCLOCK_MAX_MULT         16
+#define CPUCLOCK_UNLIMITED_MULT   256
+#define CPUCLOCK_VBLANK_UNLIMITED 0x01
+
+void  cpuexec_set_clock(int mult, UINT8 flags);
+void  cpuexec_set_vblank(bool vblank);
+void  cpuexec_register_write(UINT8 index, UINT8 value);
+UINT8 cpuexec_register_read(UINT8 index);
+
 #endif
@@ -0,0 +1,148 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emu.h"
+#include "bus.h"
+#include "cpu.h"
+#include "cpuexec.h"
+#include "cpu/m6502/m6502.h"
+#include "watch.h"
+#include "cputrace.h"
+
+#define LOGTAG "CPUTRACE"
+#ifdef TRACE_CPUTRACE
+#define TRACE
+#endif
+#include "trace.h"
+
+#define DEFAULT_CAPACITY (1024*1024)
+
+bool cputrace_enabled = FALSE;
+
+static cputrace_header *header  = NULL;
+static cputrace_record *records = NULL;
+static UINT32 records_mask;
+static size_t map_size;
+
+static bool   has_stop_addr = FALSE;
+static UINT16 stop_addr;
+static bool   stop_pending = FALSE;
+
+static bool map_trace(const char *filename, UINT32 capacity) {
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "cannot create trace file %s\n", filename);
+		return FALSE;
+	}
+
+	map_size = sizeof(cputrace_header) + (size_t)capacity * sizeof(cputrace_record);
+	void *map = MAP_FAILED;
+	if (!ftruncate(fd, map_size)) {
+		map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "cannot map trace file %s\n", filename);
+		return FALSE;
+	}
+
+	header  = map;
+	records = (cputrace_record *)(header + 1);
+	records_mask = capacity - 1;
+
+	memcpy(header->magic, CPUTRACE_MAGIC, sizeof(header->magic));
+	header->version     = CPUTRACE_VERSION;
+	header->record_size = sizeof(cputrace_record);
+	header->capacity    = capacity;
+	header->frozen      = 0;
+	header->count       = 0;
+	return TRUE;
+}
+
+void cputrace_init(int argc, char *argv[]) {
+	char *filename = NULL;
+	UINT32 capacity = DEFAULT_CAPACITY;
+	bool trace_bus = FALSE;
+
+	for(int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "-trace") && i<argc-1) {
+			filename = argv[++i];
+		} else if (!strcmp(argv[i], "-trace-size") && i<argc-1) {
+			capacity = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "-trace-stop") && i<argc-1) {
+			stop_addr = strtoul(argv[++i], NULL, 16);
+			has_stop_addr = TRUE;
+		} else if (!strcmp(argv[i], "-trace-bus")) {
+			trace_bus = TRUE;
+		}
+	}
+	if (!filename) return;
+
+	/* power of two, the ring index is a mask */
+	UINT32 size = 1;
+	while (size < capacity && size < 0x80000000) size <<= 1;
+
+	if (!map_trace(filename, size)) return;
+
+	LOGV(LOGTAG, "trace to %s, %d records", filename, size);
+	cputrace_enabled = TRUE;
+	watch_set_trace(trace_bus);
+}
+
+static void cputrace_freeze() {
+	header->frozen = 1;
+	cputrace_enabled = FALSE;
+	watch_set_trace(FALSE);
+	cpu_update_hooks();
+	printf("Trace frozen at %04X after %llu records\n", stop_addr, (unsigned long long)header->count);
+}
+
+void cputrace_done() {
+	if (!header) return;
+
+	cputrace_enabled = FALSE;
+	watch_set_trace(FALSE);
+	munmap(header, map_size);
+	header  = NULL;
+	records = NULL;
+}
+
+static inline cputrace_record *next_record() {
+	return &records[header->count++ & records_mask];
+}
+
+/* the hook runs before each instruction, the one at stop_addr is done when the next hook runs */
+void cputrace_insn(UINT16 pc) {
+	if (stop_pending) {
+		stop_pending = FALSE;
+		cputrace_freeze();
+		return;
+	}
+
+	cputrace_record *record = next_record();
+	record->cycle = cpuexec_get_cycles();
+	record->addr  = pc;
+	record->type  = CPUTRACE_INSN;
+	record->bytes[0] = bus_peek16(pc);
+	record->bytes[1] = bus_peek16(pc+1);
+	record->bytes[2] = bus_peek16(pc+2);
+	cpu_get_trace_regs(record->regs);
+
+	if (has_stop_addr && pc == stop_addr) {
+		stop_pending = TRUE;
+	}
+}
+
+void cputrace_bus(UINT8 type, UINT16 addr, UINT8 value) {
+	cputrace_record *record = next_record();
+	record->cycle = cpuexec_get_cycles();
+	record->addr  = addr;
+	record->type  = type;
+	record->bytes[0] = value;
+}
@@ -0,0 +1,53 @@
+#ifndef _CPUTRACE_H
+#define _CPUTRACE_H
+
+/*
+ * Binary execution trace
+ *
+ * Records are written to a ring in a memory mapped file, so the trace
+ * is on disk even if the emulator crashes. Decode it with tools/tracedump.
+ *
+ * -trace file        record to file
+ * -trace-size n      ring size in records (default 1M records, 16MB)
+ * -trace-stop addr   freeze the trace after executing addr
+ * -trace-bus         also record data reads and writes
+ */
+
+#define CPUTRACE_MAGIC   "CLC88TRC"
+#define CPUTRACE_VERSION 1
+
+#define CPUTRACE_INSN  0
+#define CPUTRACE_READ  1
+#define CPUTRACE_WRITE 2
+
+/*
+ * 16 bytes per record. For bus events addr is the accessed address,
+ * bytes[0] the value and the registers are not used
+ */
+typedef struct {
+	UINT32 cycle;
+	UINT16 addr;
+	UINT8  type;
+	UINT8  bytes[3];
+	UINT8  regs[5];  /* A X Y P S */
+	UINT8  reserved;
+} cputrace_record;
+
+typedef struct {
+	char   magic[8];
+	UINT32 version;
+	UINT32 record_size;
+	UINT32 capacity;
+	UINT32 frozen;
+	UINT64 count;  /* records written, the ring holds the last capacity ones */
+} cputrace_header;
+
+extern bool cputrace_enabled;
+
+void cputrace_init(int argc, char *argv[]);
+void cputrace_done();
+
+void cputrace_insn(UINT16 pc);
+void cputrace_bus(UINT8 type, UINT16 addr, UINT8 value);
+
+#endif
@@ -0,0 +1,421 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emu.h"
+#include "bus.h"
+#include "memory.h"
+#include "video/chroni.h"
+#include "watch.h"
+#include "cpu/m6502/m6502.h"
+#include "hle.h"
+
+#define LOGTAG "HLE"
+#ifdef TRACE_HLE
+#define TRACE
+#endif
+#include "trace.h"
+
+
+UINT8 hle_pages[0x100];
+
+static bool hle_enabled = TRUE;
+static int  hle_byte_cost = -1;
+
+/* zero page and registers used by the OS, see asm/6502/os/symbols.asm */
+#define SRC_ADDR    0x00
+#define DST_ADDR    0x02
+#define SIZE        0x04
+#define COPY_PARAMS 0x06
+#define R0          0xC0
+#define R1          0xC1
+#define VPAGE       0x9006
+
+#define FLAG_N 0x80
+#define FLAG_Z 0x02
+#define FLAG_C 0x01
+
+/* pattern entries: a byte, or the low or high byte of the entry plus n */
+#define LO(n) (0x100 | (n))
+#define HI(n) (0x200 | (n))
+
+typedef struct {
+	UINT8 a, x, y, p;
+	UINT32 bytes;  /* written by the routine */
+} hle_regs;
+
+typedef struct {
+	const char *name;
+	const UINT16 *pattern;
+	UINT16 size;
+	void (*run)(hle_regs *regs);
+	UINT16 base_cost;  /* JSR to RTS, without the bytes */
+	UINT16 byte_cost;
+	int entry;         /* -1 if not found */
+} hle_routine;
+
+/* plain memory goes straight to the page table, the rest through the bus */
+static inline UINT8 hle_read(UINT16 addr) {
+	if ((addr < 0x9000 || addr >= 0xE000) && !(watch_pages[addr >> 8] & (WATCH_READ | WATCH_TRACE | WATCH_COVERAGE))) {
+		return *MEM_PTR(addr);
+	}
+	return bus_read16(addr);
+}
+
+static inline void hle_write(UINT16 addr, UINT8 value) {
+	if ((addr < 0x9000 || addr >= 0xE000) && !watch_pages[addr >> 8]) {
+		*MEM_PTR(addr) = value;
+	} else {
+		bus_write16(addr, value);
+	}
+}
+
+static inline UINT16 hle_read_word(UINT8 zp) {
+	return hle_read(zp) | (hle_read((UINT8)(zp + 1)) << 8);
+}
+
+static inline UINT8 hle_flags_nz(UINT8 p, UINT8 value) {
+	p &= ~(FLAG_N | FLAG_Z);
+	if (!value) p |= FLAG_Z;
+	return p | (value & FLAG_N);
+}
+
+/*
+ * The C versions follow the 6502 code step by step and read the zero page
+ * each time, so a copy over its own pointers ends as on the CPU
+ */
+
+static void hle_copy_block(hle_regs *regs) {
+	UINT8 y = 0;
+	for(;;) {
+		do {
+			hle_write(hle_read_word(DST_ADDR) + y, hle_read(hle_read_word(SRC_ADDR) + y));
+			regs->bytes++;
+			y++;
+		} while (y != hle_read(SIZE));
+		hle_write(SRC_ADDR + 1, hle_read(SRC_ADDR + 1) + 1);
+		hle_write(DST_ADDR + 1, hle_read(DST_ADDR + 1) + 1);
+
+		regs->a = hle_read(SIZE + 1);
+		if (!regs->a) break;
+		hle_write(SIZE + 1, regs->a - 1);
+	}
+	regs->y = y;
+	/* lda SIZE+1 after cpy SIZE */
+	regs->p = hle_flags_nz(regs->p, regs->a) | FLAG_C;
+}
+
+static void hle_copy_block_with_params(hle_regs *regs) {
+	UINT16 params = hle_read_word(COPY_PARAMS);
+	for(int y = 5; y >= 0; y--) {
+		hle_write(SRC_ADDR + y, hle_read(params + y));
+	}
+	hle_copy_block(regs);
+}
+
+static void hle_mem_set_bytes(hle_regs *regs) {
+	UINT8 y = 0;
+	UINT8 x = hle_read(SIZE + 1);
+	bool short_run = TRUE;
+	if (x) {
+		do {
+			do {
+				hle_write(hle_read_word(DST_ADDR) + y, regs->a);
+				regs->bytes++;
+				y++;
+			} while (y);
+			hle_write(DST_ADDR + 1, hle_read(DST_ADDR + 1) + 1);
+		} while (--x);
+		x = hle_read(SIZE);
+		short_run = x != 0;
+	}
+	/* with SIZE+1 at zero this starts with x = 0 and writes a full page */
+	if (short_run) {
+		do {
+			hle_write(hle_read_word(DST_ADDR) + y, regs->a);
+			regs->bytes++;
+			y++;
+		} while (--x);
+	}
+	regs->x = 0;
+	regs->y = y;
+	regs->p = hle_flags_nz(regs->p, 0);
+}
+
+/* walks DST_ADDR through the VRAM window, returns TRUE if VPAGE moved */
+static bool hle_vram_next(void) {
+	UINT8 lo = hle_read(DST_ADDR) + 1;
+	hle_write(DST_ADDR, lo);
+	if (lo) return FALSE;
+
+	bool moved = FALSE;
+	UINT8 x = hle_read(DST_ADDR + 1) + 1;
+	if (x == 0xE0) {
+		x = 0xA0;
+		hle_write(VPAGE, hle_read(VPAGE) + 1);
+		moved = TRUE;
+	}
+	hle_write(DST_ADDR + 1, x);
+	return moved;
+}
+
+/* dec SIZE, then SIZE+1 when it reaches zero, until SIZE+1 wraps */
+static bool hle_vram_count(void) {
+	UINT8 size = hle_read(SIZE) - 1;
+	hle_write(SIZE, size);
+	if (size) return TRUE;
+
+	size = hle_read(SIZE + 1) - 1;
+	hle_write(SIZE + 1, size);
+	return size != 0xFF;
+}
+
+static void hle_vram_set_bytes(hle_regs *regs) {
+	hle_write(R0, regs->a);
+	hle_write(R1, hle_read(VPAGE));
+	UINT8 a = hle_read(R0);
+	do {
+		hle_write(hle_read_word(DST_ADDR), a);
+		regs->bytes++;
+		/* the byte is read again from R0 after a VPAGE change */
+		if (hle_vram_next()) a = hle_read(R0);
+	} while (hle_vram_count());
+
+	regs->a = hle_read(R1);
+	hle_write(VPAGE, regs->a);
+	regs->x = 0xFF;
+	regs->y = 0;
+	regs->p = hle_flags_nz(regs->p, regs->a) | FLAG_C;
+}
+
+static void hle_ram_vram_copy(hle_regs *regs) {
+	hle_write(R0, hle_read(VPAGE));
+	do {
+		hle_write(hle_read_word(DST_ADDR), hle_read(hle_read_word(SRC_ADDR)));
+		regs->bytes++;
+		hle_vram_next();
+
+		UINT8 lo = hle_read(SRC_ADDR) + 1;
+		hle_write(SRC_ADDR, lo);
+		if (!lo) hle_write(SRC_ADDR + 1, hle_read(SRC_ADDR + 1) + 1);
+	} while (hle_vram_count());
+
+	regs->a = hle_read(R0);
+	hle_write(VPAGE, regs->a);
+	regs->x = 0xFF;
+	regs->y = 0;
+	regs->p = hle_flags_nz(regs->p, regs->a) | FLAG_C;
+}
+
+/* code of asm/6502/os/6502os.asm and graphics.asm */
+static const UINT16 copy_block_code[] = {
+	0xA0, 0x00,             /* ldy #0 */
+	0xB1, 0x00,             /* lda (SRC_ADDR), y */
+	0x91, 0x02,             /* sta (DST_ADDR), y */
+	0xC8,                   /* iny */
+	0xC4, 0x04,             /* cpy SIZE */
+	0xD0, 0xF7,             /* bne copy_block_short */
+	0xE6, 0x01,             /* inc SRC_ADDR+1 */
+	0xE6, 0x03,             /* inc DST_ADDR+1 */
+	0xA5, 0x05,             /* lda SIZE+1 */
+	0xF0, 0x05,             /* beq copy_block_end */
+	0xC6, 0x05,             /* dec SIZE+1 */
+	0x4C, LO(2), HI(2),     /* jmp copy_block_short */
+	0x60                    /* rts */
+};
+
+static const UINT16 copy_block_with_params_code[] = {
+	0xA0, 0x05,             /* ldy #5 */
+	0xB1, 0x06,             /* lda (COPY_PARAMS), y */
+	0x99, 0x00, 0x00,       /* sta SRC_ADDR, y */
+	0x88,                   /* dey */
+	0x10, 0xF8,             /* bpl copy_block_params */
+	0xA0, 0x00,             /* copy_block */
+	0xB1, 0x00,
+	0x91, 0x02,
+	0xC8,
+	0xC4, 0x04,
+	0xD0, 0xF7,
+	0xE6, 0x01,
+	0xE6, 0x03,
+	0xA5, 0x05,
+	0xF0, 0x05,
+	0xC6, 0x05,
+	0x4C, LO(12), HI(12),
+	0x60
+};
+
+static const UINT16 mem_set_bytes_code[] = {
+	0xA0, 0x00,             /* ldy #0 */
+	0xA6, 0x05,             /* ldx SIZE+1 */
+	0xF0, 0x0E,             /* beq mem_set_bytes_short */
+	0x91, 0x02,             /* sta (DST_ADDR), y */
+	0xC8,                   /* iny */
+	0xD0, 0xFB,             /* bne mem_set_bytes_page */
+	0xE6, 0x03,             /* inc DST_ADDR+1 */
+	0xCA,                   /* dex */
+	0xD0, 0xF6,             /* bne mem_set_bytes_page */
+	0xA6, 0x04,             /* ldx SIZE */
+	0xF0, 0x06,             /* beq mem_set_bytes_end */
+	0x91, 0x02,             /* sta (DST_ADDR), y */
+	0xC8,                   /* iny */
+	0xCA,                   /* dex */
+	0xD0, 0xFA,             /* bne mem_set_bytes_short */
+	0x60                    /* rts */
+};
+
+static const UINT16 vram_set_bytes_code[] = {
+	0x85, 0xC0,             /* sta R0 */
+	0xAD, 0x06, 0x90,       /* lda VPAGE */
+	0x85, 0xC1,             /* sta R1 */
+	0xA0, 0x00,             /* ldy #0 */
+	0xA5, 0xC0,             /* lda R0 */
+	0x91, 0x02,             /* sta (DST_ADDR), y */
+	0xE6, 0x02,             /* inc DST_ADDR */
+	0xD0, 0x10,             /* bne vram_set_bytes_next */
+	0xA6, 0x03,             /* ldx DST_ADDR+1 */
+	0xE8,                   /* inx */
+	0xE0, 0xE0,             /* cpx #$e0 */
+	0xD0, 0x07,             /* bne vram_set_bytes_next_page */
+	0xA2, 0xA0,             /* ldx #$a0 */
+	0xEE, 0x06, 0x90,       /* inc VPAGE */
+	0xA5, 0xC0,             /* lda R0 */
+	0x86, 0x03,             /* stx DST_ADDR+1 */
+	0xC6, 0x04,             /* dec SIZE */
+	0xD0, 0xE6,             /* bne vram_set_bytes_loop */
+	0xC6, 0x05,             /* dec SIZE+1 */
+	0xA6, 0x05,             /* ldx SIZE+1 */
+	0xE0, 0xFF,             /* cpx #$ff */
+	0xD0, 0xDE,             /* bne vram_set_bytes_loop */
+	0xA5, 0xC1,             /* lda R1 */
+	0x8D, 0x06, 0x90,       /* sta VPAGE */
+	0x60                    /* rts */
+};
+
+static const UINT16 ram_vram_copy_code[] = {
+	0xAD, 0x06, 0x90,       /* lda VPAGE */
+	0x85, 0xC0,             /* sta R0 */
+	0xA0, 0x00,             /* ldy #0 */
+	0xB1, 0x00,             /* lda (SRC_ADDR), y */
+	0x91, 0x02,             /* sta (DST_ADDR), y */
+	0xE6, 0x02,             /* inc DST_ADDR */
+	0xD0, 0x0E,             /* bne ram_vram_copy_next */
+	0xA6, 0x03,             /* ldx DST_ADDR+1 */
+	0xE8,                   /* inx */
+	0xE0, 0xE0,             /* cpx #$e0 */
+	0xD0, 0x05,             /* bne ram_vram_copy_next_page */
+	0xA2, 0xA0,             /* ldx #$a0 */
+	0xEE, 0x06, 0x90,       /* inc VPAGE */
+	0x86, 0x03,             /* stx DST_ADDR+1 */
+	0xE6, 0x00,             /* inc SRC_ADDR */
+	0xD0, 0x02,             /* bne ram_vram_copy_no_src_page */
+	0xE6, 0x01,             /* inc SRC_ADDR+1 */
+	0xC6, 0x04,             /* dec SIZE */
+	0xD0, 0xE0,             /* bne ram_vram_copy_loop */
+	0xC6, 0x05,             /* dec SIZE+1 */
+	0xA6, 0x05,             /* ldx SIZE+1 */
+	0xE0, 0xFF,             /* cpx #$ff */
+	0xD0, 0xD8,             /* bne ram_vram_copy_loop */
+	0xA5, 0xC0,             /* lda R0 */
+	0x8D, 0x06, 0x90,       /* sta VPAGE */
+	0x60                    /* rts */
+};
+
+#define ROUTINE(name, base_cost, byte_cost) \
+	{#name, name##_code, sizeof(name##_code) / sizeof(UINT16), hle_##name, base_cost, byte_cost, -1}
+
+static hle_routine routines[] = {
+	ROUTINE(copy_block,             26, 19),
+	ROUTINE(copy_block_with_params, 116, 19),
+	ROUTINE(mem_set_bytes,          20, 11),
+	ROUTINE(vram_set_bytes,         35, 22),
+	ROUTINE(ram_vram_copy,          30, 35)
+};
+
+#define ROUTINES (sizeof(routines) / sizeof(routines[0]))
+
+/* the OS area, where the image is loaded */
+#define SEARCH_START 0xE000
+#define SEARCH_END   0xFFFF
+
+static bool hle_matches(const hle_routine *routine, unsigned entry) {
+	if (entry + routine->size - 1 > 0xFFFF) return FALSE;
+
+	for(int i=0; i<routine->size; i++) {
+		UINT16 expected = routine->pattern[i];
+		if (expected & 0x100) {
+			expected = (entry + (expected & 0xFF)) & 0xFF;
+		} else if (expected & 0x200) {
+			expected = (entry + (expected & 0xFF)) >> 8;
+		}
+		if (bus_peek16(entry + i) != expected) return FALSE;
+	}
+	return TRUE;
+}
+
+void hle_init(int argc, char *argv[]) {
+	for(int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "-exact")) {
+			hle_enabled = FALSE;
+		} else if (!strcmp(argv[i], "-hle-cost") && i<argc-1) {
+			hle_byte_cost = atoi(argv[++i]);
+		}
+	}
+}
+
+void hle_setup() {
+	memset(hle_pages, 0, sizeof(hle_pages));
+	if (!hle_enabled) return;
+
+	for(int i=0; i<ROUTINES; i++) {
+		hle_routine *routine = &routines[i];
+		routine->entry = -1;
+		for(unsigned addr = SEARCH_START; addr <= SEARCH_END; addr++) {
+			if (hle_matches(routine, addr)) {
+				routine->entry = addr;
+				hle_pages[addr >> 8] = 1;
+				break;
+			}
+		}
+		if (hle_byte_cost >= 0) routine->byte_cost = hle_byte_cost;
+
+		if (routine->entry >= 0) {
+			LOGV(LOGTAG, "%s at %04X", routine->name, routine->entry);
+		} else {
+			LOGV(LOGTAG, "%s not found", routine->name);
+		}
+	}
+}
+
+int hle_run(UINT16 pc) {
+	hle_routine *routine = NULL;
+	for(int i=0; i<ROUTINES; i++) {
+		if (routines[i].entry == pc) {
+			routine = &routines[i];
+			break;
+		}
+	}
+	if (!routine || !hle_matches(routine, pc)) return 0;
+
+	hle_regs regs;
+	regs.a = m6502_get_reg(M6502_A);
+	regs.x = m6502_get_reg(M6502_X);
+	regs.y = m6502_get_reg(M6502_Y);
+	regs.p = m6502_get_reg(M6502_P);
+	regs.bytes = 0;
+
+	routine->run(&regs);
+
+	m6502_set_reg(M6502_A, regs.a);
+	m6502_set_reg(M6502_X, regs.x);
+	m6502_set_reg(M6502_Y, regs.y);
+	m6502_set_reg(M6502_P, regs.p);
+
+	/* rts */
+	UINT8 s = m6502_get_reg(M6502_S);
+	UINT16 ret = hle_read(0x100 + (UINT8)(s + 1)) | (hle_read(0x100 + (UINT8)(s + 2)) << 8);
+	m6502_set_reg(M6502_S, (UINT8)(s + 2));
+	m6502_set_reg(M6502_PC, ret + 1);
+
+	LOGV(LOGTAG, "%s %d bytes", routine->name, regs.bytes);
+	return routine->base_cost + regs.bytes * routine->byte_cost;
+}
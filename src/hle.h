@@ -0,0 +1,32 @@
+#ifndef _HLE_H
+#define _HLE_H
+
+/*
+ * High level emulation of OS routines
+ *
+ * The memory copy and fill routines of the OS are found in the loaded
+ * image by their code bytes. A JSR into one of them runs a C version
+ * that leaves memory, registers and flags as the 6502 code would and
+ * charges a fixed cost plus a cost per byte. The code bytes are checked
+ * again on each call, a modified routine runs on the CPU.
+ *
+ * Only the plain CPU loop calls the C versions, so breakpoints, the
+ * trace and the coverage map see the real code. An IRQ is taken after
+ * the whole routine instead of between two of its instructions.
+ *
+ * -exact        disable, every routine runs on the CPU
+ * -hle-cost n   cycles charged per byte (default: about the 6502 code)
+ */
+
+/* pages that hold the entry of a routine */
+extern UINT8 hle_pages[0x100];
+
+void hle_init(int argc, char *argv[]);
+
+/* find the routines in memory, after the OS and the program are loaded */
+void hle_setup();
+
+/* runs the routine at pc and returns the cycles used, 0 if there is none */
+int hle_run(UINT16 pc);
+
+#endif
@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "emu.h"
+#include "bus.h"
+#include "cpu.h"
+#include "video/chroni.h"
+#include "hypercall.h"
+
+#define LOGTAG "HYPERCALL"
+#ifdef TRACE_HYPERCALL
+#define TRACE
+#endif
+#include "trace.h"
+
+#define reg_args_low   0x00
+#define reg_args_high  0x01
+#define reg_call       0x02
+#define reg_status     0x03
+#define reg_cycles_low  0x04
+#define reg_cycles_high 0x05
+
+#define FAR_VRAM 0x80
+
+static UINT16 args;
+static UINT8  status;
+static UINT16 cycles;
+static bool   busy;
+
+/* a service returns a status and the units of work for the cycle charge */
+typedef struct {
+	UINT8  id;
+	const char *name;
+	UINT8  (*run)(UINT32 *units);
+	UINT16 base_cost;
+	UINT16 unit_cost;
+} hypercall_service;
+
+static UINT8 arg_byte(UINT16 offset) {
+	return bus_read16(args + offset);
+}
+
+static UINT16 arg_word(UINT16 offset) {
+	return arg_byte(offset) | (arg_byte(offset + 1) << 8);
+}
+
+static UINT32 arg_far(UINT16 offset) {
+	return arg_word(offset) | (arg_byte(offset + 2) << 16);
+}
+
+static void arg_set_word(UINT16 offset, UINT16 value) {
+	bus_write16(args + offset,     value & 0xFF);
+	bus_write16(args + offset + 1, value >> 8);
+}
+
+static void arg_set_long(UINT16 offset, UINT32 value) {
+	arg_set_word(offset,     value & 0xFFFF);
+	arg_set_word(offset + 2, value >> 16);
+}
+
+/* CPU accesses go through the bus, so devices, watchpoints and cached code see them */
+static UINT8 far_read(UINT32 addr) {
+	if ((addr >> 16) & FAR_VRAM) return chroni_vram_peek(addr & 0x1FFFF);
+	return bus_read16(addr);
+}
+
+static void far_write(UINT32 addr, UINT8 value) {
+	if ((addr >> 16) & FAR_VRAM) {
+		chroni_vram_poke(addr & 0x1FFFF, value);
+	} else {
+		bus_write16(addr, value);
+	}
+}
+
+/* the next byte, in the same space */
+static UINT32 far_next(UINT32 addr, UINT32 offset) {
+	if ((addr >> 16) & FAR_VRAM) return (addr & 0xFE0000) | ((addr + offset) & 0x1FFFF);
+	return (addr + offset) & 0xFFFF;
+}
+
+static bool far_valid(UINT32 addr) {
+	UINT8 space = addr >> 16;
+	return space == 0 || (space & ~1) == FAR_VRAM;
+}
+
+static UINT8 service_memcpy(UINT32 *units) {
+	UINT32 dst  = arg_far(0);
+	UINT32 src  = arg_far(3);
+	UINT16 size = arg_word(6);
+	if (!far_valid(dst) || !far_valid(src)) return HC_ERR_ARGS;
+
+	/* read everything first, overlapping blocks copy as memmove */
+	static UINT8 buffer[0x10000];
+	for(UINT32 i=0; i<size; i++) buffer[i] = far_read(far_next(src, i));
+	for(UINT32 i=0; i<size; i++) far_write(far_next(dst, i), buffer[i]);
+
+	*units = size;
+	return HC_OK;
+}
+
+static UINT8 service_memset(UINT32 *units) {
+	UINT32 dst   = arg_far(0);
+	UINT16 size  = arg_word(3);
+	UINT8  value = arg_byte(5);
+	if (!far_valid(dst)) return HC_ERR_ARGS;
+
+	for(UINT32 i=0; i<size; i++) far_write(far_next(dst, i), value);
+
+	*units = size;
+	return HC_OK;
+}
+
+static UINT8 service_mul(UINT32 *units) {
+	arg_set_long(4, (UINT32)arg_word(0) * arg_word(2));
+	return HC_OK;
+}
+
+static UINT8 service_div(UINT32 *units) {
+	UINT32 dividend = arg_word(0) | (arg_word(2) << 16);
+	UINT16 divisor  = arg_word(4);
+	if (!divisor) return HC_ERR_ARGS;
+
+	arg_set_long(6,  dividend / divisor);
+	arg_set_word(10, dividend % divisor);
+	return HC_OK;
+}
+
+static UINT8 service_format(UINT32 *units) {
+	UINT16 dst      = arg_word(0);
+	UINT16 dst_size = arg_word(2);
+	UINT16 fmt      = arg_word(4);
+	UINT16 values   = arg_word(6);
+	if (!dst_size) return HC_ERR_ARGS;
+
+	static char out[0x10000];
+	UINT32 len = 0;
+	UINT32 limit = dst_size - 1;
+
+	for(UINT16 p = fmt; len < limit; p++) {
+		char c = bus_read16(p);
+		if (!c) break;
+		if (c != '%') {
+			out[len++] = c;
+			continue;
+		}
+
+		/* flags and width, then the conversion */
+		char spec[16] = "%";
+		int n = 1;
+		c = bus_read16(++p);
+		while ((c == '0' || c == '-') && n < 3) {
+			spec[n++] = c;
+			c = bus_read16(++p);
+		}
+		while (c >= '0' && c <= '9' && n < 6) {
+			spec[n++] = c;
+			c = bus_read16(++p);
+		}
+
+		char text[0x100];
+		UINT16 value = 0;
+		if (c != '%' && c != 0) {
+			value = bus_read16(values) | (bus_read16(values + 1) << 8);
+			values += 2;
+		}
+		switch (c) {
+		case 'd':
+			spec[n++] = 'd';
+			spec[n] = 0;
+			snprintf(text, sizeof(text), spec, (INT16)value);
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+			spec[n++] = c;
+			spec[n] = 0;
+			snprintf(text, sizeof(text), spec, (unsigned)value);
+			break;
+		case 'c':
+			spec[n++] = 'c';
+			spec[n] = 0;
+			snprintf(text, sizeof(text), spec, value & 0xFF);
+			break;
+		case 's': {
+			char str[0x100];
+			int i;
+			for(i=0; i<sizeof(str)-1; i++) {
+				str[i] = bus_read16(value + i);
+				if (!str[i]) break;
+			}
+			str[i] = 0;
+			spec[n++] = 's';
+			spec[n] = 0;
+			snprintf(text, sizeof(text), spec, str);
+			break;
+		}
+		case '%':
+			strcpy(text, "%");
+			break;
+		default:
+			return HC_ERR_DATA;
+		}
+
+		for(int i=0; text[i] && len < limit; i++) out[len++] = text[i];
+	}
+
+	for(UINT32 i=0; i<len; i++) bus_write16(dst + i, out[i]);
+	bus_write16(dst + len, 0);
+	arg_set_word(8, len);
+
+	*units = len;
+	return HC_OK;
+}
+
+static UINT8 service_inflate(UINT32 *units) {
+	UINT32 dst      = arg_far(0);
+	UINT16 dst_size = arg_word(3);
+	UINT32 src      = arg_far(5);
+	UINT16 src_size = arg_word(8);
+	if (!far_valid(dst) || !far_valid(src)) return HC_ERR_ARGS;
+
+	static UINT8 in[0x10000];
+	static UINT8 out[0x10000];
+	for(UINT32 i=0; i<src_size; i++) in[i] = far_read(far_next(src, i));
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) return HC_ERR_DATA;
+
+	stream.next_in   = in;
+	stream.avail_in  = src_size;
+	stream.next_out  = out;
+	stream.avail_out = dst_size;
+	int result = inflate(&stream, Z_FINISH);
+	UINT32 len = dst_size - stream.avail_out;
+	inflateEnd(&stream);
+	if (result != Z_STREAM_END) return HC_ERR_DATA;
+
+	for(UINT32 i=0; i<len; i++) far_write(far_next(dst, i), out[i]);
+	arg_set_word(10, len);
+
+	*units = len;
+	return HC_OK;
+}
+
+/* cycles are base_cost plus unit_cost for each byte written */
+static const hypercall_service services[] = {
+	{0x01, "memcpy",  service_memcpy,  20, 2},
+	{0x02, "memset",  service_memset,  20, 1},
+	{0x03, "mul",     service_mul,     40, 0},
+	{0x04, "div",     service_div,     80, 0},
+	{0x05, "format",  service_format,  40, 4},
+	{0x06, "inflate", service_inflate, 60, 4},
+};
+
+#define SERVICES (sizeof(services) / sizeof(services[0]))
+
+static void hypercall_run(UINT8 id) {
+	const hypercall_service *service = NULL;
+	for(int i=0; i<SERVICES; i++) {
+		if (services[i].id == id) {
+			service = &services[i];
+			break;
+		}
+	}
+	if (!service) {
+		LOGV(LOGTAG, "unknown service %02X", id);
+		status = HC_ERR_SERVICE;
+		cycles = 0;
+		return;
+	}
+
+	UINT32 units = 0;
+	busy = TRUE;
+	status = service->run(&units);
+	busy = FALSE;
+
+	UINT32 charge = service->base_cost + units * service->unit_cost;
+	cycles = charge > 0xFFFF ? 0xFFFF : charge;
+	activecpu_adjust_icount(-(int)charge);
+
+	LOGV(LOGTAG, "%s args %04X status %02X cycles %d", service->name, args, status, charge);
+}
+
+void hypercall_register_write(UINT8 index, UINT8 value) {
+	switch(index) {
+	case reg_args_low:
+		args = (args & 0xFF00) | value;
+		break;
+	case reg_args_high:
+		args = (args & 0x00FF) | (value << 8);
+		break;
+	case reg_call:
+		/* a service writing to the registers does not call again */
+		if (!busy) hypercall_run(value);
+		break;
+	}
+}
+
+UINT8 hypercall_register_read(UINT8 index) {
+	switch(index) {
+	case reg_args_low:
+		return args & 0xFF;
+	case reg_args_high:
+		return args >> 8;
+	case reg_status:
+		return status;
+	case reg_cycles_low:
+		return cycles & 0xFF;
+	case reg_cycles_high:
+		return cycles >> 8;
+	}
+	return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef _HYPERCALL_H
+#define _HYPERCALL_H
+
+/*
+ * Host services for guest code
+ *
+ * Registers, see HYPERCALL_START in bus.h and asm/6502/os/symbols.asm:
+ *
+ *   0-1  HC_ARGS    address of the argument block
+ *   2    HC_CALL    writing a service number runs it
+ *   3    HC_STATUS  status of the last call, HC_OK or an HC_ERR_ code
+ *   4-5  HC_CYCLES  cycles charged for the last call, saturated
+ *
+ * The call completes during the write, the CPU is charged the cycles of
+ * the service. Results are written back to the argument block.
+ *
+ * Far pointers are 3 bytes: a CPU address when the third byte is 0,
+ * a VRAM address when bit 7 of the third byte is set, bit 0 of that
+ * byte is bit 16 of the VRAM address.
+ *
+ * Services, argument block offsets:
+ *   01 memcpy   0 dst far, 3 src far, 6 size
+ *   02 memset   0 dst far, 3 size, 5 value
+ *   03 mul      0 a, 2 b                  -> 4 a*b (32 bits)
+ *   04 div      0 dividend (32 bits), 4 divisor
+ *                                         -> 6 quotient (32 bits), 10 remainder
+ *   05 format   0 dst, 2 dst size, 4 format, 6 values
+ *                                         -> 8 length
+ *      zero terminated printf style format with %d %u %x %X %c %s %%,
+ *      flags 0 and -, and a width. Each conversion takes the next 16 bit
+ *      word of values, for %s the address of a zero terminated string
+ *   06 inflate  0 dst far, 3 dst size, 5 src far, 8 src size
+ *                                         -> 10 length
+ *      raw deflate data, as written by zlib with negative window bits
+ *
+ * All values are little endian, sizes are 16 bits
+ */
+
+#define HC_OK            0x00
+#define HC_ERR_SERVICE   0x80
+#define HC_ERR_ARGS      0x81
+#define HC_ERR_DATA      0x82
+
+void  hypercall_register_write(UINT8 index, UINT8 value);
+UINT8 hypercall_register_read(UINT8 index);
+
+#endif
@@ -1,17 +1,39 @@
+#include <string.h>
 #include "emu.h"
 #include "memory.h"
 
 UINT8 memory[0x10000]; // Addressable 64K
 
+/* each 4KB page of the CPU space, the MMU maps pages onto extended RAM */
+UINT8 *mem_pages[MEM_PAGES] = {
+	memory + 0x0000, memory + 0x1000, memory + 0x2000, memory + 0x3000,
+	memory + 0x4000, memory + 0x5000, memory + 0x6000, memory + 0x7000,
+	memory + 0x8000, memory + 0x9000, memory + 0xA000, memory + 0xB000,
+	memory + 0xC000, memory + 0xD000, memory + 0xE000, memory + 0xF000
+};
+
 UINT8 mem_readmem16(UINT16 addr) {
-	return memory[addr];
+	return *MEM_PTR(addr);
 }
 
 void  mem_writemem16(UINT16 addr, UINT8 value) {
-	memory[addr] = value;
+	*MEM_PTR(addr) = value;
 }
-void  mem_write(UINT16 addr, UINT8 *values, UINT16 size) {
-	for(int i=0; i<size && addr+i < 0x10000; i++) {
-		memory[addr+i] = values[i];
+
+void  mem_write(UINT16 addr, UINT8 *values, UINT32 size) {
+	UINT32 start = addr;
+	UINT32 end = start + size;
+	if (end > 0x10000) end = 0x10000;
+
+	while (start < end) {
+		UINT32 run_end = (start | MEM_PAGE_MASK) + 1;
+		if (run_end > end) run_end = end;
+		memcpy(MEM_PTR(start), values + (start - addr), run_end - start);
+		start = run_end;
 	}
 }
+
+/* NULL maps the page back to the CPU RAM */
+void  mem_map_page(int page, UINT8 *base) {
+	mem_pages[page] = base ? base : memory + (page << MEM_PAGE_SHIFT);
+}
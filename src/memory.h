@@ -33,9 +33,19 @@ typedef read32_handler	port_read32_handler;
 typedef write32_handler	port_write32_handler;
 
 
+#define MEM_PAGE_SHIFT 12
+#define MEM_PAGE_SIZE  (1 << MEM_PAGE_SHIFT)
+#define MEM_PAGE_MASK  (MEM_PAGE_SIZE - 1)
+#define MEM_PAGES      (0x10000 >> MEM_PAGE_SHIFT)
+
+/* plain memory goes through the page table, see mmu.c */
+extern UINT8 *mem_pages[MEM_PAGES];
+#define MEM_PTR(addr) (mem_pages[(addr) >> MEM_PAGE_SHIFT] + ((addr) & MEM_PAGE_MASK))
+
 UINT8 mem_readmem16(UINT16 addr);
 void  mem_writemem16(UINT16 addr, UINT8 value);
-void  mem_write(UINT16 addr, UINT8 *values, UINT16 size);
+void  mem_write(UINT16 addr, UINT8 *values, UINT32 size);
+void  mem_map_page(int page, UINT8 *base);
 
 /***************************************************************************
 
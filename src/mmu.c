@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emu.h"
+#include "memory.h"
+#include "cpu.h"
+#include "cpu/cpu_interface.h"
+#include "mmu.h"
+
+#define LOGTAG "MMU"
+#ifdef TRACE_MMU
+#define TRACE
+#endif
+#include "trace.h"
+
+#define reg_bank_lo   0x00
+#define reg_bank_hi   0x08
+#define reg_banks_lo  0x10
+#define reg_banks_hi  0x11
+
+#define XRAM_DEFAULT_KB 1024
+#define XRAM_MAX_KB     16384
+
+static UINT8  *xram;
+static UINT32 xram_banks;
+static UINT16 banks[MMU_SLOTS];
+
+static void mmu_map_slot(int slot) {
+	int page = MMU_SLOT_FIRST + slot;
+	UINT8 *base = NULL;
+	if (banks[slot] && xram_banks) {
+		base = xram + ((banks[slot] - 1) % xram_banks) * MEM_PAGE_SIZE;
+	}
+	mem_map_page(page, base);
+
+	/* the same addresses hold other code now */
+	cpu_code_write(page << MEM_PAGE_SHIFT, MEM_PAGE_SIZE);
+}
+
+/* also after a state load */
+static void mmu_remap() {
+	for(int slot=0; slot<MMU_SLOTS; slot++) mmu_map_slot(slot);
+}
+
+void mmu_init(int argc, char *argv[]) {
+	int size_kb = XRAM_DEFAULT_KB;
+	for(int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "-xram") && i<argc-1) {
+			size_kb = atoi(argv[++i]);
+		}
+	}
+	if (size_kb < 0) size_kb = 0;
+	if (size_kb > XRAM_MAX_KB) size_kb = XRAM_MAX_KB;
+
+	xram_banks = size_kb * 1024 / MEM_PAGE_SIZE;
+	if (xram_banks) xram = calloc(xram_banks, MEM_PAGE_SIZE);
+	memset(banks, 0, sizeof(banks));
+	LOGV(LOGTAG, "extended RAM %d banks", xram_banks);
+
+	state_save_register_UINT16("mmu", 0, "banks", banks, MMU_SLOTS);
+	state_save_register_func_postload(mmu_remap);
+	mmu_remap();
+}
+
+void mmu_register_write(UINT8 index, UINT8 value) {
+	if (index >= reg_banks_lo) return;
+
+	int slot = index & (MMU_SLOTS - 1);
+	if (index < reg_bank_hi) {
+		banks[slot] = (banks[slot] & 0xFF00) | value;
+	} else {
+		banks[slot] = (banks[slot] & 0x00FF) | (value << 8);
+	}
+	LOGV(LOGTAG, "slot %04X bank %04X", (MMU_SLOT_FIRST + slot) << MEM_PAGE_SHIFT, banks[slot]);
+	mmu_map_slot(slot);
+}
+
+UINT8 mmu_register_read(UINT8 index) {
+	if (index < reg_bank_hi) return banks[index] & 0xFF;
+	if (index < reg_banks_lo) return banks[index - reg_bank_hi] >> 8;
+	switch(index) {
+	case reg_banks_lo:
+		return xram_banks & 0xFF;
+	case reg_banks_hi:
+		return xram_banks >> 8;
+	}
+	return 0;
+}
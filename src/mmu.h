@@ -0,0 +1,33 @@
+#ifndef _MMU_H
+#define _MMU_H
+
+/*
+ * Banked extended RAM
+ *
+ * The 4KB slots 1000-1FFF to 8000-8FFF of the CPU space can each be mapped
+ * onto a 4KB bank of the extended RAM. Bank 0 is the CPU RAM of the slot,
+ * bank n is the bank n-1 of the extended RAM, bank numbers wrap at the
+ * size of the extended RAM.
+ *
+ * Registers, see MMU_START in bus.h and asm/6502/os/symbols.asm:
+ *
+ *   00-07  MMU_BANK_LO  low byte of the bank of slots 1 to 8
+ *   08-0F  MMU_BANK_HI  high byte of the bank of slots 1 to 8
+ *   10-11  MMU_BANKS    number of banks of extended RAM, read only
+ *
+ * The mapping goes into the page table of memory.c, so a banked access
+ * costs the same as plain RAM. Cached code of a slot is dropped when the
+ * slot is mapped again.
+ *
+ * -xram n    size of the extended RAM in KB (default 1024, max 16384),
+ *            0 leaves the slots mapped to the CPU RAM
+ */
+
+#define MMU_SLOT_FIRST 1
+#define MMU_SLOTS      8
+
+void  mmu_init(int argc, char *argv[]);
+void  mmu_register_write(UINT8 index, UINT8 value);
+UINT8 mmu_register_read(UINT8 index);
+
+#endif
@@ -6,9 +6,15 @@
 #include "utils.h"
 #include "bus.h"
 #include "cpu.h"
+#include "cpuexec.h"
 #include "cpu/m6502/m6502.h"
+#include "cpu/m6502/m65ce02.h"
 #include "frontend/frontend.h"
 #include "monitor.h"
+#include "symbols.h"
+#include "monitor_expr.h"
+#include "watch.h"
+#include "profile.h"
 
 bool is_enabled = FALSE;
 bool is_step    = FALSE;
@@ -21,11 +27,28 @@ v_cpu *cpu;
 #define MAX_LINE_SIZE 1000
 
 #define MAX_BREAKPOINTS 100
-unsigned breakpoints[MAX_BREAKPOINTS];
+
+typedef struct {
+	unsigned addr;
+	unsigned hits;
+	char *condition_text;
+	monitor_expr *condition;
+} breakpoint;
+
+breakpoint breakpoints[MAX_BREAKPOINTS];
 unsigned breakpoints_count = 0;
 
-static char *source_lines[0x10000];
-static char *source_labels[0x10000];
+/* one bit per address with a breakpoint, checked before the list */
+static UINT8 breakpoints_map[0x10000 / 8];
+
+#define BREAKPOINT_BIT(addr) (breakpoints_map[(addr) >> 3] & (1 << ((addr) & 7)))
+
+/* listings are parsed on the first monitor use, not at startup */
+#define MAX_SOURCE_FILES 16
+static char *source_files[MAX_SOURCE_FILES];
+static unsigned source_files_count = 0;
+
+static void monitor_source_load();
 
 void monitor_init(v_cpu *monitor_cpu) {
 	cpu = monitor_cpu;
@@ -33,16 +56,24 @@ void monitor_init(v_cpu *monitor_cpu) {
 
 void monitor_enable() {
 	is_enabled = TRUE;
+	cpu_update_hooks();
 }
 
 void monitor_disable() {
 	is_enabled = FALSE;
+	cpu_update_hooks();
 }
 
 bool monitor_is_enabled() {
 	return is_enabled;
 }
 
+/* the monitor needs to look at every instruction */
+bool monitor_is_active() {
+	return is_enabled || is_step || is_stop_at_addr || is_stop_at_ret || breakpoints_count > 0
+			|| watch_is_hit();
+}
+
 static unsigned parse_hex(char *s) {
 	char *saddr = utils_trim(s);
 
@@ -51,10 +82,17 @@ static unsigned parse_hex(char *s) {
 	return addr;
 }
 
+/* a label from the listings or a hex address */
+static unsigned parse_addr(char *s) {
+	UINT16 addr;
+	if (symbols_find(utils_trim(s), &addr)) return addr;
+	return parse_hex(s);
+}
+
 static void dump_registers() {
 	char register_info[1000];
 	char flags[100];
-	if (cpu->cpuType == CPU_M6502) {
+	if (cpu->cpuType == CPU_M6502 || cpu->cpuType == CPU_M65C02) {
 		UINT8 p = cpu->get_reg(M6502_P);
 		sprintf(flags, "N%c V%c R%c B%c D%c I%c Z%c C%c",
 						p & 0x80 ? '+':'-',
@@ -76,6 +114,31 @@ static void dump_registers() {
 			cpu->get_reg(M6502_S),
 			flags
 		);
+	} else if (cpu->cpuType == CPU_M65CE02 || cpu->cpuType == CPU_M4510) {
+		UINT8 p = cpu->get_reg(M65CE02_P);
+		sprintf(flags, "N%c V%c E%c B%c D%c I%c Z%c C%c",
+						p & 0x80 ? '+':'-',
+						p & 0x40 ? '+':'-',
+						p & 0x20 ? '+':'-',
+						p & 0x10 ? '+':'-',
+						p & 0x08 ? '+':'-',
+						p & 0x04 ? '+':'-',
+						p & 0x02 ? '+':'-',
+						p & 0x01 ? '+':'-'
+		);
+
+		/* same register numbers on the 4510 */
+		sprintf(register_info,
+			"A:%02X  X:%02X  Y:%02X  Z:%02X  B:%02X  P:%02X  S:%04X     Flags: %s",
+			cpu->get_reg(M65CE02_A),
+			cpu->get_reg(M65CE02_X),
+			cpu->get_reg(M65CE02_Y),
+			cpu->get_reg(M65CE02_Z),
+			cpu->get_reg(M65CE02_B),
+			p,
+			cpu->get_reg(M65CE02_S),
+			flags
+		);
 	}
 	printf("%s\n", register_info);
 }
@@ -91,6 +154,10 @@ static void set_register(char *register_name, char *value) {
 		reg = M6502_X;
 	} else if (!strcmp(register_name, "y")) {
 		reg = M6502_Y;
+	} else if (!strcmp(register_name, "z") && (cpu->cpuType == CPU_M65CE02 || cpu->cpuType == CPU_M4510)) {
+		reg = M65CE02_Z;
+	} else if (!strcmp(register_name, "b") && (cpu->cpuType == CPU_M65CE02 || cpu->cpuType == CPU_M4510)) {
+		reg = M65CE02_B;
 	}
 	if (reg == 0) return;
 
@@ -101,7 +168,7 @@ static unsigned dump_memory(unsigned addr, unsigned lines) {
 	for(int line=0; line < lines; line++) {
 		printf("%04X|", addr);
 		for(int i=0; i<16; i++) {
-			printf("%02X", bus_read16(addr + i));
+			printf("%02X", bus_peek16(addr + i));
 			if (((i+1) % 4) == 0) {
 				printf("|");
 			} else {
@@ -109,7 +176,7 @@ static unsigned dump_memory(unsigned addr, unsigned lines) {
 			}
 		}
 		for(int i=0; i<16; i++) {
-			UINT8 c = bus_read16(addr + i);
+			UINT8 c = bus_peek16(addr + i);
 			if (0x20 <= c && c <= 0x7F) {
 				printf("%c", c);
 			} else {
@@ -132,7 +199,7 @@ static unsigned dump_code(unsigned addr) {
 	int instructions = next_addr - addr;
 	for(int i=0; i<3; i++) {
 		if (i<instructions) {
-			sprintf(single_byte, "%02X ", bus_read16(addr+i));
+			sprintf(single_byte, "%02X ", bus_peek16(addr+i));
 			strcat(multi_byte, single_byte);
 		} else {
 			strcat(multi_byte, "   ");
@@ -145,13 +212,14 @@ static unsigned dump_code(unsigned addr) {
 			multi_byte, utils_str2upper(disasm));
 
 	char source[1000] = "";
-	if (source_labels[addr]) {
-		strcat(source, source_labels[addr]);
-		strcat(source, " ");
+	const char *source_label = symbols_get_label(addr);
+	const char *source_line  = symbols_get_line(addr);
+	if (source_label) {
+		snprintf(source, sizeof(source), "%s: ", source_label);
 	}
-	if (source_lines[addr]) {
-		strcat(source, source_labels[addr] ? "":"      ");
-		strcat(source, source_lines[addr]);
+	if (source_line) {
+		strcat(source, source_label ? "":"      ");
+		strncat(source, source_line, sizeof(source) - strlen(source) - 1);
 	}
 	if (strlen(source)>0) {
 		strcat(code, "                            ");
@@ -172,53 +240,129 @@ static unsigned disasm(unsigned addr, int lines) {
 	return addr;
 }
 
-void monitor_breakpoint_set(unsigned addr) {
-	if (breakpoints_count == MAX_BREAKPOINTS) return;
-	// ignore if breakpoint exists
+void monitor_breakpoint_set_condition(unsigned addr, const char *condition) {
+	addr &= 0xFFFF;
+
+	monitor_expr *expr = NULL;
+	if (condition) {
+		expr = monitor_expr_compile(condition);
+		if (!expr) return;
+	}
+
+	// replace the condition if the breakpoint exists
+	breakpoint *b = NULL;
 	for(int i=0; i<breakpoints_count; i++) {
-		if (breakpoints[i] == addr) return;
+		if (breakpoints[i].addr == addr) b = &breakpoints[i];
 	}
-	// add breakpoint
-	breakpoints[breakpoints_count++] = addr;
+	if (b) {
+		free(b->condition_text);
+		monitor_expr_free(b->condition);
+	} else {
+		if (breakpoints_count == MAX_BREAKPOINTS) {
+			monitor_expr_free(expr);
+			return;
+		}
+		b = &breakpoints[breakpoints_count++];
+		b->addr = addr;
+		b->hits = 0;
+	}
+	b->condition_text = condition ? strdup(condition) : NULL;
+	b->condition = expr;
+
+	breakpoints_map[addr >> 3] |= 1 << (addr & 7);
+	cpu_update_hooks();
+}
+
+void monitor_breakpoint_set(unsigned addr) {
+	monitor_breakpoint_set_condition(addr, NULL);
 }
 
 void monitor_breakpoint_del(unsigned index) {
 	if (index >= breakpoints_count) return;
 
+	unsigned addr = breakpoints[index].addr;
+	breakpoints_map[addr >> 3] &= ~(1 << (addr & 7));
+	free(breakpoints[index].condition_text);
+	monitor_expr_free(breakpoints[index].condition);
+
 	// remove breakpoint
 	for(int i = index; i<breakpoints_count-1; i++) {
 		breakpoints[i] = breakpoints[i+1];
 	}
 	breakpoints_count--;
+	cpu_update_hooks();
 }
 
 void breakpoints_list() {
 	for(int i=0; i<breakpoints_count; i++) {
-		printf("%02d: ", i);
-		dump_code(breakpoints[i]);
+		printf("%02d: hits:%-5u %s%s\n", i, breakpoints[i].hits,
+				breakpoints[i].condition_text ? "if " : "",
+				breakpoints[i].condition_text ? breakpoints[i].condition_text : "");
+		printf("    ");
+		dump_code(breakpoints[i].addr);
+	}
+}
+
+/* only called for addresses in the bitmap */
+static bool breakpoint_hit(unsigned addr) {
+	for(int i=0; i<breakpoints_count; i++) {
+		breakpoint *b = &breakpoints[i];
+		if (b->addr != addr) continue;
+
+		if (b->condition && !monitor_expr_eval(b->condition, cpu)) return FALSE;
+		b->hits++;
+		return TRUE;
 	}
+	return FALSE;
 }
 
 bool monitor_is_stop(unsigned addr) {
-	return monitor_is_breakpoint(addr)
+	return (BREAKPOINT_BIT(addr) && breakpoint_hit(addr))
 			|| is_step
 			|| (is_stop_at_addr && addr == stop_at_addr)
-			|| (is_stop_at_ret && cpu->is_ret_op(addr) && cpu->is_ret_frame());
+			|| (is_stop_at_ret && cpu->is_ret_op(addr) && cpu->is_ret_frame())
+			|| watch_is_hit();
 }
 
 bool monitor_is_breakpoint(unsigned addr) {
-	for(int i=0; i<breakpoints_count; i++) {
-		if (breakpoints[i] == addr) return TRUE;
-	}
+	return BREAKPOINT_BIT(addr & 0xFFFF) != 0;
+}
 
-	return FALSE;
+static void watch_command(char **parts, unsigned nparts) {
+	if (nparts > 2 && !strcmp(parts[1], "del")) {
+		watch_del(parse_hex(parts[2]));
+	} else if (nparts > 2) {
+		UINT8 type = 0;
+		const char *mode = parts[1];
+		if (*mode == 'v') {
+			type = WATCH_VRAM;
+			mode++;
+		}
+		if (!strcmp(mode, "r")) {
+			type |= WATCH_READ;
+		} else if (!strcmp(mode, "w")) {
+			type |= WATCH_WRITE;
+		} else if (!strcmp(mode, "c")) {
+			type |= WATCH_CHANGE;
+		} else {
+			printf("Unknown watchpoint type %s\n", parts[1]);
+			return;
+		}
+
+		unsigned addr = (type & WATCH_VRAM) ? parse_hex(parts[2]) : parse_addr(parts[2]);
+		unsigned size = nparts > 3 ? parse_hex(parts[3]) : 1;
+		if (!watch_add(addr, size, type)) {
+			printf("Cannot add watchpoint\n");
+		}
+	}
+	watch_list();
 }
 
 void monitor_help() {
 	printf("\nCompy monitor\n\n");
 	printf("Commands:\n");
 	printf("r             Display Registers\n");
-	printf("r reg value   Set Register [pc|a|x|y] with hex value\n");
+	printf("r reg value   Set Register [pc|a|x|y|z|b] with hex value, z b on 65CE02/4510\n");
 	printf("d             Disassembly\n");
 	printf("d addr        Disassembly from address\n");
 	printf("da            Disassembly (again) from PC address\n");
@@ -232,7 +376,18 @@ void monitor_help() {
 	printf("b             Display breakpoints\n");
 	printf("b [set] addr  Set breakpoints at addr\n");
 	printf("b del pos     Del breakpoint at position\n");
+	printf("b addr if exp Set conditional breakpoint, exp uses a x y s p pc [addr]\n");
+	printf("              and == != < > <= >= && || ! & | ^ + -\n");
+	printf("w             Display watchpoints\n");
+	printf("w type addr [len]  Set watchpoint, type r|w|c (read, write, change)\n");
+	printf("                   vr|vw|vc for VRAM addresses\n");
+	printf("w del pos     Del watchpoint at position\n");
+	printf("log           Display log levels\n");
+	printf("log tag level Set log level of tag (or all) to off|error|verbose\n");
+	printf("i             Display idle loop counters\n");
+	printf("p             Display profile regions\n");
 	printf("h             This help\n");
+	printf("              addr can be a hex value or a label\n");
 	printf("x             Exit emulator\n\n");
 }
 
@@ -243,6 +398,9 @@ void monitor_enter() {
 	is_stop_at_addr = FALSE;
 	is_stop_at_ret  = FALSE;
 
+	monitor_source_load();
+	watch_report_hit();
+
 	bool trace_was_enabled = trace_enabled;
 	trace_enabled = FALSE;
 
@@ -274,14 +432,14 @@ void monitor_enter() {
 			if (nparts == 1) {
 				dasm_start = disasm(dasm_start, 16);
 			} else {
-				unsigned addr = parse_hex(parts[1]);
+				unsigned addr = parse_addr(parts[1]);
 				dasm_start = disasm(addr, 16);
 			}
 		} else if (!strcmp(parts[0], "m")) {
 			if (nparts == 1) {
 				mem_start = dump_memory(mem_start, 16);
 			} else {
-				unsigned addr = parse_hex(parts[1]);
+				unsigned addr = parse_addr(parts[1]);
 				mem_start = dump_memory(addr, 16);
 			}
 		} else if (!strcmp(parts[0], "da")) {
@@ -293,24 +451,42 @@ void monitor_enter() {
 					is_stop_at_ret = TRUE;
 					cpu->set_ret_frame();
 				} else {
-					unsigned addr = parse_hex(parts[1]);
+					unsigned addr = parse_addr(parts[1]);
 					stop_at_addr = addr;
 					is_stop_at_addr = TRUE;
 				}
 			}
 		} else if (!strcmp(parts[0], "b")) {
-			if (nparts > 2) {
-				unsigned addr = parse_hex(parts[2]);
-				if (!strcmp(parts[1], "set")) {
-					monitor_breakpoint_set(addr);
-				} else if (!strcmp(parts[1], "del")) {
-					monitor_breakpoint_del(addr);
-				}
+			if (nparts > 2 && !strcmp(parts[1], "del")) {
+				monitor_breakpoint_del(parse_hex(parts[2]));
 			} else if (nparts > 1) {
-				unsigned addr = parse_hex(parts[1]);
-				monitor_breakpoint_set(addr);
+				unsigned arg = strcmp(parts[1], "set") ? 1 : 2;
+				if (arg < nparts) {
+					unsigned addr = parse_addr(parts[arg]);
+					char condition[MAX_LINE_SIZE] = "";
+					if (arg + 2 < nparts && !strcmp(parts[arg+1], "if")) {
+						for(int i=arg+2; i<nparts; i++) {
+							strcat(condition, parts[i]);
+							strcat(condition, " ");
+						}
+					}
+					monitor_breakpoint_set_condition(addr, *condition ? condition : NULL);
+				}
 			}
 			breakpoints_list();
+		} else if (!strcmp(parts[0], "w")) {
+			watch_command(parts, nparts);
+		} else if (!strcmp(parts[0], "log")) {
+			if (nparts > 2 && !trace_set_level(parts[1], parts[2])) {
+				printf("Unknown log level %s\n", parts[2]);
+			}
+			trace_list_levels();
+		} else if (!strcmp(parts[0], "i")) {
+			printf("Idle loops: %llu, cycles skipped: %llu of %llu\n",
+					(unsigned long long)cpu_idle_loops, (unsigned long long)cpu_idle_cycles,
+					(unsigned long long)cpuexec_get_cycles());
+		} else if (!strcmp(parts[0], "p")) {
+			profile_report(stdout);
 		} else if (!strcmp(parts[0], "t")) {
 			unsigned addr = disasm(cpu->get_pc(), 1);
 			stop_at_addr = addr;
@@ -328,152 +504,29 @@ void monitor_enter() {
 		free(line);
 	}
 	trace_enabled = trace_was_enabled;
+	cpu_update_hooks();
 }
 
 /* source code handling */
 
 void monitor_source_init() {
-	memset(source_lines, 0, 0x10000 * sizeof(char *));
-}
-
-static inline void safe_substr(char *dst, char *src, size_t from, size_t n) {
-	if (from<strlen(src)) {
-		strncpy(dst, src + from, n);
-		dst[n] = 0;
-	} else {
-		strcat(dst, "");
-	}
-}
-
-static inline bool is_hex(char c) {
-	return ('0' <= c && c <='9') || ('A' <= c && c <= 'F');
-}
-
-static inline bool is_hex_addr(char *s) {
-	for(int i=0; i<4; i++) if (!is_hex(s[i])) return FALSE;
-	return TRUE;
-}
-
-// look for not byte pattern after byte pattern
-static char *get_source_line(char *line) {
-
-	int i = 7;
-	int state = 0;
-	while (i<strlen(line)) {
-		char c = line[i];
-		bool is_hex_char = is_hex(c);
-		bool is_space_char = c == ' ' || c == '\t';
-
-		switch(state) {
-		case 0:
-			state = is_space_char ? 1 : 0;
-			break;
-		case 1:
-			state = is_hex_char ? 2 : 0;
-			break;
-		case 2:
-			state = is_hex_char ? 3 : 0;
-			break;
-		case 3:
-			state = is_space_char ? 4 : 0;
-			break;
-		case 4:
-			state = is_hex_char ? 2 : 5;
-			break;
-		}
-
-		if (state == 5) return &line[i];
-		i++;
+	for(int i=0; i<source_files_count; i++) {
+		free(source_files[i]);
 	}
-	return NULL;
+	source_files_count = 0;
 }
 
-// look for label pattern
-static char *get_source_label_line(char *line) {
-
-	int i = 7;
-	int state = 0;
-	unsigned start = 0;
-	while (i<strlen(line)) {
-		char c = line[i];
-		bool is_space_char = c == ' ' || c == '\t';
-		bool is_hex_char = is_hex(c);
-		bool is_label_delimiter = c == ':';
-		switch(state) {
-		case 0:
-			state = is_hex_char ? 1 : 0;
-			break;
-		case 1:
-			state = is_hex_char ? 2 : 0;
-			break;
-		case 2:
-			state = is_hex_char ? 3 : 0;
-			break;
-		case 3:
-			state = is_hex_char ? 4 : 0;
-			break;
-		case 4:
-			state = is_space_char ? 4 : 5;
-			if (state == 5) start = i;
-			break;
-		case 5:
-			state = is_space_char ? 6 : (is_label_delimiter ? 7 : 5);
-			break;
-		case 6:
-			return NULL;
-		}
-
-		if (state == 7) return &line[start];
-		i++;
-	}
-	return NULL;
-}
-
-
-static void monitor_source_read_line(char *line) {
-	char buffer[2000];
-
-	safe_substr(buffer, line, 0, 6);
-	char *line_number = utils_trim(buffer);
-	int n = atoi(line_number);
-	if (n == 0) return;
-
-	safe_substr(buffer, line, 7, 5);
-	if (!strcmp(buffer, "FFFF>")) {
-		safe_substr(buffer, line, 13, 4);
-	} else if (is_hex_addr(buffer)) {
-		safe_substr(buffer, line, 7, 4);
-	} else {
-		return;
-	}
-
-	int addr;
-	sscanf(buffer, "%X", &addr);
-	if (source_lines[addr]) {
-		free(source_lines[addr]);
-	}
-
-	char *source_line = get_source_line(line);
-	if (source_line!=NULL) {
-		source_lines[addr] = strdup(utils_trim(source_line));
-	}
-
-	char *label_line = get_source_label_line(line);
-	if (label_line!=NULL) {
-		source_labels[addr] = strdup(utils_trim(label_line));
+static void monitor_source_load() {
+	for(int i=0; i<source_files_count; i++) {
+		symbols_load_listing(source_files[i]);
+		free(source_files[i]);
 	}
+	source_files_count = 0;
 }
 
 void monitor_source_read_file(char *filename) {
-	FILE *f = fopen(filename, "rt");
-	if (!f) {
-		fprintf(stderr, "cannot open file %s", filename);
-		return;
-	}
-
-	char line[1000];
-	while (fgets(line, 1000, f)) {
-		monitor_source_read_line(line);
+	if (source_files_count == MAX_SOURCE_FILES) {
+		monitor_source_load();
 	}
-	fclose(f);
+	source_files[source_files_count++] = strdup(filename);
 }
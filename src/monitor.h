@@ -7,8 +7,10 @@ void monitor_enable();
 void monitor_disable();
 
 bool monitor_is_enabled();
+bool monitor_is_active();
 bool monitor_is_breakpoint(unsigned addr);
 void monitor_breakpoint_set(unsigned addr);
+void monitor_breakpoint_set_condition(unsigned addr, const char *condition);
 void monitor_breakpoint_del(unsigned index);
 bool monitor_is_stop(unsigned addr);
 
@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "emu.h"
+#include "bus.h"
+#include "cpu.h"
+#include "cpu/m6502/m6502.h"
+#include "symbols.h"
+#include "monitor_expr.h"
+
+/*
+ * Expressions are compiled by a recursive descent parser into a
+ * small postfix program, evaluated with a fixed size stack
+ */
+
+enum {
+	OP_VALUE, OP_REG, OP_PC, OP_MEM,
+	OP_NOT, OP_NEG,
+	OP_ADD, OP_SUB, OP_AND, OP_OR, OP_XOR,
+	OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE, OP_GE,
+	OP_LAND, OP_LOR
+};
+
+typedef struct {
+	UINT8    op;
+	unsigned value;
+} expr_op;
+
+#define MAX_EXPR_OPS   64
+#define MAX_EXPR_STACK 32
+
+struct monitor_expr {
+	expr_op  ops[MAX_EXPR_OPS];
+	unsigned count;
+};
+
+typedef struct {
+	const char   *text;
+	const char   *pos;
+	monitor_expr *expr;
+	bool          error;
+} expr_parser;
+
+static const struct {
+	const char *name;
+	int regnum;
+} registers[] = {
+	{"a", M6502_A},
+	{"x", M6502_X},
+	{"y", M6502_Y},
+	{"s", M6502_S},
+	{"p", M6502_P}
+};
+
+#define REGISTERS (sizeof(registers) / sizeof(registers[0]))
+
+static void parse_or(expr_parser *p);
+
+static void parse_error(expr_parser *p, const char *message) {
+	if (!p->error) {
+		printf("%s at \"%s\"\n", message, p->pos);
+	}
+	p->error = TRUE;
+}
+
+static void emit(expr_parser *p, UINT8 op, unsigned value) {
+	if (p->expr->count == MAX_EXPR_OPS) {
+		parse_error(p, "Expression too long");
+		return;
+	}
+	p->expr->ops[p->expr->count].op    = op;
+	p->expr->ops[p->expr->count].value = value;
+	p->expr->count++;
+}
+
+static void skip_spaces(expr_parser *p) {
+	while (isspace((unsigned char)*p->pos)) p->pos++;
+}
+
+/* consume token if it is next */
+static bool accept(expr_parser *p, const char *token) {
+	skip_spaces(p);
+	int len = strlen(token);
+	if (strncmp(p->pos, token, len)) return FALSE;
+	p->pos += len;
+	return TRUE;
+}
+
+static bool is_name_char(char c) {
+	return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '@';
+}
+
+static bool parse_hex_value(const char *s, unsigned *value) {
+	if (!*s) return FALSE;
+	char *end;
+	*value = strtoul(s, &end, 16);
+	return *end == 0;
+}
+
+static void parse_primary(expr_parser *p) {
+	skip_spaces(p);
+	if (accept(p, "(")) {
+		parse_or(p);
+		if (!accept(p, ")")) parse_error(p, "Missing )");
+		return;
+	}
+	if (accept(p, "[")) {
+		parse_or(p);
+		if (!accept(p, "]")) parse_error(p, "Missing ]");
+		emit(p, OP_MEM, 0);
+		return;
+	}
+
+	bool is_hex = accept(p, "$");
+
+	char name[100];
+	int len = 0;
+	while (is_name_char(*p->pos) && len < sizeof(name) - 1) {
+		name[len++] = *p->pos++;
+	}
+	name[len] = 0;
+	if (len == 0) {
+		parse_error(p, "Value expected");
+		return;
+	}
+
+	unsigned value;
+	if (is_hex) {
+		if (!parse_hex_value(name, &value)) parse_error(p, "Invalid hex value");
+		emit(p, OP_VALUE, value);
+		return;
+	}
+
+	if (!strcmp(name, "pc")) {
+		emit(p, OP_PC, 0);
+		return;
+	}
+	for(int i=0; i<REGISTERS; i++) {
+		if (!strcmp(name, registers[i].name)) {
+			emit(p, OP_REG, registers[i].regnum);
+			return;
+		}
+	}
+
+	UINT16 addr;
+	if (symbols_find(name, &addr)) {
+		emit(p, OP_VALUE, addr);
+	} else if (parse_hex_value(name, &value)) {
+		emit(p, OP_VALUE, value);
+	} else {
+		parse_error(p, "Unknown label");
+	}
+}
+
+static void parse_unary(expr_parser *p) {
+	if (accept(p, "!")) {
+		parse_unary(p);
+		emit(p, OP_NOT, 0);
+	} else if (accept(p, "-")) {
+		parse_unary(p);
+		emit(p, OP_NEG, 0);
+	} else {
+		parse_primary(p);
+	}
+}
+
+static void parse_sum(expr_parser *p) {
+	parse_unary(p);
+	while (!p->error) {
+		if (accept(p, "+")) {
+			parse_unary(p);
+			emit(p, OP_ADD, 0);
+		} else if (accept(p, "-")) {
+			parse_unary(p);
+			emit(p, OP_SUB, 0);
+		} else {
+			break;
+		}
+	}
+}
+
+static void parse_bits(expr_parser *p) {
+	parse_sum(p);
+	while (!p->error) {
+		skip_spaces(p);
+		/* do not take the first char of && or || */
+		if (p->pos[0] == p->pos[1]) break;
+
+		if (accept(p, "&")) {
+			parse_sum(p);
+			emit(p, OP_AND, 0);
+		} else if (accept(p, "|")) {
+			parse_sum(p);
+			emit(p, OP_OR, 0);
+		} else if (accept(p, "^")) {
+			parse_sum(p);
+			emit(p, OP_XOR, 0);
+		} else {
+			break;
+		}
+	}
+}
+
+static void parse_compare(expr_parser *p) {
+	static const struct {
+		const char *token;
+		UINT8 op;
+	} compare_ops[] = {
+		{"==", OP_EQ}, {"!=", OP_NE}, {"<=", OP_LE}, {">=", OP_GE},
+		{"<",  OP_LT}, {">",  OP_GT}, {"=",  OP_EQ}
+	};
+
+	parse_bits(p);
+	for(int i=0; i<sizeof(compare_ops) / sizeof(compare_ops[0]); i++) {
+		if (accept(p, compare_ops[i].token)) {
+			parse_bits(p);
+			emit(p, compare_ops[i].op, 0);
+			return;
+		}
+	}
+}
+
+static void parse_and(expr_parser *p) {
+	parse_compare(p);
+	while (!p->error && accept(p, "&&")) {
+		parse_compare(p);
+		emit(p, OP_LAND, 0);
+	}
+}
+
+static void parse_or(expr_parser *p) {
+	parse_and(p);
+	while (!p->error && accept(p, "||")) {
+		parse_and(p);
+		emit(p, OP_LOR, 0);
+	}
+}
+
+monitor_expr *monitor_expr_compile(const char *text) {
+	monitor_expr *expr = malloc(sizeof(monitor_expr));
+	expr->count = 0;
+
+	expr_parser p;
+	p.text  = text;
+	p.pos   = text;
+	p.expr  = expr;
+	p.error = FALSE;
+
+	parse_or(&p);
+	skip_spaces(&p);
+	if (*p.pos) parse_error(&p, "Unexpected text");
+
+	/* worst case stack depth is the number of values */
+	unsigned values = 0;
+	for(int i=0; i<expr->count; i++) {
+		if (expr->ops[i].op <= OP_PC) values++;
+	}
+	if (values > MAX_EXPR_STACK) parse_error(&p, "Expression too long");
+
+	if (p.error) {
+		free(expr);
+		return NULL;
+	}
+	return expr;
+}
+
+unsigned monitor_expr_eval(monitor_expr *expr, v_cpu *cpu) {
+	unsigned stack[MAX_EXPR_STACK];
+	int sp = 0;
+
+	for(int i=0; i<expr->count; i++) {
+		expr_op *op = &expr->ops[i];
+		unsigned a, b;
+		switch(op->op) {
+		case OP_VALUE: stack[sp++] = op->value; continue;
+		case OP_REG:   stack[sp++] = cpu->get_reg(op->value); continue;
+		case OP_PC:    stack[sp++] = cpu->get_pc(); continue;
+		case OP_MEM:   stack[sp-1] = bus_peek16(stack[sp-1]); continue;
+		case OP_NOT:   stack[sp-1] = !stack[sp-1]; continue;
+		case OP_NEG:   stack[sp-1] = -stack[sp-1]; continue;
+		}
+
+		b = stack[--sp];
+		a = stack[sp-1];
+		switch(op->op) {
+		case OP_ADD:  a = a + b; break;
+		case OP_SUB:  a = a - b; break;
+		case OP_AND:  a = a & b; break;
+		case OP_OR:   a = a | b; break;
+		case OP_XOR:  a = a ^ b; break;
+		case OP_EQ:   a = a == b; break;
+		case OP_NE:   a = a != b; break;
+		case OP_LT:   a = a <  b; break;
+		case OP_GT:   a = a >  b; break;
+		case OP_LE:   a = a <= b; break;
+		case OP_GE:   a = a >= b; break;
+		case OP_LAND: a = a && b; break;
+		case OP_LOR:  a = a || b; break;
+		}
+		stack[sp-1] = a;
+	}
+	return sp ? stack[0] : 0;
+}
+
+void monitor_expr_free(monitor_expr *expr) {
+	free(expr);
+}
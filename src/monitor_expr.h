@@ -0,0 +1,23 @@
+#ifndef _MONITOR_EXPR_H
+#define _MONITOR_EXPR_H
+
+/*
+ * Monitor expressions, used by conditional breakpoints
+ *
+ *   registers  a x y s p pc
+ *   values     hex by default ($ prefix optional), or a label
+ *   memory     [addr] reads a byte
+ *   operators  ( ) ! - + & | ^ == != < > <= >= && ||
+ *
+ * A register name always means the register, use $a or 0a for the hex value.
+ * Expressions are compiled once, evaluation does not parse text.
+ */
+
+typedef struct monitor_expr monitor_expr;
+
+/* NULL on syntax errors, the error is printed */
+monitor_expr *monitor_expr_compile(const char *text);
+unsigned      monitor_expr_eval(monitor_expr *expr, v_cpu *cpu);
+void          monitor_expr_free(monitor_expr *expr);
+
+#endif
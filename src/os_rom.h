@@ -0,0 +1,12 @@
+#ifndef _OS_ROM_H
+#define _OS_ROM_H
+
+/*
+ * The OS xex, embedded at build time from asm/6502/os/6502os.xex
+ * See os_rom in the Makefile
+ */
+
+extern const unsigned char os_rom[];
+extern const unsigned int  os_rom_size;
+
+#endif
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <string.h>
+#include "emu.h"
+#include "cpu.h"
+#include "cpuexec.h"
+#include "profile.h"
+
+#define LOGTAG "PROFILE"
+#ifdef TRACE_PROFILE
+#define TRACE
+#endif
+#include "trace.h"
+
+#define reg_begin 0x00
+#define reg_end   0x01
+#define reg_reset 0x02
+
+typedef struct {
+	UINT32 calls;
+	UINT64 cycles;
+	UINT64 self;
+	UINT64 max;
+} profile_region;
+
+typedef struct {
+	UINT8  id;
+	UINT64 start;
+	UINT64 inner;
+} profile_frame;
+
+static profile_region regions[PROFILE_REGIONS];
+static profile_frame  stack[PROFILE_DEPTH];
+static int    depth;
+static UINT32 dropped;
+
+static char profile_file[1000] = "";
+
+void profile_init(int argc, char *argv[]) {
+	for(int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "-profile") && i<argc-1) {
+			strcpy(profile_file, argv[++i]);
+		}
+	}
+	memset(regions, 0, sizeof(regions));
+	depth   = 0;
+	dropped = 0;
+}
+
+static void profile_begin(UINT8 id) {
+	if (depth == PROFILE_DEPTH) {
+		dropped++;
+		return;
+	}
+	stack[depth].id    = id;
+	stack[depth].start = cpuexec_get_cycles();
+	stack[depth].inner = 0;
+	depth++;
+}
+
+/* closes the frame on top, its cycles are inner cycles of the one below */
+static void profile_close(UINT64 now) {
+	profile_frame  *frame  = &stack[--depth];
+	profile_region *region = &regions[frame->id];
+	UINT64 cycles = now - frame->start;
+
+	region->calls++;
+	region->cycles += cycles;
+	region->self   += cycles - frame->inner;
+	if (cycles > region->max) region->max = cycles;
+
+	if (depth) stack[depth-1].inner += cycles;
+}
+
+static void profile_end(UINT8 id) {
+	int open;
+	for(open = depth - 1; open >= 0 && stack[open].id != id; open--);
+	if (open < 0) {
+		LOGV(LOGTAG, "end of region %02X that is not open", id);
+		dropped++;
+		return;
+	}
+
+	UINT64 now = cpuexec_get_cycles();
+	while (depth > open) profile_close(now);
+}
+
+void profile_register_write(UINT8 index, UINT8 value) {
+	switch(index) {
+	case reg_begin:
+		profile_begin(value);
+		break;
+	case reg_end:
+		profile_end(value);
+		break;
+	case reg_reset:
+		memset(regions, 0, sizeof(regions));
+		depth   = 0;
+		dropped = 0;
+		break;
+	}
+}
+
+UINT8 profile_register_read(UINT8 index) {
+	return 0;
+}
+
+void profile_report(FILE *f) {
+	fprintf(f, "region      calls           cycles             self              max      avg\n");
+	for(int id=0; id<PROFILE_REGIONS; id++) {
+		profile_region *region = &regions[id];
+		if (!region->calls) continue;
+		fprintf(f, "    %02X %10u %16llu %16llu %16llu %8llu\n", id, region->calls,
+				(unsigned long long)region->cycles, (unsigned long long)region->self,
+				(unsigned long long)region->max,
+				(unsigned long long)(region->cycles / region->calls));
+	}
+	if (depth)   fprintf(f, "open regions: %d\n", depth);
+	if (dropped) fprintf(f, "ignored markers: %u\n", dropped);
+}
+
+void profile_done() {
+	if (!strlen(profile_file)) return;
+
+	FILE *f = fopen(profile_file, "w");
+	if (!f) {
+		fprintf(stderr, "cannot create profile file %s\n", profile_file);
+		return;
+	}
+	profile_report(f);
+	fclose(f);
+
+	LOGV(LOGTAG, "profile written to %s", profile_file);
+}
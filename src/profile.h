@@ -0,0 +1,31 @@
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+/*
+ * Profile markers for guest code
+ *
+ * Registers, see PROFILE_START in bus.h and asm/6502/os/symbols.asm:
+ *
+ *   0  PROF_BEGIN  writing a region id opens the region
+ *   1  PROF_END    writing a region id closes it, and the regions opened
+ *                  inside it that are still open
+ *   2  PROF_RESET  a write clears all the counters
+ *
+ * Each region counts the calls and the CPU cycles between begin and end,
+ * the total and without the cycles of the regions nested inside it.
+ *
+ * The report is shown by the monitor command "p", and written on exit
+ * to the file given with -profile file
+ */
+
+#define PROFILE_REGIONS 256
+#define PROFILE_DEPTH   64
+
+void  profile_init(int argc, char *argv[]);
+void  profile_done();
+void  profile_report(FILE *f);
+
+void  profile_register_write(UINT8 index, UINT8 value);
+UINT8 profile_register_read(UINT8 index);
+
+#endif
@@ -163,10 +163,11 @@ static uint8 bit4[POLY4_SIZE] =
 static uint8 bit5[POLY5_SIZE] =
       { 0,0,1,1,0,0,0,1,1,1,1,0,0,1,0,1,0,1,1,0,1,1,1,0,1,0,0,0,0,0,1 };
 
-static uint8 bit17[POLY17_SIZE];  /* Rather than have a table with 131071 */
-                            /* entries, I use a random number generator. */
-                            /* It shouldn't make much difference since */
-                            /* the pattern rarely repeats anyway. */
+static uint8 bit17[POLY17_SIZE];  /* Filled on the first register write */
+                            /* from a maximal length 17 bit LFSR, */
+                            /* so no startup cost if sound is not used */
+                            /* and the same pattern on every run. */
+static uint8 bit17_ready = FALSE;
 
 static uint32 Poly_adjust[MAXPOKEYS]; /* the amount that the polynomial will need */
                            /* to be adjusted to process the next bit */
@@ -218,16 +219,23 @@ static uint32 Base_mult[MAXPOKEYS]; /* selects either 64Khz or 15Khz clock mult
 /*                                                                           */
 /*****************************************************************************/
 
-void pokey_sound_init (uint32 freq17, uint16 playback_freq, uint8 num_pokeys)
+static void init_bit17 (void)
 {
-   uint8 chan,chip;
+   uint32 reg = 0x1ffff;
    int32 n;
 
-   /* fill the 17bit polynomial with random bits */
+   /* x^17 + x^14 + 1, maximal length: period 131071 */
    for (n=0; n<POLY17_SIZE; n++)
    {
-      bit17[n] = rand() & 0x01;       /* fill poly 17 with random bits */
+      bit17[n] = reg & 0x01;
+      reg = (reg >> 1) | ((((reg >> 0) ^ (reg >> 3)) & 0x01) << 16);
    }
+   bit17_ready = TRUE;
+}
+
+void pokey_sound_init (uint32 freq17, uint16 playback_freq, uint8 num_pokeys)
+{
+   uint8 chan,chip;
 
    /* disable interrupts to handle critical sections */
    //_disable(); //JH
@@ -299,6 +307,9 @@ void pokey_update_sound (uint16 addr, uint8 val, uint8 chip, uint8 gain)
     uint8 chan_mask;
     uint8 chip_offs;
 
+    /* channels only produce events after a register write */
+    if (!bit17_ready) init_bit17();
+
     /* disable interrupts to handle critical sections */
     //_disable(); //JH
 
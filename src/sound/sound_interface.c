@@ -1,12 +1,20 @@
+#include <stdio.h>
+#include "../emu.h"
 #include "../timer.h"
 #include "sound_interface.h"
 
-static void *sound_update_timer;
-static double refresh_period_inv;
+static timer *sound_update_timer = NULL;
 
+void sound_set_update_timer(timer *which) {
+	sound_update_timer = which;
+}
+
+/* position in a buffer of value samples for the time since the last sound update */
 int sound_scalebufferpos(int value)
 {
-	int result = (int)((double)value * timer_timeelapsed(sound_update_timer) * refresh_period_inv);
+	if (!sound_update_timer || !timer_period(sound_update_timer)) return value;
+
+	int result = (int)((INT64)value * (INT64)timer_elapsed(sound_update_timer) / (INT64)timer_period(sound_update_timer));
 	if (value >= 0) return (result < value) ? result : value;
 	else return (result > value) ? result : value;
 }
@@ -8,6 +8,9 @@ struct MachineSound
 	const char *tag;
 };
 
+struct timer;
+
+void sound_set_update_timer(struct timer *which);
 int sound_scalebufferpos(int value);
 
 #endif
@@ -1,15 +1,18 @@
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <errno.h>
 #include <pthread.h>
-#include <dirent.h>
 
 
 #include "emu.h"
+#include "cpu.h"
+#include "cpuexec.h"
 #include "utils.h"
+#include "storage_backend.h"
+#include "xex.h"
 
 #define LOGTAG "STORAGE"
 #ifdef TRACE_STORAGE
@@ -19,14 +22,6 @@
 
 #define FILENAME_MAX_SIZE 1000
 
-#define RET_SUCCESS             0x00
-#define ERR_INVALID_OPERATION   0x80
-#define ERR_FILE_NOT_FOUND      0x81
-#define ERR_EOF                 0x82
-#define ERR_IO                  0x83
-#define ERR_TOO_MANY_OPEN_FILES 0x84
-#define ERR_INVALID_FILE        0x85
-
 #define CMD_OPEN  0x01
 #define CMD_CLOSE 0x02
 #define CMD_READ_BYTE   0x03
@@ -34,6 +29,8 @@
 #define CMD_DIR_OPEN    0x05
 #define CMD_DIR_ENTRY   0x06
 #define CMD_DIR_CLOSE   0x07
+#define CMD_LOAD_XEX    0x08
+#define CMD_LOAD_XEX_NEXT 0x09
 
 #define STATUS_IDLE       0x00
 #define STATUS_PROCESSING 0x01
@@ -47,28 +44,75 @@
 #define reg_write_reset  0x05
 #define reg_read_reset   0x06
 #define reg_status       0x07
+#define reg_control      0x08
+#define reg_tag          0x09
+#define reg_submit       0x0A
+#define reg_completion   0x0B
+#define reg_pending      0x0C
+#define reg_irq_status   0x0D
 
-#define MAX_OPEN_FILES 128
-FILE *file_handles[MAX_OPEN_FILES];
+#define CONTROL_IRQ_ENABLE 0x01
 
-char root[FILENAME_MAX_SIZE];
+#define IRQ_CAUSE_DONE       0x01
+#define IRQ_CAUSE_COMPLETION 0x02
 
-typedef struct dir_entry {
-	char *name;
-	unsigned size;
-	char *date;
-	char *time;
-	bool is_dir;
-	struct dir_entry *next;
+#define MAX_OPEN_FILES 128
 
-} dir_entry;
+static const storage_backend *backend;
 
+storage_file *file_handles[MAX_OPEN_FILES];
 dir_entry *dir_handles[MAX_OPEN_FILES];
 
 #define CMD_MAX_SIZE 1024
 #define RET_MAX_SIZE 1024
 #define SECTOR_SIZE  256
 
+/*
+ * Commands are processed as requests by a pool of worker threads.
+ *
+ * The guest writes a command into the cmd buffer and then either:
+ * - writes reg_proceed and polls reg_status for STATUS_DONE, the response is
+ *   copied to the ret buffer (one command at a time)
+ * - writes a tag to reg_tag and then writes reg_submit. Several commands can
+ *   be in flight, reading reg_completion returns the tag of a finished command
+ *   (or NO_COMPLETION) and copies its response to the ret buffer.
+ *   Reading reg_submit returns the free slots, with SUBMIT_REJECTED set when
+ *   the last submit found all of them busy and the command was dropped
+ *
+ * Commands on the same file or dir handle are executed in submission order,
+ * commands on different handles run concurrently
+ */
+
+#define MAX_REQUESTS    16
+#define STORAGE_WORKERS 4
+
+#define REQUEST_LEGACY  0
+#define NO_COMPLETION   0xFF
+#define SUBMIT_REJECTED 0x80
+
+typedef enum {
+	REQUEST_FREE,
+	REQUEST_QUEUED,
+	REQUEST_RUNNING,
+	REQUEST_DONE
+} request_state;
+
+typedef struct {
+	UINT8 cmd[CMD_MAX_SIZE];
+	UINT8 ret[RET_MAX_SIZE];
+	UINT8 tag;
+	request_state state;
+	UINT32 sequence;
+	xex_file *xex;
+} storage_request;
+
+static storage_request requests[MAX_REQUESTS];
+static UINT32 submit_sequence = 0;
+static UINT32 done_sequence   = 0;
+
+static bool file_busy[MAX_OPEN_FILES];
+static bool dir_busy[MAX_OPEN_FILES];
+
 UINT8 cmd[CMD_MAX_SIZE];
 UINT8 ret[RET_MAX_SIZE];
 UINT16 cmd_index = 0;
@@ -80,11 +124,24 @@ UINT8 read_data  = 0;
 UINT8 cmd_write_enable = 0;
 UINT8 ret_read_enable = 0;
 
-UINT8 status = 0;
-
-pthread_t processor_thread;
+volatile UINT8 status = 0;
+UINT8 control = 0;
+UINT8 next_tag = 0;
+bool  submit_rejected = FALSE;
+
+/*
+ * irq causes are latched by the worker threads when a command is done and
+ * the completion irq is enabled. The irq line itself is only changed from
+ * the emulation thread, in storage_update() and when reg_irq_status is read
+ */
+volatile UINT8 irq_causes = 0;
+bool irq_asserted = FALSE;
+
+pthread_t processor_threads[STORAGE_WORKERS];
+pthread_mutex_t processor_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t handles_mutex   = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t  processor_cond  = PTHREAD_COND_INITIALIZER;
 bool processor_thread_running = FALSE;
-bool process_command_enable   = FALSE;
 
 static void cmd_write() {
 	if (cmd_index < CMD_MAX_SIZE) {
@@ -99,6 +156,122 @@ static void ret_data() {
 	}
 }
 
+static void ret_set(UINT8 *response) {
+	memcpy(ret, response, RET_MAX_SIZE);
+	ret_index = 0;
+	ret_data();
+}
+
+/* called with processor_mutex locked */
+static void submit(storage_request *request, UINT8 tag) {
+	memcpy(request->cmd, cmd, CMD_MAX_SIZE);
+	request->tag = tag;
+	request->state = REQUEST_QUEUED;
+	request->sequence = submit_sequence++;
+	request->xex = NULL;
+	cmd_index = 0;
+	pthread_cond_signal(&processor_cond);
+}
+
+static void submit_legacy() {
+	pthread_mutex_lock(&processor_mutex);
+	storage_request *request = &requests[REQUEST_LEGACY];
+
+	/* the guest did not read the status of the previous command */
+	if (request->state == REQUEST_DONE) {
+		if (request->xex) xex_free(request->xex);
+		request->xex = NULL;
+		request->state = REQUEST_FREE;
+	}
+	if (request->state == REQUEST_FREE) {
+		status = STATUS_PROCESSING;
+		submit(request, 0);
+	}
+	pthread_mutex_unlock(&processor_mutex);
+}
+
+static void submit_tagged() {
+	pthread_mutex_lock(&processor_mutex);
+	submit_rejected = TRUE;
+	for(int i=REQUEST_LEGACY+1; i<MAX_REQUESTS; i++) {
+		if (requests[i].state == REQUEST_FREE) {
+			submit(&requests[i], next_tag);
+			submit_rejected = FALSE;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&processor_mutex);
+
+	/* a rejected command is dropped, the next one starts from scratch */
+	if (submit_rejected) {
+		LOGV(LOGTAG, "tagged command %02X rejected, no free slots", next_tag);
+		cmd_index = 0;
+	}
+}
+
+/*
+ * xex files are parsed by the workers and written to memory from the
+ * emulation thread, when the guest gets the result of the command.
+ * Only the first stage is written, the guest calls its INITAD and then
+ * asks for the next one with CMD_LOAD_XEX_NEXT
+ */
+static void load_xex(storage_request *request) {
+	if (request->xex) {
+		xex_stage(request->xex);
+		request->xex = NULL;
+	} else if (request->cmd[0] == CMD_LOAD_XEX_NEXT && !xex_next_stage()) {
+		request->ret[0] = 1;
+		request->ret[1] = ERR_EOF;
+	}
+}
+
+/*
+ * the legacy response is kept in its request until the guest reads
+ * STATUS_DONE, the ret buffer is only written by the emulation thread
+ */
+static void legacy_done() {
+	pthread_mutex_lock(&processor_mutex);
+	storage_request *request = &requests[REQUEST_LEGACY];
+	if (request->state == REQUEST_DONE) {
+		load_xex(request);
+		ret_set(request->ret);
+		request->state = REQUEST_FREE;
+	}
+	status = STATUS_IDLE;
+	pthread_mutex_unlock(&processor_mutex);
+}
+
+static UINT8 get_completion() {
+	UINT8 tag = NO_COMPLETION;
+
+	pthread_mutex_lock(&processor_mutex);
+	storage_request *completed = NULL;
+	for(int i=REQUEST_LEGACY+1; i<MAX_REQUESTS; i++) {
+		storage_request *request = &requests[i];
+		if (request->state == REQUEST_DONE && (!completed || request->sequence < completed->sequence)) {
+			completed = request;
+		}
+	}
+	if (completed) {
+		load_xex(completed);
+		ret_set(completed->ret);
+		tag = completed->tag;
+		completed->state = REQUEST_FREE;
+	}
+	pthread_mutex_unlock(&processor_mutex);
+	return tag;
+}
+
+static UINT8 count_requests(request_state state) {
+	UINT8 count = 0;
+	pthread_mutex_lock(&processor_mutex);
+	for(int i=REQUEST_LEGACY+1; i<MAX_REQUESTS; i++) {
+		if (requests[i].state == state) count++;
+	}
+	pthread_mutex_unlock(&processor_mutex);
+	return count;
+}
+
 void storage_register_write(UINT8 index, UINT8 value) {
 	switch(index) {
 	case reg_write_enable:
@@ -119,8 +292,33 @@ void storage_register_write(UINT8 index, UINT8 value) {
 		ret_index = 0;
 		break;
 	case reg_proceed:
-		process_command_enable = TRUE;
+		submit_legacy();
 		break;
+	case reg_control:
+		control = value;
+		break;
+	case reg_tag:
+		next_tag = value;
+		break;
+	case reg_submit:
+		submit_tagged();
+		break;
+	}
+}
+
+static UINT8 irq_acknowledge() {
+	UINT8 causes = __sync_fetch_and_and(&irq_causes, 0);
+	if (irq_asserted) {
+		irq_asserted = FALSE;
+		cpuexec_irq(0);
+	}
+	return causes;
+}
+
+void storage_update() {
+	if (irq_causes && !irq_asserted) {
+		irq_asserted = TRUE;
+		cpuexec_irq(1);
 	}
 }
 
@@ -134,116 +332,205 @@ UINT8 storage_register_read(UINT8 index) {
 		return read_data;
 	case reg_status:
 		if (status == STATUS_DONE) {
-			status = STATUS_IDLE;
+			legacy_done();
 			return STATUS_DONE;
 		}
 		return status;
+	case reg_control:
+		return control;
+	case reg_tag:
+		return next_tag;
+	case reg_submit:
+		return count_requests(REQUEST_FREE) | (submit_rejected ? SUBMIT_REJECTED : 0);
+	case reg_completion:
+		return get_completion();
+	case reg_pending:
+		return MAX_REQUESTS - 1 - count_requests(REQUEST_FREE);
+	case reg_irq_status:
+		return irq_acknowledge();
 	}
 	return 0;
 }
 
-static void build_path(char *fullpath, char *path) {
-	strncpy(fullpath, root, FILENAME_MAX_SIZE);
+static bool has_gz_extension(const char *path) {
+	size_t len = strlen(path);
+	return len > 3 && !strcmp(path + len - 3, ".gz");
+}
 
-	if (path[0]) {
-		if (path[0] != '/') {
-			strcat(fullpath, "/");
-		}
-		strncat(fullpath, path, FILENAME_MAX_SIZE - strlen(fullpath));
+static bool is_compressed(storage_file *file) {
+	if (file->data) return storage_gz_is_compressed(file->data, file->size);
+
+	UINT8 magic[2];
+	int n = file->backend->read(file, magic, 2);
+	file->backend->seek(file, 0);
+	return n > 0 && storage_gz_is_compressed(magic, n);
+}
+
+/* replace a compressed file by a view of its decompressed contents */
+static storage_file *open_gz_file(storage_file *file, const char *path, UINT8 *error) {
+	char key[FILENAME_MAX_SIZE+16];
+	snprintf(key, sizeof(key), "%s:%s", backend->name, path);
+
+	storage_gz_entry *gz;
+	if (file->data) {
+		gz = storage_gz_get_buffer(key, file->mtime, file->data, file->size);
+	} else {
+		UINT8 *data = malloc(file->size ? file->size : 1);
+		int n = file->backend->read(file, data, file->size);
+		gz = n == file->size ? storage_gz_get_buffer(key, file->mtime, data, file->size) : NULL;
+		free(data);
+	}
+
+	time_t mtime = file->mtime;
+	file->backend->close(file);
+	if (!gz) {
+		*error = ERR_IO;
+		return NULL;
 	}
+
+	storage_file *handle = storage_memory_open(&storage_memory_backend, gz->data, gz->size, mtime);
+	handle->gz = gz;
+	return handle;
 }
 
-static void cmd_storage_open() {
-	char filename[FILENAME_MAX_SIZE+1];
-	char *mode = (cmd[1] == 0) ? "rb":"wb";
+/*
+ * gzip files are decompressed transparently, in any backend.
+ * If "name" does not exist "name.gz" is tried, directories cannot be opened
+ */
+static storage_file *open_file(storage_request *req, char *path, bool write) {
+	UINT8 error = RET_SUCCESS;
+	storage_file *file = NULL;
+
+	char gz_path[FILENAME_MAX_SIZE+4];
+	if (!write) {
+		storage_stat st;
+		bool found = backend->stat(path, &st);
+		if (!found && !has_gz_extension(path)) {
+			snprintf(gz_path, sizeof(gz_path), "%s.gz", path);
+			found = backend->stat(gz_path, &st);
+			if (found) path = gz_path;
+		}
+		if (!found) {
+			error = ERR_FILE_NOT_FOUND;
+		} else if (st.is_dir) {
+			error = ERR_INVALID_FILE;
+		}
+	}
 
-	build_path(filename, (char *)(cmd+2));
+	if (error == RET_SUCCESS) file = backend->open(path, write, &error);
 
-	LOGV(LOGTAG, "try open file %s mode %s", filename, mode);
-	FILE *file_handle = fopen(filename, mode);
-	if (!file_handle) {
-		LOGV(LOGTAG, "cannot open file %s err %s", filename, strerror(errno));
-		ret[0] = 1;
-		ret[1] = errno == ENOENT ? ERR_FILE_NOT_FOUND : ERR_IO;
-		return;
+	if (file && !write && is_compressed(file)) {
+		file = open_gz_file(file, path, &error);
 	}
 
+	if (!file) {
+		req->ret[0] = 1;
+		req->ret[1] = error;
+	}
+	return file;
+}
+
+static void close_file_handle(storage_file *handle) {
+	handle->backend->close(handle);
+}
+
+static void cmd_storage_open(storage_request *req) {
+	char *path = (char *)(req->cmd+2);
+
+	storage_file *handle = open_file(req, path, req->cmd[1] != 0);
+	if (!handle) return;
+
+	pthread_mutex_lock(&handles_mutex);
 	for(int i=0; i<MAX_OPEN_FILES; i++) {
 		if (!file_handles[i]) {
-			file_handles[i] = file_handle;
+			file_handles[i] = handle;
+			pthread_mutex_unlock(&handles_mutex);
 
-			ret[0] = 2;
-			ret[1] = RET_SUCCESS;
-			ret[2] = i;
+			req->ret[0] = 2;
+			req->ret[1] = RET_SUCCESS;
+			req->ret[2] = i;
 			return;
 		}
 	}
+	pthread_mutex_unlock(&handles_mutex);
 
-	ret[0] = 1;
-	ret[1] = ERR_TOO_MANY_OPEN_FILES;
+	close_file_handle(handle);
+	req->ret[0] = 1;
+	req->ret[1] = ERR_TOO_MANY_OPEN_FILES;
 }
 
-static FILE *get_file_handle(UINT8 file_handle_index) {
-	if (file_handle_index < MAX_OPEN_FILES) {
-		FILE *file_handle = file_handles[file_handle_index];
-		if (file_handle) {
-			return file_handle;
-		} else {
-			ret[0] = 1;
-			ret[1] = ERR_INVALID_FILE;
-		}
+/*
+ * handles are looked up and released under handles_mutex. The busy flags in
+ * next_request keep two workers from running commands on the same handle, so
+ * the file and its position are only used by one command at a time
+ */
+static storage_file *get_file_handle(storage_request *req, UINT8 file_handle_index) {
+	if (file_handle_index >= MAX_OPEN_FILES) {
+		req->ret[0] = 1;
+		req->ret[1] = ERR_INVALID_OPERATION;
+		return NULL;
 	}
-	ret[0] = 1;
-	ret[1] = ERR_INVALID_OPERATION;
-	return NULL;
+
+	pthread_mutex_lock(&handles_mutex);
+	storage_file *file_handle = file_handles[file_handle_index];
+	pthread_mutex_unlock(&handles_mutex);
+
+	if (!file_handle) {
+		req->ret[0] = 1;
+		req->ret[1] = ERR_INVALID_FILE;
+	}
+	return file_handle;
 }
 
-static void cmd_storage_close() {
-	UINT8 file_handle_index = cmd[1];
-	FILE *file_handle = get_file_handle(file_handle_index);
-	if (!file_handle) return;
+/* the slot is cleared before the file is closed, nobody can get it from now on */
+static void cmd_storage_close(storage_request *req) {
+	UINT8 file_handle_index = req->cmd[1];
+	if (!get_file_handle(req, file_handle_index)) return;
 
-	fclose(file_handle);
+	pthread_mutex_lock(&handles_mutex);
+	storage_file *file_handle = file_handles[file_handle_index];
 	file_handles[file_handle_index] = NULL;
-	ret[0] = 1;
-	ret[1] = RET_SUCCESS;
+	pthread_mutex_unlock(&handles_mutex);
+
+	close_file_handle(file_handle);
+	req->ret[0] = 1;
+	req->ret[1] = RET_SUCCESS;
 }
 
-static void cmd_read_byte() {
-	FILE *file_handle = get_file_handle(cmd[1]);
+static void cmd_read_byte(storage_request *req) {
+	storage_file *file_handle = get_file_handle(req, req->cmd[1]);
 	if (!file_handle) return;
 
-	int c = fgetc(file_handle);
-	if (c == EOF) {
-		ret[0] = 1;
-		ret[1] = ERR_EOF;
+	UINT8 c;
+	int n = file_handle->backend->read(file_handle, &c, 1);
+	if (n <= 0) {
+		req->ret[0] = 1;
+		req->ret[1] = n ? ERR_IO : ERR_EOF;
 	} else {
-		ret[0] = 2;
-		ret[1] = RET_SUCCESS;
-		ret[2] = c;
+		req->ret[0] = 2;
+		req->ret[1] = RET_SUCCESS;
+		req->ret[2] = c;
 		LOGV(LOGTAG, "read byte %02X", c);
 	}
 }
 
-static void cmd_read_sector() {
-	FILE *file_handle = get_file_handle(cmd[1]);
+static void cmd_read_sector(storage_request *req) {
+	storage_file *file_handle = get_file_handle(req, req->cmd[1]);
 	if (!file_handle) return;
 
-	UINT8 buffer[SECTOR_SIZE];
-	int n = fread(buffer, 1, SECTOR_SIZE, file_handle);
-	if (n) {
-		ret[0] = 3;
-		ret[1] = RET_SUCCESS;
-		ret[2] = n % SECTOR_SIZE;
-		memcpy(&ret[3], buffer, n);
+	int n = file_handle->backend->read(file_handle, &req->ret[3], SECTOR_SIZE);
+	if (n > 0) {
+		req->ret[0] = 3;
+		req->ret[1] = RET_SUCCESS;
+		req->ret[2] = n % SECTOR_SIZE;
 		LOGV(LOGTAG, "read block size %02X", n);
-	} else if (feof(file_handle)) {
-		ret[0] = 1;
-		ret[1] = ERR_EOF;
+	} else if (n == 0) {
+		req->ret[0] = 1;
+		req->ret[1] = ERR_EOF;
 		LOGV(LOGTAG, "read block EOF");
 	} else {
-		ret[0] = 1;
-		ret[1] = ERR_IO;
+		req->ret[0] = 1;
+		req->ret[1] = ERR_IO;
 	}
 }
 
@@ -254,79 +541,26 @@ static int get_new_dir_handle() {
 	return -1;
 }
 
-static void stat_dir_entry(char *dirname, dir_entry *entry) {
-	static char name[FILENAME_MAX_SIZE];
-	strcpy(name, dirname);
-	strcat(name, "/");
-	strcat(name, entry->name);
-
-	static struct stat entry_stat;
-	stat(name, &entry_stat);
-
-	entry->size = entry_stat.st_size;
-	entry->is_dir = S_ISDIR(entry_stat.st_mode);
-	entry->date = utils_format_date(entry_stat.st_mtime);
-	entry->time = utils_format_time(entry_stat.st_mtime);
-}
+static void cmd_read_dir(storage_request *req) {
+	int mode = req->cmd[1];
+	char *path = (char *)(&req->cmd[2]);
 
-static void cmd_read_dir() {
-	int dir_handle = get_new_dir_handle();
-	if (dir_handle < 0) {
-		ret[0] = 1;
-		ret[1] = ERR_TOO_MANY_OPEN_FILES;
+	storage_stat st;
+	bool found = backend->stat(path, &st);
+	if (!found || !st.is_dir) {
+		req->ret[0] = 1;
+		req->ret[1] = found ? ERR_INVALID_FILE : ERR_FILE_NOT_FOUND;
 		return;
 	}
 
-	int mode = cmd[1];
-
-	char dirname[FILENAME_MAX_SIZE];
-	build_path(dirname, (char *)(&cmd[2]));
-
-	bool is_root = !strcmp(root, dirname);
-
-	struct dirent **namelist;
-	dir_entry *head = NULL;
 	unsigned entries = 0;
-	int n = scandir(dirname, &namelist, 0, alphasort);
-	for (int i = 0; i < n; i++) {
-		struct dirent *dirent = namelist[i];
-
-		if (!strcmp(dirent->d_name, ".")) continue;
-		if (!strcmp(dirent->d_name, "..")) {
-			if (is_root) continue;
-		} else {
-			if (!(mode & 1) && dirent->d_name[0] == '.') continue;
-		}
-
-		dir_entry *entry = malloc(sizeof(dir_entry));
-		entry->name = strdup(dirent->d_name);
-		entry->next = NULL;
-
-		stat_dir_entry(dirname, entry);
-
-		if ((mode & 2) && entry->is_dir) {
-			free(entry);
-			continue;
-		}
-
-		if (head == NULL) {
-			head = entry;
-			dir_handles[dir_handle] = head;
-		} else {
-			head->next = entry;
-			head = entry;
-		}
-		entries++;
-
-		free(dirent);
-	}
-	free(namelist);
+	dir_entry *head = backend->list(path, mode, &entries);
+	dir_entry *first = head;
 
 	// put folders first
 	if (!(mode % 4) && entries>0) {
 		int sorted_entries = 0;
 		dir_entry *sorted[entries];
-		head = dir_handles[dir_handle];
 
 		// add folders
 		dir_entry *entry = head;
@@ -342,7 +576,7 @@ static void cmd_read_dir() {
 			entry = entry->next;
 		}
 		head = sorted[0];
-		dir_handles[dir_handle] = head;
+		first = head;
 		for(int i=1; i<entries; i++) {
 			head->next = sorted[i];
 			head = sorted[i];
@@ -351,135 +585,316 @@ static void cmd_read_dir() {
 
 	}
 
-	ret[0] = 4;
-	ret[1] = RET_SUCCESS;
-	ret[2] = dir_handle;
-	ret[3] = entries & 0xFF;
-	ret[4] = entries >> 8;
+	pthread_mutex_lock(&handles_mutex);
+	int dir_handle = get_new_dir_handle();
+	if (dir_handle >= 0) dir_handles[dir_handle] = first;
+	pthread_mutex_unlock(&handles_mutex);
+
+	if (dir_handle < 0) {
+		storage_free_dir_entries(first);
+		req->ret[0] = 1;
+		req->ret[1] = ERR_TOO_MANY_OPEN_FILES;
+		return;
+	}
 
-	LOGV(LOGTAG, "open dir %s %d entries", dirname, entries);
+	req->ret[0] = 4;
+	req->ret[1] = RET_SUCCESS;
+	req->ret[2] = dir_handle;
+	req->ret[3] = entries & 0xFF;
+	req->ret[4] = entries >> 8;
 }
 
-static dir_entry *get_dir_entries(int dir_handle) {
+static dir_entry *get_dir_entries(storage_request *req, unsigned dir_handle) {
+	if (dir_handle >= MAX_OPEN_FILES) {
+		req->ret[0] = 1;
+		req->ret[1] = ERR_INVALID_FILE;
+		return NULL;
+	}
+
+	pthread_mutex_lock(&handles_mutex);
 	dir_entry *entries = dir_handles[dir_handle];
+	pthread_mutex_unlock(&handles_mutex);
 	if (entries) return entries;
 
-	ret[0] = 1;
-	ret[1] = ERR_INVALID_FILE;
+	req->ret[0] = 1;
+	req->ret[1] = ERR_INVALID_FILE;
 	return NULL;
 }
 
-static void cmd_get_dir_entry() {
-	dir_entry *entry = get_dir_entries(cmd[1]);
+static void cmd_get_dir_entry(storage_request *req) {
+	dir_entry *entry = get_dir_entries(req, req->cmd[1]);
 	if (entry == NULL) return;
 
-	unsigned index = cmd[2] + (cmd[3]<<8);
+	unsigned index = req->cmd[2] + (req->cmd[3]<<8);
 	while (index > 0 && entry->next != NULL) {
 		index--;
 		entry = entry->next;
 	}
 
 	if (index == 0) {
-		ret[0] = 0;
-		ret[1] = RET_SUCCESS;
-		ret[2] = entry->is_dir ? 1 : 0;
-		ret[3] = entry->size & 0xFF;
-		ret[4] = (entry->size & 0x0000FF00) >> 8;
-		ret[5] = (entry->size & 0x00FF0000) >> 16;
-		ret[6] = (entry->size & 0xFF000000) >> 24;
-		strcpy((char *)&ret[7], entry->date);
-		strcpy((char *)&ret[15], entry->time);
-		strcpy((char *)&ret[21], entry->name);
+		req->ret[0] = 0;
+		req->ret[1] = RET_SUCCESS;
+		req->ret[2] = entry->is_dir ? 1 : 0;
+		req->ret[3] = entry->size & 0xFF;
+		req->ret[4] = (entry->size & 0x0000FF00) >> 8;
+		req->ret[5] = (entry->size & 0x00FF0000) >> 16;
+		req->ret[6] = (entry->size & 0xFF000000) >> 24;
+		strcpy((char *)&req->ret[7], entry->date);
+		strcpy((char *)&req->ret[15], entry->time);
+		strcpy((char *)&req->ret[21], entry->name);
 
 		LOGV(LOGTAG, "get dir entry %s %s %s %s %d", entry->name, BOOLSTR(entry->is_dir),
 				entry->date, entry->time, entry->size);
 	} else {
-		ret[0] = 1;
-		ret[1] = ERR_EOF;
+		req->ret[0] = 1;
+		req->ret[1] = ERR_EOF;
 	}
 }
 
-static void cmd_close_dir() {
-	unsigned dir_index = cmd[1];
-	dir_entry *entry = get_dir_entries(dir_index);
+static void cmd_close_dir(storage_request *req) {
+	unsigned dir_index = req->cmd[1];
+	dir_entry *entry = get_dir_entries(req, dir_index);
 	if (entry == NULL) return;
 
-	while (entry != NULL) {
-		free(entry->name);
-		free(entry->date);
-		free(entry->time);
+	pthread_mutex_lock(&handles_mutex);
+	dir_handles[dir_index] = NULL;
+	pthread_mutex_unlock(&handles_mutex);
 
-		dir_entry *next = entry->next;
-		free(entry);
-		entry = next;
-	};
+	storage_free_dir_entries(entry);
 
 	LOGV(LOGTAG, "dir closed");
 
-	cmd[0] = 1;
-	cmd[1] = RET_SUCCESS;
+	req->ret[0] = 1;
+	req->ret[1] = RET_SUCCESS;
 }
 
 
-static void process_command() {
-	status = STATUS_PROCESSING;
+/*
+ * Load a xex file directly into memory, up to the first segment that sets INITAD
+ * The response has the last RUNAD and the first INITAD values set by the file, or 0
+ */
+static void cmd_load_xex(storage_request *req) {
+	char *path = (char *)(req->cmd+1);
+
+	storage_file *file = open_file(req, path, FALSE);
+	if (!file) return;
+
+	UINT32 capacity = SECTOR_SIZE;
+	UINT32 size = 0;
+	UINT8 *data = malloc(capacity);
+	int n;
+	while ((n = file->backend->read(file, data + size, capacity - size)) > 0) {
+		size += n;
+		if (size == capacity) {
+			capacity *= 2;
+			data = realloc(data, capacity);
+		}
+	}
+	close_file_handle(file);
 
-	switch(cmd[0]) {
-	case CMD_OPEN  :       cmd_storage_open();  break;
-	case CMD_CLOSE :       cmd_storage_close(); break;
-	case CMD_READ_BYTE :   cmd_read_byte();     break;
-	case CMD_READ_SECTOR : cmd_read_sector();   break;
-	case CMD_DIR_OPEN :    cmd_read_dir();      break;
-	case CMD_DIR_ENTRY :   cmd_get_dir_entry(); break;
-	case CMD_DIR_CLOSE :   cmd_close_dir();     break;
+	if (n < 0) {
+		free(data);
+		req->ret[0] = 1;
+		req->ret[1] = ERR_IO;
+		return;
 	}
 
-	ret_index = 0;
-	cmd_index = 0;
-	ret_data();
+	xex_file *xex = xex_parse(data, size);
+	if (!xex) {
+		req->ret[0] = 1;
+		req->ret[1] = ERR_INVALID_FORMAT;
+		return;
+	}
+
+	LOGV(LOGTAG, "load xex %s %d segments", path, xex->segments_count);
+
+	UINT16 run  = xex->has_run  ? xex->run  : 0;
+	UINT16 init = xex->has_init ? xex->init : 0;
+	req->xex = xex;
+	req->ret[0] = 5;
+	req->ret[1] = RET_SUCCESS;
+	req->ret[2] = run & 0xFF;
+	req->ret[3] = run >> 8;
+	req->ret[4] = init & 0xFF;
+	req->ret[5] = init >> 8;
+}
+
+/*
+ * Load the next stage of the xex file, up to the next segment that sets INITAD
+ * ERR_EOF is set when the guest gets the response if the whole file was loaded
+ */
+static void cmd_load_xex_next(storage_request *req) {
+	req->ret[0] = 1;
+	req->ret[1] = RET_SUCCESS;
+}
+
+static void process_command(storage_request *req) {
+	switch(req->cmd[0]) {
+	case CMD_OPEN  :       cmd_storage_open(req);  break;
+	case CMD_CLOSE :       cmd_storage_close(req); break;
+	case CMD_READ_BYTE :   cmd_read_byte(req);     break;
+	case CMD_READ_SECTOR : cmd_read_sector(req);   break;
+	case CMD_DIR_OPEN :    cmd_read_dir(req);      break;
+	case CMD_DIR_ENTRY :   cmd_get_dir_entry(req); break;
+	case CMD_DIR_CLOSE :   cmd_close_dir(req);     break;
+	case CMD_LOAD_XEX :    cmd_load_xex(req);      break;
+	case CMD_LOAD_XEX_NEXT : cmd_load_xex_next(req); break;
+	}
+}
 
-	status = STATUS_DONE;
+/* the file or dir handle busy flag used by a request, if any */
+static bool *get_busy_flag(storage_request *request) {
+	UINT8 handle = request->cmd[1];
+	if (handle >= MAX_OPEN_FILES) return NULL;
+
+	switch(request->cmd[0]) {
+	case CMD_CLOSE :
+	case CMD_READ_BYTE :
+	case CMD_READ_SECTOR :
+		return &file_busy[handle];
+	case CMD_DIR_ENTRY :
+	case CMD_DIR_CLOSE :
+		return &dir_busy[handle];
+	}
+	return NULL;
+}
+
+/*
+ * oldest queued request whose handle is not being used by another worker
+ * called with processor_mutex locked
+ */
+static storage_request *next_request() {
+	storage_request *next = NULL;
+	for(int i=0; i<MAX_REQUESTS; i++) {
+		storage_request *request = &requests[i];
+		if (request->state != REQUEST_QUEUED) continue;
+		if (next && next->sequence < request->sequence) continue;
+
+		next = request;
+	}
+	if (!next) return NULL;
+
+	/* keep the submission order for requests on the same handle */
+	bool *busy = get_busy_flag(next);
+	if (busy && *busy) {
+		storage_request *other = NULL;
+		for(int i=0; i<MAX_REQUESTS; i++) {
+			storage_request *request = &requests[i];
+			if (request->state != REQUEST_QUEUED) continue;
+			bool *request_busy = get_busy_flag(request);
+			if (request_busy == busy || (request_busy && *request_busy)) continue;
+			if (other && other->sequence < request->sequence) continue;
+
+			other = request;
+		}
+		next = other;
+	}
+	return next;
+}
+
+/* called with processor_mutex locked */
+static void complete_request(storage_request *request) {
+	if (request == &requests[REQUEST_LEGACY]) {
+		request->state = REQUEST_DONE;
+		__sync_synchronize();
+		status = STATUS_DONE;
+		if (control & CONTROL_IRQ_ENABLE) __sync_fetch_and_or(&irq_causes, IRQ_CAUSE_DONE);
+	} else {
+		request->state = REQUEST_DONE;
+		request->sequence = done_sequence++;
+		if (control & CONTROL_IRQ_ENABLE) __sync_fetch_and_or(&irq_causes, IRQ_CAUSE_COMPLETION);
+	}
 }
 
 static void *processor_thread_function(void *data) {
+	pthread_mutex_lock(&processor_mutex);
 	while(processor_thread_running) {
-		if (process_command_enable) {
-			process_command();
-			process_command_enable = FALSE;
+		storage_request *request = next_request();
+		if (request) {
+			bool *busy = get_busy_flag(request);
+			if (busy) *busy = TRUE;
+			request->state = REQUEST_RUNNING;
+			pthread_mutex_unlock(&processor_mutex);
+
+			process_command(request);
+
+			pthread_mutex_lock(&processor_mutex);
+			if (busy) *busy = FALSE;
+			complete_request(request);
+
+			/* requests waiting for this handle can proceed now */
+			pthread_cond_broadcast(&processor_cond);
 		} else {
-			usleep(5000);
+			pthread_cond_wait(&processor_cond, &processor_mutex);
 		}
 	}
+	pthread_mutex_unlock(&processor_mutex);
 	return NULL;
 }
 
+/*
+ * -storage path    root of the storage: a host directory or a storage image
+ * -ramdisk         load the root directory in memory at startup
+ */
 void storage_init(int argc, char *argv[]) {
-	processor_thread_running = TRUE;
-	int ret = pthread_create(&processor_thread, NULL, processor_thread_function, NULL);
-	if (ret) {
-		fprintf(stderr,"Error - pthread_create() return code: %d\n",ret);
-		exit(EXIT_FAILURE);
-	}
-
+	char root[FILENAME_MAX_SIZE];
 	getcwd(root, FILENAME_MAX_SIZE);
 
-	for(int i=0; i<argc-1; i++) {
-		if (!strcmp(argv[i], "-storage")) {
+	bool ramdisk = FALSE;
+	for(int i=0; i<argc; i++) {
+		if (!strcmp(argv[i], "-storage") && i<argc-1) {
 			realpath(argv[i+1], root);
 
 			int last_char = strlen(root)-1;
 			if (root[last_char] == '/') root[last_char] = 0;
+		} else if (!strcmp(argv[i], "-ramdisk")) {
+			ramdisk = TRUE;
+		}
+	}
+
+	struct stat root_stat;
+	if (!stat(root, &root_stat) && S_ISREG(root_stat.st_mode)) {
+		backend = &storage_image_backend;
+	} else {
+		backend = ramdisk ? &storage_ram_backend : &storage_host_backend;
+	}
+
+	LOGV(LOGTAG, "storage root %s backend %s", root, backend->name);
+	if (!backend->mount(root)) {
+		exit(EXIT_FAILURE);
+	}
+
+	processor_thread_running = TRUE;
+	for(int i=0; i<STORAGE_WORKERS; i++) {
+		int ret = pthread_create(&processor_threads[i], NULL, processor_thread_function, NULL);
+		if (ret) {
+			fprintf(stderr,"Error - pthread_create() return code: %d\n",ret);
+			exit(EXIT_FAILURE);
 		}
 	}
 }
 
 void storage_done() {
+	pthread_mutex_lock(&processor_mutex);
 	processor_thread_running = FALSE;
+	pthread_cond_broadcast(&processor_cond);
+	pthread_mutex_unlock(&processor_mutex);
+	for(int i=0; i<STORAGE_WORKERS; i++) {
+		pthread_join(processor_threads[i], NULL);
+	}
 	for(int i=0; i<MAX_OPEN_FILES; i++) {
 		if (file_handles[i]) {
-			fclose(file_handles[i]);
+			close_file_handle(file_handles[i]);
 			file_handles[i] = 0;
 		}
 	}
-	pthread_join(processor_thread, NULL);
+	for(int i=0; i<MAX_OPEN_FILES; i++) {
+		storage_free_dir_entries(dir_handles[i]);
+		dir_handles[i] = NULL;
+	}
+	for(int i=0; i<MAX_REQUESTS; i++) {
+		if (requests[i].xex) xex_free(requests[i].xex);
+	}
+	backend->unmount();
+	storage_gz_done();
 }
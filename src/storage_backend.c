@@ -0,0 +1,102 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu.h"
+#include "utils.h"
+#include "storage_backend.h"
+
+#define PATH_MAX_SIZE 1000
+
+/*
+ * Files opened by the storage core itself, like decompressed gzip files.
+ * Only the file operations are used
+ */
+const storage_backend storage_memory_backend = {
+	.name  = "memory",
+	.close = storage_memory_close,
+	.read  = storage_memory_read,
+	.write = storage_memory_write,
+	.seek  = storage_memory_seek,
+};
+
+storage_file *storage_memory_open(const storage_backend *backend, const UINT8 *data, UINT32 size, time_t mtime) {
+	storage_file *file = calloc(1, sizeof(storage_file));
+	file->backend = backend;
+	file->data  = data;
+	file->size  = size;
+	file->mtime = mtime;
+	return file;
+}
+
+void storage_memory_close(storage_file *file) {
+	if (file->gz) storage_gz_release(file->gz);
+	free(file);
+}
+
+int storage_memory_read(storage_file *file, UINT8 *buffer, UINT32 size) {
+	UINT32 remaining = file->size - file->pos;
+	UINT32 n = remaining < size ? remaining : size;
+	memcpy(buffer, file->data + file->pos, n);
+	file->pos += n;
+	return n;
+}
+
+int storage_memory_write(storage_file *file, const UINT8 *buffer, UINT32 size) {
+	return -1;
+}
+
+bool storage_memory_seek(storage_file *file, UINT32 pos) {
+	if (pos > file->size) return FALSE;
+	file->pos = pos;
+	return TRUE;
+}
+
+dir_entry *storage_new_dir_entry(const char *name, unsigned size, bool is_dir, time_t mtime) {
+	dir_entry *entry = malloc(sizeof(dir_entry));
+	entry->name   = strdup(name);
+	entry->size   = size;
+	entry->is_dir = is_dir;
+	entry->date   = utils_format_date(mtime);
+	entry->time   = utils_format_time(mtime);
+	entry->next   = NULL;
+	return entry;
+}
+
+void storage_free_dir_entries(dir_entry *entry) {
+	while (entry != NULL) {
+		free(entry->name);
+		free(entry->date);
+		free(entry->time);
+
+		dir_entry *next = entry->next;
+		free(entry);
+		entry = next;
+	};
+}
+
+/*
+ * resolve "." and ".." and remove redundant and leading slashes
+ * the result is relative to the backend root
+ */
+void storage_normalize_path(char *dst, const char *path) {
+	char buffer[PATH_MAX_SIZE];
+	strncpy(buffer, path, PATH_MAX_SIZE-1);
+	buffer[PATH_MAX_SIZE-1] = 0;
+
+	dst[0] = 0;
+	int len = 0;
+	char *save;
+	char *part = strtok_r(buffer, "/", &save);
+	while (part) {
+		if (!strcmp(part, "..")) {
+			while (len > 0 && dst[len-1] != '/') len--;
+			if (len > 0) len--;
+			dst[len] = 0;
+		} else if (strcmp(part, ".")) {
+			if (len > 0) dst[len++] = '/';
+			strcpy(dst + len, part);
+			len += strlen(part);
+		}
+		part = strtok_r(NULL, "/", &save);
+	}
+}
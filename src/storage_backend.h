@@ -0,0 +1,108 @@
+#ifndef _STORAGE_BACKEND_H
+#define _STORAGE_BACKEND_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include "storage_gz.h"
+
+/*
+ * Storage backends
+ *
+ * The storage command handlers only talk to a backend through this table,
+ * the backend decides where files and directories come from:
+ *
+ *   host   a directory of the host file system
+ *   image  a packed storage image, mapped in memory (see storage_image.h)
+ *   ram    a host directory preloaded into memory at startup
+ *
+ * Paths are relative to the backend root, the backend resolves them.
+ * Operations return the storage error codes below, so they can be sent
+ * back to the guest as is.
+ */
+
+#define RET_SUCCESS             0x00
+#define ERR_INVALID_OPERATION   0x80
+#define ERR_FILE_NOT_FOUND      0x81
+#define ERR_EOF                 0x82
+#define ERR_IO                  0x83
+#define ERR_TOO_MANY_OPEN_FILES 0x84
+#define ERR_INVALID_FILE        0x85
+#define ERR_INVALID_FORMAT      0x86
+
+struct storage_backend;
+
+/*
+ * An open file is either a host file or a read only view of memory:
+ * mapped or preloaded contents (no copies involved) or
+ * the decompressed contents of a gzip file
+ */
+typedef struct storage_file {
+	const struct storage_backend *backend;
+	FILE *file;
+	const UINT8 *data;
+	UINT32 size;
+	UINT32 pos;
+	time_t mtime;
+	storage_gz_entry *gz;
+} storage_file;
+
+typedef struct dir_entry {
+	char *name;
+	unsigned size;
+	char *date;
+	char *time;
+	bool is_dir;
+	struct dir_entry *next;
+
+} dir_entry;
+
+typedef struct {
+	UINT32 size;
+	time_t mtime;
+	bool   is_dir;
+} storage_stat;
+
+/* list modes */
+#define STORAGE_LIST_HIDDEN  0x01
+#define STORAGE_LIST_NO_DIRS 0x02
+
+typedef struct storage_backend {
+	const char *name;
+
+	bool (*mount)(const char *root);
+	void (*unmount)();
+
+	/* returns NULL and sets error if the file cannot be opened */
+	storage_file *(*open)(const char *path, bool write, UINT8 *error);
+	void (*close)(storage_file *file);
+
+	/* return the number of bytes transferred, 0 on end of file or -1 on error */
+	int  (*read)(storage_file *file, UINT8 *buffer, UINT32 size);
+	int  (*write)(storage_file *file, const UINT8 *buffer, UINT32 size);
+	bool (*seek)(storage_file *file, UINT32 pos);
+
+	/* entries of a directory, including ".." except for the root */
+	dir_entry *(*list)(const char *path, int mode, unsigned *entries);
+	bool (*stat)(const char *path, storage_stat *stat);
+} storage_backend;
+
+extern const storage_backend storage_host_backend;
+extern const storage_backend storage_image_backend;
+extern const storage_backend storage_ram_backend;
+
+/* helpers for backends that keep file contents in memory */
+extern const storage_backend storage_memory_backend;
+
+storage_file *storage_memory_open(const storage_backend *backend, const UINT8 *data, UINT32 size, time_t mtime);
+void storage_memory_close(storage_file *file);
+int  storage_memory_read(storage_file *file, UINT8 *buffer, UINT32 size);
+int  storage_memory_write(storage_file *file, const UINT8 *buffer, UINT32 size);
+bool storage_memory_seek(storage_file *file, UINT32 pos);
+
+dir_entry *storage_new_dir_entry(const char *name, unsigned size, bool is_dir, time_t mtime);
+void storage_free_dir_entries(dir_entry *entry);
+
+void storage_normalize_path(char *dst, const char *path);
+
+#endif
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "emu.h"
+#include "storage_gz.h"
+
+#define LOGTAG "STORAGE"
+#ifdef TRACE_STORAGE
+#define TRACE
+#endif
+#include "trace.h"
+
+#define GZ_CACHE_MAX_SIZE (16*1024*1024)
+#define GZ_CHUNK_SIZE     0x10000
+
+static storage_gz_entry *cache = NULL;
+static UINT32 cache_size = 0;
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+bool storage_gz_is_compressed(const UINT8 *data, UINT32 size) {
+	return size >= 2 && data[0] == 0x1F && data[1] == 0x8B;
+}
+
+static void free_entry(storage_gz_entry *entry) {
+	free(entry->key);
+	free(entry->data);
+	free(entry);
+}
+
+/*
+ * drop unused entries, oldest first, until there is room for size bytes
+ * open entries are never dropped, so the cache goes over the limit while
+ * more than GZ_CACHE_MAX_SIZE bytes of files are open
+ */
+static void evict(UINT32 size) {
+	while (cache_size + size > GZ_CACHE_MAX_SIZE) {
+		storage_gz_entry **victim = NULL;
+		for(storage_gz_entry **entry = &cache; *entry; entry = &(*entry)->next) {
+			if ((*entry)->refs == 0) victim = entry;
+		}
+		if (!victim) return;
+
+		storage_gz_entry *entry = *victim;
+		*victim = entry->next;
+		cache_size -= entry->size;
+		free_entry(entry);
+	}
+}
+
+static storage_gz_entry *find(const char *key, time_t mtime, UINT32 compressed_size) {
+	for(storage_gz_entry *entry = cache; entry; entry = entry->next) {
+		if (!strcmp(entry->key, key) && entry->mtime == mtime && entry->compressed_size == compressed_size) {
+			entry->refs++;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static storage_gz_entry *add(const char *key, time_t mtime, UINT32 compressed_size, UINT8 *data, UINT32 size) {
+	evict(size);
+
+	storage_gz_entry *entry = malloc(sizeof(storage_gz_entry));
+	entry->key   = strdup(key);
+	entry->mtime = mtime;
+	entry->compressed_size = compressed_size;
+	entry->data  = data;
+	entry->size  = size;
+	entry->refs  = 1;
+	entry->next  = cache;
+	cache = entry;
+	cache_size += size;
+	return entry;
+}
+
+storage_gz_entry *storage_gz_get_buffer(const char *key, time_t mtime, const UINT8 *compressed, UINT32 compressed_size) {
+	pthread_mutex_lock(&cache_mutex);
+	storage_gz_entry *entry = find(key, mtime, compressed_size);
+	pthread_mutex_unlock(&cache_mutex);
+	if (entry) return entry;
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) return NULL;
+
+	/* a file that does not fit in the cache is not decompressed at all */
+	UINT64 initial = (UINT64)compressed_size * 4 + GZ_CHUNK_SIZE;
+	UINT32 capacity = initial > GZ_CACHE_MAX_SIZE ? GZ_CACHE_MAX_SIZE : initial;
+	UINT8 *data = malloc(capacity);
+
+	stream.next_in  = (UINT8 *)compressed;
+	stream.avail_in = compressed_size;
+
+	int result;
+	do {
+		if (stream.total_out == capacity) {
+			if (capacity == GZ_CACHE_MAX_SIZE) {
+				result = Z_BUF_ERROR;
+				break;
+			}
+			capacity = capacity > GZ_CACHE_MAX_SIZE / 2 ? GZ_CACHE_MAX_SIZE : capacity * 2;
+			data = realloc(data, capacity);
+		}
+		stream.next_out  = data + stream.total_out;
+		stream.avail_out = capacity - stream.total_out;
+		result = inflate(&stream, Z_NO_FLUSH);
+	} while (result == Z_OK);
+
+	UINT32 size = stream.total_out;
+	inflateEnd(&stream);
+
+	if (result != Z_STREAM_END) {
+		LOGV(LOGTAG, "cannot decompress %s", key);
+		free(data);
+		return NULL;
+	}
+
+	LOGV(LOGTAG, "decompressed %s %d -> %d bytes", key, compressed_size, size);
+
+	/* another thread may have decompressed the same file meanwhile */
+	pthread_mutex_lock(&cache_mutex);
+	entry = find(key, mtime, compressed_size);
+	if (entry) {
+		free(data);
+	} else {
+		entry = add(key, mtime, compressed_size, data, size);
+	}
+	pthread_mutex_unlock(&cache_mutex);
+	return entry;
+}
+
+void storage_gz_release(storage_gz_entry *entry) {
+	pthread_mutex_lock(&cache_mutex);
+	entry->refs--;
+	pthread_mutex_unlock(&cache_mutex);
+}
+
+void storage_gz_done() {
+	pthread_mutex_lock(&cache_mutex);
+	while (cache) {
+		storage_gz_entry *next = cache->next;
+		free_entry(cache);
+		cache = next;
+	}
+	cache_size = 0;
+	pthread_mutex_unlock(&cache_mutex);
+}
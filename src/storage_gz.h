@@ -0,0 +1,33 @@
+#ifndef _STORAGE_GZ_H
+#define _STORAGE_GZ_H
+
+#include <sys/types.h>
+
+/*
+ * Cache of decompressed gzip files
+ *
+ * Compressed files are inflated once in the storage threads and kept in memory,
+ * so sector reads are served from the decompressed copy.
+ * Entries are reference counted, unused entries are evicted when the cache is full.
+ * Open entries stay, so the cache can exceed its limit while they are in use.
+ * Files that decompress to more than the cache limit are rejected
+ */
+
+typedef struct storage_gz_entry {
+	char   *key;
+	time_t  mtime;
+	UINT32  compressed_size;
+	UINT8  *data;
+	UINT32  size;
+	int     refs;
+	struct storage_gz_entry *next;
+} storage_gz_entry;
+
+bool storage_gz_is_compressed(const UINT8 *data, UINT32 size);
+
+storage_gz_entry *storage_gz_get_buffer(const char *key, time_t mtime, const UINT8 *data, UINT32 size);
+void storage_gz_release(storage_gz_entry *entry);
+
+void storage_gz_done();
+
+#endif
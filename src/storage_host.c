@@ -0,0 +1,159 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+
+#include "emu.h"
+#include "storage_backend.h"
+
+#define LOGTAG "STORAGE"
+#ifdef TRACE_STORAGE
+#define TRACE
+#endif
+#include "trace.h"
+
+#define FILENAME_MAX_SIZE 1000
+
+static char root[FILENAME_MAX_SIZE];
+
+static bool host_mount(const char *path) {
+	strncpy(root, path, FILENAME_MAX_SIZE-1);
+	return TRUE;
+}
+
+static void host_unmount() {
+}
+
+static void build_path(char *fullpath, const char *path) {
+	strncpy(fullpath, root, FILENAME_MAX_SIZE);
+
+	if (path[0]) {
+		if (path[0] != '/') {
+			strcat(fullpath, "/");
+		}
+		strncat(fullpath, path, FILENAME_MAX_SIZE - strlen(fullpath));
+	}
+}
+
+static storage_file *host_open(const char *path, bool write, UINT8 *error) {
+	char filename[FILENAME_MAX_SIZE];
+	build_path(filename, path);
+
+	char *mode = write ? "wb" : "rb";
+	LOGV(LOGTAG, "try open file %s mode %s", filename, mode);
+	FILE *file = fopen(filename, mode);
+	if (!file) {
+		LOGV(LOGTAG, "cannot open file %s err %s", filename, strerror(errno));
+		*error = errno == ENOENT ? ERR_FILE_NOT_FOUND : ERR_IO;
+		return NULL;
+	}
+
+	struct stat file_stat;
+	fstat(fileno(file), &file_stat);
+
+	storage_file *handle = calloc(1, sizeof(storage_file));
+	handle->backend = &storage_host_backend;
+	handle->file  = file;
+	handle->size  = file_stat.st_size;
+	handle->mtime = file_stat.st_mtime;
+	return handle;
+}
+
+static void host_close(storage_file *file) {
+	fclose(file->file);
+	free(file);
+}
+
+static int host_read(storage_file *file, UINT8 *buffer, UINT32 size) {
+	int n = fread(buffer, 1, size, file->file);
+	return n == 0 && ferror(file->file) ? -1 : n;
+}
+
+static int host_write(storage_file *file, const UINT8 *buffer, UINT32 size) {
+	int n = fwrite(buffer, 1, size, file->file);
+	return n == 0 && ferror(file->file) ? -1 : n;
+}
+
+static bool host_seek(storage_file *file, UINT32 pos) {
+	return !fseek(file->file, pos, SEEK_SET);
+}
+
+static bool host_stat(const char *path, storage_stat *st) {
+	char filename[FILENAME_MAX_SIZE];
+	build_path(filename, path);
+
+	struct stat file_stat;
+	if (stat(filename, &file_stat)) return FALSE;
+
+	st->size   = file_stat.st_size;
+	st->mtime  = file_stat.st_mtime;
+	st->is_dir = S_ISDIR(file_stat.st_mode);
+	return TRUE;
+}
+
+static dir_entry *host_list(const char *path, int mode, unsigned *entries) {
+	char dirname[FILENAME_MAX_SIZE];
+	build_path(dirname, path);
+
+	bool is_root = !strcmp(root, dirname);
+
+	struct dirent **namelist;
+	dir_entry *first = NULL;
+	dir_entry *head  = NULL;
+	int n = scandir(dirname, &namelist, 0, alphasort);
+	for (int i = 0; i < n; i++) {
+		struct dirent *dirent = namelist[i];
+		bool skip = FALSE;
+
+		if (!strcmp(dirent->d_name, ".")) {
+			skip = TRUE;
+		} else if (!strcmp(dirent->d_name, "..")) {
+			skip = is_root;
+		} else {
+			skip = !(mode & STORAGE_LIST_HIDDEN) && dirent->d_name[0] == '.';
+		}
+
+		char name[FILENAME_MAX_SIZE*2];
+		snprintf(name, sizeof(name), "%s/%s", dirname, dirent->d_name);
+
+		struct stat entry_stat;
+		if (!skip && stat(name, &entry_stat)) skip = TRUE;
+		if (!skip && (mode & STORAGE_LIST_NO_DIRS) && S_ISDIR(entry_stat.st_mode)) skip = TRUE;
+
+		if (!skip) {
+			dir_entry *entry = storage_new_dir_entry(dirent->d_name, entry_stat.st_size,
+					S_ISDIR(entry_stat.st_mode), entry_stat.st_mtime);
+
+			if (head == NULL) {
+				first = entry;
+			} else {
+				head->next = entry;
+			}
+			head = entry;
+			(*entries)++;
+		}
+
+		free(dirent);
+	}
+	if (n >= 0) free(namelist);
+
+	LOGV(LOGTAG, "open dir %s %d entries", dirname, *entries);
+	return first;
+}
+
+const storage_backend storage_host_backend = {
+	.name    = "host",
+	.mount   = host_mount,
+	.unmount = host_unmount,
+	.open    = host_open,
+	.close   = host_close,
+	.read    = host_read,
+	.write   = host_write,
+	.seek    = host_seek,
+	.list    = host_list,
+	.stat    = host_stat,
+};
@@ -0,0 +1,263 @@
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "emu.h"
+#include "storage_image.h"
+#include "storage_backend.h"
+
+#define LOGTAG "STORAGE"
+#ifdef TRACE_STORAGE
+#define TRACE
+#endif
+#include "trace.h"
+
+#define PATH_MAX_SIZE 1000
+
+static const UINT8 *image = NULL;
+static size_t image_size = 0;
+
+static const storage_image_header *header;
+static const storage_image_entry  *entries;
+static const char                 *names;
+
+static bool is_valid_image() {
+	if (image_size < sizeof(storage_image_header)) return FALSE;
+	if (memcmp(header->magic, STORAGE_IMAGE_MAGIC, sizeof(header->magic))) return FALSE;
+	if (header->version != STORAGE_IMAGE_VERSION) return FALSE;
+
+	size_t entries_end = sizeof(storage_image_header) + header->entries * sizeof(storage_image_entry);
+	if (entries_end > image_size) return FALSE;
+	if ((size_t)header->names_offset + header->names_size > image_size) return FALSE;
+
+	/* names are read with the C string functions, they must end inside the table */
+	if (header->names_size && names[header->names_size - 1]) return FALSE;
+
+	for(int i=0; i<header->entries; i++) {
+		const storage_image_entry *entry = &entries[i];
+		if (entry->name >= header->names_size) return FALSE;
+		if ((size_t)entry->offset + entry->size > image_size) return FALSE;
+		if (entry->parent != (UINT32)STORAGE_IMAGE_ROOT && entry->parent >= header->entries) return FALSE;
+
+		/* the lookups are binary searches */
+		if (i > 0 && strcmp(names + entries[i-1].name, names + entry->name) >= 0) return FALSE;
+	}
+	return TRUE;
+}
+
+bool storage_image_mount(const char *filename) {
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "cannot open storage image %s: %s\n", filename, strerror(errno));
+		return FALSE;
+	}
+
+	struct stat image_stat;
+	if (fstat(fd, &image_stat)) {
+		close(fd);
+		return FALSE;
+	}
+
+	void *map = mmap(NULL, image_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "cannot map storage image %s: %s\n", filename, strerror(errno));
+		return FALSE;
+	}
+
+	image      = map;
+	image_size = image_stat.st_size;
+	header     = (const storage_image_header *)image;
+	entries    = (const storage_image_entry *)(image + sizeof(storage_image_header));
+	names      = (const char *)(image + header->names_offset);
+
+	if (!is_valid_image()) {
+		fprintf(stderr, "invalid storage image %s\n", filename);
+		storage_image_unmount();
+		return FALSE;
+	}
+
+	LOGV(LOGTAG, "mounted image %s with %d entries", filename, header->entries);
+	return TRUE;
+}
+
+void storage_image_unmount() {
+	if (image) munmap((void *)image, image_size);
+	image = NULL;
+	image_size = 0;
+}
+
+bool storage_image_is_mounted() {
+	return image != NULL;
+}
+
+static int lower_bound(const char *path) {
+	int low  = 0;
+	int high = header->entries;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (strcmp(names + entries[mid].name, path) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+int storage_image_find(const char *path) {
+	char normalized[PATH_MAX_SIZE];
+	storage_normalize_path(normalized, path);
+
+	if (!normalized[0]) return STORAGE_IMAGE_ROOT;
+
+	int index = lower_bound(normalized);
+	if (index < header->entries && !strcmp(names + entries[index].name, normalized)) {
+		return index;
+	}
+	return STORAGE_IMAGE_NOT_FOUND;
+}
+
+const storage_image_entry *storage_image_get_entry(int index) {
+	if (index < 0 || index >= header->entries) return NULL;
+	return &entries[index];
+}
+
+const char *storage_image_get_path(const storage_image_entry *entry) {
+	return names + entry->name;
+}
+
+const char *storage_image_get_name(const storage_image_entry *entry) {
+	const char *path = names + entry->name;
+	const char *name = strrchr(path, '/');
+	return name ? name + 1 : path;
+}
+
+const UINT8 *storage_image_get_data(const storage_image_entry *entry) {
+	return image + entry->offset;
+}
+
+/*
+ * Children of a directory share the "dir/" prefix, so they are contiguous
+ * in the sorted index. Deeper descendants in that range are skipped by parent
+ */
+static bool is_in_dir(int dir, int index) {
+	if (index >= header->entries) return FALSE;
+	if (dir == STORAGE_IMAGE_ROOT) return TRUE;
+
+	const char *dir_path = names + entries[dir].name;
+	size_t len = strlen(dir_path);
+	const char *path = names + entries[index].name;
+	return !strncmp(path, dir_path, len) && path[len] == '/';
+}
+
+static int find_child(int dir, int index) {
+	while (is_in_dir(dir, index)) {
+		if ((int)entries[index].parent == dir) return index;
+		index++;
+	}
+	return STORAGE_IMAGE_NOT_FOUND;
+}
+
+int storage_image_list_first(int dir) {
+	if (dir == STORAGE_IMAGE_ROOT) return find_child(dir, 0);
+
+	char prefix[PATH_MAX_SIZE];
+	snprintf(prefix, PATH_MAX_SIZE, "%s/", names + entries[dir].name);
+	return find_child(dir, lower_bound(prefix));
+}
+
+int storage_image_list_next(int dir, int index) {
+	return find_child(dir, index + 1);
+}
+
+static bool image_mount(const char *filename) {
+	return storage_image_mount(filename);
+}
+
+static const storage_image_entry *find_file(const char *path) {
+	const storage_image_entry *entry = storage_image_get_entry(storage_image_find(path));
+	if (!entry || (entry->flags & STORAGE_IMAGE_DIR)) return NULL;
+	return entry;
+}
+
+static storage_file *image_open(const char *path, bool write, UINT8 *error) {
+	LOGV(LOGTAG, "try open image file %s", path);
+
+	const storage_image_entry *entry = find_file(path);
+	if (!entry) {
+		*error = ERR_FILE_NOT_FOUND;
+		return NULL;
+	}
+	if (write) {
+		*error = ERR_IO;
+		return NULL;
+	}
+	return storage_memory_open(&storage_image_backend, storage_image_get_data(entry), entry->size, entry->mtime);
+}
+
+static bool image_stat(const char *path, storage_stat *st) {
+	int index = storage_image_find(path);
+	if (index == STORAGE_IMAGE_NOT_FOUND) return FALSE;
+
+	const storage_image_entry *entry = storage_image_get_entry(index);
+	st->size   = entry ? entry->size : 0;
+	st->mtime  = entry ? entry->mtime : 0;
+	st->is_dir = entry ? (entry->flags & STORAGE_IMAGE_DIR) != 0 : TRUE;
+	return TRUE;
+}
+
+static dir_entry *image_list(const char *path, int mode, unsigned *entries) {
+	int dir = storage_image_find(path);
+	const storage_image_entry *dir_image_entry = storage_image_get_entry(dir);
+	if (dir == STORAGE_IMAGE_NOT_FOUND || (dir_image_entry && !(dir_image_entry->flags & STORAGE_IMAGE_DIR))) {
+		return NULL;
+	}
+
+	dir_entry *first = NULL;
+	dir_entry *head  = NULL;
+	if (dir != STORAGE_IMAGE_ROOT && !(mode & STORAGE_LIST_NO_DIRS)) {
+		first = head = storage_new_dir_entry("..", 0, TRUE, dir_image_entry->mtime);
+		(*entries)++;
+	}
+
+	for(int index = storage_image_list_first(dir); index >= 0; index = storage_image_list_next(dir, index)) {
+		const storage_image_entry *image_entry = storage_image_get_entry(index);
+		const char *name = storage_image_get_name(image_entry);
+		bool is_dir = image_entry->flags & STORAGE_IMAGE_DIR;
+
+		if (!(mode & STORAGE_LIST_HIDDEN) && name[0] == '.') continue;
+		if ((mode & STORAGE_LIST_NO_DIRS) && is_dir) continue;
+
+		dir_entry *entry = storage_new_dir_entry(name, image_entry->size, is_dir, image_entry->mtime);
+
+		if (head == NULL) {
+			first = entry;
+		} else {
+			head->next = entry;
+		}
+		head = entry;
+		(*entries)++;
+	}
+
+	LOGV(LOGTAG, "open image dir %s %d entries", path, *entries);
+	return first;
+}
+
+const storage_backend storage_image_backend = {
+	.name    = "image",
+	.mount   = image_mount,
+	.unmount = storage_image_unmount,
+	.open    = image_open,
+	.close   = storage_memory_close,
+	.read    = storage_memory_read,
+	.write   = storage_memory_write,
+	.seek    = storage_memory_seek,
+	.list    = image_list,
+	.stat    = image_stat,
+};
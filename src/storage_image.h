@@ -0,0 +1,65 @@
+#ifndef _STORAGE_IMAGE_H
+#define _STORAGE_IMAGE_H
+
+/*
+ * Packed storage image
+ *
+ * A single file that contains a whole storage root. It can be mounted with
+ * "-storage image.bin" instead of a host directory.
+ *
+ * Layout (all values are little endian):
+ *
+ *   header       storage_image_header
+ *   entries      storage_image_entry[header.entries], sorted by path
+ *   names        zero terminated paths, relative to the root, without leading '/'
+ *   data         file contents, each one aligned to header.align
+ *
+ * Directories are stored as entries with STORAGE_IMAGE_DIR set and size 0.
+ * The root directory itself has no entry, its children have parent = 0xFFFFFFFF
+ *
+ * Use tools/mkstorage to create an image from a host directory
+ */
+
+#define STORAGE_IMAGE_MAGIC   "CLC88IMG"
+#define STORAGE_IMAGE_VERSION 1
+#define STORAGE_IMAGE_ALIGN   4096
+
+#define STORAGE_IMAGE_DIR     0x01
+
+/* entry indexes, as returned by lookups */
+#define STORAGE_IMAGE_ROOT      (-1)
+#define STORAGE_IMAGE_NOT_FOUND (-2)
+
+typedef struct {
+	char   magic[8];
+	UINT32 version;
+	UINT32 entries;
+	UINT32 names_offset;
+	UINT32 names_size;
+	UINT32 data_offset;
+	UINT32 align;
+} storage_image_header;
+
+typedef struct {
+	UINT32 name;    /* offset into the names table */
+	UINT32 parent;  /* index of the parent directory entry */
+	UINT32 offset;  /* absolute offset of the contents in the image */
+	UINT32 size;
+	UINT32 mtime;
+	UINT32 flags;
+} storage_image_entry;
+
+bool storage_image_mount(const char *filename);
+void storage_image_unmount();
+bool storage_image_is_mounted();
+
+int                        storage_image_find(const char *path);
+const storage_image_entry *storage_image_get_entry(int index);
+const char                *storage_image_get_path(const storage_image_entry *entry);
+const char                *storage_image_get_name(const storage_image_entry *entry);
+const UINT8               *storage_image_get_data(const storage_image_entry *entry);
+
+int  storage_image_list_first(int dir);
+int  storage_image_list_next(int dir, int index);
+
+#endif
@@ -0,0 +1,266 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "emu.h"
+#include "storage_backend.h"
+
+#define LOGTAG "STORAGE"
+#ifdef TRACE_STORAGE
+#define TRACE
+#endif
+#include "trace.h"
+
+/*
+ * RAM disk
+ *
+ * A host directory tree is loaded in memory when mounted, then every
+ * operation is served from memory without touching the host file system.
+ * Entries are sorted by path, like in a storage image, so lookups are a
+ * binary search and the children of a directory are contiguous.
+ * The RAM disk is read only
+ */
+
+#define PATH_MAX_SIZE 1000
+
+typedef struct {
+	char   *path;   /* relative to the root, without leading '/' */
+	UINT8  *data;
+	UINT32  size;
+	time_t  mtime;
+	bool    is_dir;
+} ram_entry;
+
+static ram_entry *entries = NULL;
+static int entries_count  = 0;
+static int entries_size   = 0;
+static UINT32 data_size   = 0;
+
+static time_t root_mtime;
+
+#define RAM_ROOT      (-1)
+#define RAM_NOT_FOUND (-2)
+
+static void add_entry(const char *path, struct stat *st, UINT8 *data) {
+	if (entries_count == entries_size) {
+		entries_size = entries_size ? entries_size * 2 : 256;
+		entries = realloc(entries, entries_size * sizeof(ram_entry));
+	}
+	ram_entry *entry = &entries[entries_count++];
+	entry->path   = strdup(path);
+	entry->data   = data;
+	entry->size   = data ? st->st_size : 0;
+	entry->mtime  = st->st_mtime;
+	entry->is_dir = S_ISDIR(st->st_mode);
+}
+
+static UINT8 *load_file(const char *filename, UINT32 size) {
+	FILE *f = fopen(filename, "rb");
+	if (!f) return NULL;
+
+	UINT8 *data = malloc(size ? size : 1);
+	if (fread(data, 1, size, f) != size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+	return data;
+}
+
+static bool load_dir(const char *root, const char *path) {
+	char dirname[PATH_MAX_SIZE*2];
+	snprintf(dirname, sizeof(dirname), "%s/%s", root, path);
+
+	DIR *dir = opendir(dirname);
+	if (!dir) {
+		fprintf(stderr, "cannot open dir %s\n", dirname);
+		return FALSE;
+	}
+
+	bool result = TRUE;
+	struct dirent *dirent;
+	while (result && (dirent = readdir(dir))) {
+		if (!strcmp(dirent->d_name, ".") || !strcmp(dirent->d_name, "..")) continue;
+
+		char entry_path[PATH_MAX_SIZE];
+		char host_path[PATH_MAX_SIZE*2];
+		if (path[0]) {
+			snprintf(entry_path, PATH_MAX_SIZE, "%s/%s", path, dirent->d_name);
+		} else {
+			snprintf(entry_path, PATH_MAX_SIZE, "%s", dirent->d_name);
+		}
+		snprintf(host_path, sizeof(host_path), "%s/%s", root, entry_path);
+
+		struct stat st;
+		if (stat(host_path, &st)) continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			add_entry(entry_path, &st, NULL);
+			result = load_dir(root, entry_path);
+		} else if (S_ISREG(st.st_mode)) {
+			UINT8 *data = load_file(host_path, st.st_size);
+			if (!data) {
+				fprintf(stderr, "cannot load file %s\n", host_path);
+				result = FALSE;
+			} else {
+				add_entry(entry_path, &st, data);
+				data_size += st.st_size;
+			}
+		}
+	}
+	closedir(dir);
+	return result;
+}
+
+static int compare_entries(const void *a, const void *b) {
+	return strcmp(((ram_entry *)a)->path, ((ram_entry *)b)->path);
+}
+
+static void ram_unmount() {
+	for(int i=0; i<entries_count; i++) {
+		free(entries[i].path);
+		free(entries[i].data);
+	}
+	free(entries);
+	entries = NULL;
+	entries_count = 0;
+	entries_size  = 0;
+	data_size     = 0;
+}
+
+static bool ram_mount(const char *root) {
+	struct stat st;
+	if (stat(root, &st) || !S_ISDIR(st.st_mode)) {
+		fprintf(stderr, "cannot load ram disk from %s\n", root);
+		return FALSE;
+	}
+	root_mtime = st.st_mtime;
+
+	if (!load_dir(root, "")) {
+		ram_unmount();
+		return FALSE;
+	}
+	qsort(entries, entries_count, sizeof(ram_entry), compare_entries);
+
+	LOGV(LOGTAG, "ram disk loaded from %s: %d entries, %d bytes", root, entries_count, data_size);
+	return TRUE;
+}
+
+static int lower_bound(const char *path) {
+	int low  = 0;
+	int high = entries_count;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (strcmp(entries[mid].path, path) < 0) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+static int find(const char *path) {
+	char normalized[PATH_MAX_SIZE];
+	storage_normalize_path(normalized, path);
+
+	if (!normalized[0]) return RAM_ROOT;
+
+	int index = lower_bound(normalized);
+	if (index < entries_count && !strcmp(entries[index].path, normalized)) {
+		return index;
+	}
+	return RAM_NOT_FOUND;
+}
+
+static storage_file *ram_open(const char *path, bool write, UINT8 *error) {
+	int index = find(path);
+	if (index < 0 || entries[index].is_dir) {
+		*error = ERR_FILE_NOT_FOUND;
+		return NULL;
+	}
+	if (write) {
+		*error = ERR_IO;
+		return NULL;
+	}
+
+	ram_entry *entry = &entries[index];
+	return storage_memory_open(&storage_ram_backend, entry->data, entry->size, entry->mtime);
+}
+
+static bool ram_stat(const char *path, storage_stat *st) {
+	int index = find(path);
+	if (index == RAM_NOT_FOUND) return FALSE;
+
+	if (index == RAM_ROOT) {
+		st->size   = 0;
+		st->mtime  = root_mtime;
+		st->is_dir = TRUE;
+	} else {
+		st->size   = entries[index].size;
+		st->mtime  = entries[index].mtime;
+		st->is_dir = entries[index].is_dir;
+	}
+	return TRUE;
+}
+
+static dir_entry *ram_list(const char *path, int mode, unsigned *entries_listed) {
+	int dir = find(path);
+	if (dir == RAM_NOT_FOUND || (dir != RAM_ROOT && !entries[dir].is_dir)) return NULL;
+
+	dir_entry *first = NULL;
+	dir_entry *head  = NULL;
+	if (dir != RAM_ROOT && !(mode & STORAGE_LIST_NO_DIRS)) {
+		first = head = storage_new_dir_entry("..", 0, TRUE, entries[dir].mtime);
+		(*entries_listed)++;
+	}
+
+	char prefix[PATH_MAX_SIZE];
+	if (dir == RAM_ROOT) {
+		prefix[0] = 0;
+	} else {
+		snprintf(prefix, PATH_MAX_SIZE, "%s/", entries[dir].path);
+	}
+	size_t prefix_len = strlen(prefix);
+
+	/* children share the prefix, deeper descendants in that range are skipped */
+	for(int index = lower_bound(prefix); index < entries_count; index++) {
+		ram_entry *ram_entry = &entries[index];
+		if (strncmp(ram_entry->path, prefix, prefix_len)) break;
+
+		const char *name = ram_entry->path + prefix_len;
+		if (strchr(name, '/')) continue;
+
+		if (!(mode & STORAGE_LIST_HIDDEN) && name[0] == '.') continue;
+		if ((mode & STORAGE_LIST_NO_DIRS) && ram_entry->is_dir) continue;
+
+		dir_entry *entry = storage_new_dir_entry(name, ram_entry->size, ram_entry->is_dir, ram_entry->mtime);
+
+		if (head == NULL) {
+			first = entry;
+		} else {
+			head->next = entry;
+		}
+		head = entry;
+		(*entries_listed)++;
+	}
+
+	LOGV(LOGTAG, "open ram dir %s %d entries", path, *entries_listed);
+	return first;
+}
+
+const storage_backend storage_ram_backend = {
+	.name    = "ram",
+	.mount   = ram_mount,
+	.unmount = ram_unmount,
+	.open    = ram_open,
+	.close   = storage_memory_close,
+	.read    = storage_memory_read,
+	.write   = storage_memory_write,
+	.seek    = storage_memory_seek,
+	.list    = ram_list,
+	.stat    = ram_stat,
+};
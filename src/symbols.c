@@ -0,0 +1,433 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "emu.h"
+#include "symbols.h"
+
+#define LOGTAG "SYMBOLS"
+#ifdef TRACE_SYMBOLS
+#define TRACE
+#endif
+#include "trace.h"
+
+#define SYMBOLS_CACHE_MAGIC   "CLC88SYM"
+#define SYMBOLS_CACHE_VERSION 1
+
+/*
+ * Strings are stored as offsets into an arena. Offset 0 is an empty
+ * string, used as "none" in the indexes
+ */
+typedef struct {
+	char  *data;
+	UINT32 size;
+	UINT32 capacity;
+} arena;
+
+/* one source line and/or label at an address, offsets into the listing arena */
+typedef struct {
+	UINT16 addr;
+	UINT16 reserved;
+	UINT32 line;
+	UINT32 label;
+} symbols_record;
+
+/* a parsed listing, as stored in the cache file */
+typedef struct {
+	arena strings;
+	symbols_record *records;
+	UINT32 records_count;
+	UINT32 records_capacity;
+} listing;
+
+typedef struct {
+	char   magic[8];
+	UINT32 version;
+	UINT32 records;
+	UINT32 arena_size;
+	UINT32 reserved;
+	INT64  lst_mtime;
+	INT64  lst_size;
+} cache_header;
+
+typedef struct {
+	UINT32 name;
+	UINT16 addr;
+} symbol_slot;
+
+static arena strings;
+static UINT32 line_index[0x10000];
+static UINT32 label_index[0x10000];
+
+static symbol_slot *symbol_slots = NULL;
+static UINT32 symbol_slots_capacity = 0;
+static UINT32 symbol_slots_count = 0;
+
+static INT32 enclosing_index[0x10000];
+static bool  enclosing_valid = FALSE;
+
+static void arena_init(arena *a) {
+	a->capacity = 0x10000;
+	a->data = malloc(a->capacity);
+	a->data[0] = 0;
+	a->size = 1;
+}
+
+static UINT32 arena_add(arena *a, const char *s, UINT32 len) {
+	if (a->size + len + 1 > a->capacity) {
+		while (a->size + len + 1 > a->capacity) a->capacity *= 2;
+		a->data = realloc(a->data, a->capacity);
+	}
+	UINT32 offset = a->size;
+	memcpy(a->data + offset, s, len);
+	a->data[offset + len] = 0;
+	a->size += len + 1;
+	return offset;
+}
+
+static UINT32 hash_name(const char *name) {
+	UINT32 hash = 2166136261u;
+	while (*name) {
+		hash ^= (UINT8)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static symbol_slot *find_slot(const char *name) {
+	UINT32 mask = symbol_slots_capacity - 1;
+	UINT32 i = hash_name(name) & mask;
+	while (symbol_slots[i].name && strcmp(strings.data + symbol_slots[i].name, name)) {
+		i = (i + 1) & mask;
+	}
+	return &symbol_slots[i];
+}
+
+static void add_symbol(UINT32 name, UINT16 addr) {
+	if ((symbol_slots_count + 1) * 4 > symbol_slots_capacity * 3) {
+		symbol_slot *old_slots = symbol_slots;
+		UINT32 old_capacity = symbol_slots_capacity;
+
+		symbol_slots_capacity = old_capacity ? old_capacity * 2 : 1024;
+		symbol_slots = calloc(symbol_slots_capacity, sizeof(symbol_slot));
+		for(int i=0; i<old_capacity; i++) {
+			if (old_slots[i].name) *find_slot(strings.data + old_slots[i].name) = old_slots[i];
+		}
+		free(old_slots);
+	}
+
+	symbol_slot *slot = find_slot(strings.data + name);
+	if (!slot->name) symbol_slots_count++;
+	slot->name = name;
+	slot->addr = addr;
+}
+
+void symbols_init() {
+	free(strings.data);
+	arena_init(&strings);
+
+	memset(line_index,  0, sizeof(line_index));
+	memset(label_index, 0, sizeof(label_index));
+
+	free(symbol_slots);
+	symbol_slots = NULL;
+	symbol_slots_capacity = 0;
+	symbol_slots_count = 0;
+	enclosing_valid = FALSE;
+}
+
+/* listing parser */
+
+static inline bool is_hex(char c) {
+	return ('0' <= c && c <='9') || ('A' <= c && c <= 'F');
+}
+
+static inline bool is_space(char c) {
+	return c == ' ' || c == '\t';
+}
+
+static inline bool is_hex_addr(const char *s, int len) {
+	if (len < 4) return FALSE;
+	for(int i=0; i<4; i++) if (!is_hex(s[i])) return FALSE;
+	return TRUE;
+}
+
+static int parse_hex_addr(const char *s) {
+	int addr = 0;
+	for(int i=0; i<4; i++) {
+		addr = (addr << 4) | (s[i] <= '9' ? s[i] - '0' : s[i] - 'A' + 10);
+	}
+	return addr;
+}
+
+// look for not byte pattern after byte pattern
+static int find_source_line(const char *line, int len) {
+	int state = 0;
+	for(int i=7; i<len; i++) {
+		char c = line[i];
+		bool is_hex_char = is_hex(c);
+		bool is_space_char = is_space(c);
+
+		switch(state) {
+		case 0: state = is_space_char ? 1 : 0; break;
+		case 1: state = is_hex_char ? 2 : 0; break;
+		case 2: state = is_hex_char ? 3 : 0; break;
+		case 3: state = is_space_char ? 4 : 0; break;
+		case 4: state = is_hex_char ? 2 : 5; break;
+		}
+
+		if (state == 5) return i;
+	}
+	return -1;
+}
+
+// look for label pattern "addr label:", returns the label length
+static int find_label(const char *line, int len, int *start) {
+	int state = 0;
+	for(int i=7; i<len; i++) {
+		char c = line[i];
+		switch(state) {
+		case 0:
+		case 1:
+		case 2:
+		case 3:
+			state = is_hex(c) ? state + 1 : 0;
+			break;
+		case 4:
+			state = is_space(c) ? 4 : 5;
+			if (state == 5) *start = i;
+			break;
+		case 5:
+			if (is_space(c)) return 0;
+			if (c == ':') return i - *start;
+			break;
+		}
+	}
+	return 0;
+}
+
+static void listing_add(listing *l, UINT16 addr, UINT32 line, UINT32 label) {
+	if (l->records_count == l->records_capacity) {
+		l->records_capacity = l->records_capacity ? l->records_capacity * 2 : 1024;
+		l->records = realloc(l->records, l->records_capacity * sizeof(symbols_record));
+	}
+	symbols_record *record = &l->records[l->records_count++];
+	record->addr  = addr;
+	record->reserved = 0;
+	record->line  = line;
+	record->label = label;
+}
+
+int symbols_listing_addr(const char *line, int len) {
+	// line number, right aligned in the first 6 columns
+	int n = 0;
+	for(int i=0; i<6 && i<len; i++) {
+		if (line[i] >= '0' && line[i] <= '9') n = n*10 + line[i] - '0';
+		else if (!is_space(line[i])) break;
+	}
+	if (n == 0) return -1;
+
+	if (len >= 17 && !strncmp(line + 7, "FFFF>", 5)) {
+		if (!is_hex_addr(line + 13, len - 13)) return -1;
+		return parse_hex_addr(line + 13);
+	} else if (len > 7 && is_hex_addr(line + 7, len - 7)) {
+		return parse_hex_addr(line + 7);
+	}
+	return -1;
+}
+
+static void parse_line(listing *l, const char *line, int len) {
+	int addr = symbols_listing_addr(line, len);
+	if (addr < 0) return;
+
+	UINT32 source = 0;
+	int start = find_source_line(line, len);
+	if (start >= 0) {
+		int end = len;
+		while (start < end && is_space(line[start])) start++;
+		while (end > start && (is_space(line[end-1]) || line[end-1] == '\r')) end--;
+		source = arena_add(&l->strings, line + start, end - start);
+	}
+
+	UINT32 label = 0;
+	int label_len = find_label(line, len, &start);
+	if (label_len > 0) {
+		label = arena_add(&l->strings, line + start, label_len);
+	}
+
+	listing_add(l, addr, source, label);
+}
+
+static bool parse_listing(listing *l, const char *filename, UINT32 size) {
+	FILE *f = fopen(filename, "rb");
+	if (!f) return FALSE;
+
+	char *data = malloc(size + 1);
+	size = fread(data, 1, size, f);
+	fclose(f);
+	data[size] = 0;
+
+	const char *line = data;
+	const char *end  = data + size;
+	while (line < end) {
+		const char *eol = memchr(line, '\n', end - line);
+		if (!eol) eol = end;
+		parse_line(l, line, eol - line);
+		line = eol + 1;
+	}
+	free(data);
+	return TRUE;
+}
+
+/* binary cache */
+
+static void cache_filename(char *cache, size_t size, const char *filename) {
+	snprintf(cache, size, "%s.sym", filename);
+}
+
+static bool load_cache(listing *l, const char *filename, struct stat *lst_stat) {
+	char cache[1024];
+	cache_filename(cache, sizeof(cache), filename);
+
+	FILE *f = fopen(cache, "rb");
+	if (!f) return FALSE;
+
+	cache_header header;
+	bool valid = fread(&header, sizeof(header), 1, f) == 1
+			&& !memcmp(header.magic, SYMBOLS_CACHE_MAGIC, sizeof(header.magic))
+			&& header.version == SYMBOLS_CACHE_VERSION
+			&& header.lst_mtime == lst_stat->st_mtime
+			&& header.lst_size  == lst_stat->st_size
+			&& header.arena_size > 0;
+
+	if (valid) {
+		l->records_count = l->records_capacity = header.records;
+		l->records = malloc(header.records * sizeof(symbols_record) + 1);
+		l->strings.size = l->strings.capacity = header.arena_size;
+		l->strings.data = malloc(header.arena_size);
+
+		valid = fread(l->records, sizeof(symbols_record), header.records, f) == header.records
+				&& fread(l->strings.data, 1, header.arena_size, f) == header.arena_size;
+	}
+	fclose(f);
+
+	if (valid) {
+		/* offsets come from a file, do not trust them */
+		for(int i=0; i<l->records_count && valid; i++) {
+			valid = l->records[i].line < l->strings.size && l->records[i].label < l->strings.size;
+		}
+		valid = valid && l->strings.data[l->strings.size-1] == 0;
+	}
+	return valid;
+}
+
+static void save_cache(listing *l, const char *filename, struct stat *lst_stat) {
+	char cache[1024];
+	cache_filename(cache, sizeof(cache), filename);
+
+	FILE *f = fopen(cache, "wb");
+	if (!f) return;
+
+	cache_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SYMBOLS_CACHE_MAGIC, sizeof(header.magic));
+	header.version    = SYMBOLS_CACHE_VERSION;
+	header.records    = l->records_count;
+	header.arena_size = l->strings.size;
+	header.lst_mtime  = lst_stat->st_mtime;
+	header.lst_size   = lst_stat->st_size;
+
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(l->records, sizeof(symbols_record), l->records_count, f);
+	fwrite(l->strings.data, 1, l->strings.size, f);
+	fclose(f);
+}
+
+/* add the listing to the global tables, later records replace earlier ones */
+static void merge_listing(listing *l) {
+	if (l->strings.size <= 1) return;
+
+	/* the listing arena is appended without its leading empty string */
+	UINT32 base = strings.size - 1;
+	arena_add(&strings, l->strings.data + 1, l->strings.size - 2);
+
+	for(int i=0; i<l->records_count; i++) {
+		symbols_record *record = &l->records[i];
+		if (record->line) line_index[record->addr] = base + record->line;
+		if (record->label) {
+			label_index[record->addr] = base + record->label;
+			add_symbol(base + record->label, record->addr);
+		}
+	}
+	enclosing_valid = FALSE;
+}
+
+bool symbols_load_listing(const char *filename) {
+	if (!strings.data) symbols_init();
+
+	struct stat lst_stat;
+	if (stat(filename, &lst_stat)) {
+		fprintf(stderr, "cannot open file %s\n", filename);
+		return FALSE;
+	}
+
+	listing l;
+	memset(&l, 0, sizeof(l));
+
+	bool cached = load_cache(&l, filename, &lst_stat);
+	if (!cached) {
+		free(l.records);
+		free(l.strings.data);
+		memset(&l, 0, sizeof(l));
+		arena_init(&l.strings);
+		if (!parse_listing(&l, filename, lst_stat.st_size)) {
+			free(l.strings.data);
+			return FALSE;
+		}
+		save_cache(&l, filename, &lst_stat);
+	}
+
+	LOGV(LOGTAG, "%s %s: %d records", cached ? "cached" : "parsed", filename, l.records_count);
+
+	merge_listing(&l);
+	free(l.records);
+	free(l.strings.data);
+	return TRUE;
+}
+
+const char *symbols_get_line(UINT16 addr) {
+	return line_index[addr] ? strings.data + line_index[addr] : NULL;
+}
+
+const char *symbols_get_label(UINT16 addr) {
+	return label_index[addr] ? strings.data + label_index[addr] : NULL;
+}
+
+const char *symbols_get_enclosing_label(UINT16 addr, UINT16 *label_addr) {
+	if (!enclosing_valid) {
+		INT32 last = -1;
+		for(int i=0; i<0x10000; i++) {
+			if (label_index[i]) last = i;
+			enclosing_index[i] = last;
+		}
+		enclosing_valid = TRUE;
+	}
+
+	INT32 enclosing = enclosing_index[addr];
+	if (enclosing < 0) return NULL;
+
+	if (label_addr) *label_addr = enclosing;
+	return strings.data + label_index[enclosing];
+}
+
+bool symbols_find(const char *name, UINT16 *addr) {
+	if (!symbol_slots_count) return FALSE;
+
+	symbol_slot *slot = find_slot(name);
+	if (!slot->name) return FALSE;
+
+	*addr = slot->addr;
+	return TRUE;
+}
@@ -0,0 +1,28 @@
+#ifndef _SYMBOLS_H
+#define _SYMBOLS_H
+
+/*
+ * Symbol and source line table, built from assembler listings
+ *
+ * Strings live in a single arena. Lookups by address use a direct 64K
+ * index, lookups by name use a hash map, both are O(1).
+ *
+ * Each listing is cached in binary form next to it (name.lst -> name.lst.sym),
+ * the cache is used while the listing modification time and size match
+ */
+
+void symbols_init();
+bool symbols_load_listing(const char *filename);
+
+const char *symbols_get_line(UINT16 addr);
+const char *symbols_get_label(UINT16 addr);
+
+/* label at addr or the closest one before it, NULL if there is none */
+const char *symbols_get_enclosing_label(UINT16 addr, UINT16 *label_addr);
+
+bool symbols_find(const char *name, UINT16 *addr);
+
+/* address of a listing line, -1 if the line has none */
+int symbols_listing_addr(const char *line, int len);
+
+#endif
@@ -1,56 +1,43 @@
-/***************************************************************************
+#ifndef _TIMER_H
+#define _TIMER_H
 
-  timer.c
+/*
+ * Timers on the master clock
+ *
+ * Time is an integer count of master clock ticks, the clock advances as
+ * chroni runs the CPU through cpuexec_run. Armed timers are kept in a
+ * binary heap ordered by expiry time, so advancing the clock only compares
+ * against the first one. Timers that expire at the same tick fire in the
+ * order they were armed.
+ */
 
-  Functions needed to generate timing and synchronization between several
-  CPUs.
+typedef UINT64 timer_ticks;
+typedef struct timer timer;
 
-***************************************************************************/
+#define TIMER_NEVER ((timer_ticks)-1)
 
-#ifndef __TIMER_H__
-#define __TIMER_H__
+extern timer_ticks timer_now;
+extern timer_ticks timer_next_expire;
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+void timer_init();
+
+timer *timer_alloc(void (*callback)(int param), int param);
+void timer_free(timer *which);
+
+/* expire after delay ticks, then every period ticks unless period is 0 */
+void timer_adjust(timer *which, timer_ticks delay, timer_ticks period);
+void timer_disable(timer *which);
 
-extern double cycles_to_sec[];
-extern double sec_to_cycles[];
-
-#define TIME_IN_HZ(hz)        (1.0 / (double)(hz))
-#define TIME_IN_CYCLES(c,cpu) ((double)(c) * cycles_to_sec[cpu])
-#define TIME_IN_SEC(s)        ((double)(s))
-#define TIME_IN_MSEC(ms)      ((double)(ms) * (1.0 / 1000.0))
-#define TIME_IN_USEC(us)      ((double)(us) * (1.0 / 1000000.0))
-#define TIME_IN_NSEC(us)      ((double)(us) * (1.0 / 1000000000.0))
-
-#define TIME_NOW              (0.0)
-#define TIME_NEVER            (1.0e30)
-
-#define TIME_TO_CYCLES(cpu,t) ((int)((t) * sec_to_cycles[cpu]))
-
-typedef struct _mame_timer mame_timer;
-
-
-void timer_init(void);
-void timer_free(void);
-double timer_time_until_next_timer(void);
-void timer_adjust_global_time(double delta);
-mame_timer *timer_alloc(void (*callback)(int));
-void timer_adjust(mame_timer *which, double duration, int param, double period);
-void timer_pulse(double period, int param, void (*callback)(int));
-void timer_set(double duration, int param, void (*callback)(int));
-void timer_reset(mame_timer *which, double duration);
-void timer_remove(mame_timer *which);
-int timer_enable(mame_timer *which, int enable);
-double timer_timeelapsed(mame_timer *which);
-double timer_timeleft(mame_timer *which);
-double timer_get_time(void);
-double timer_starttime(mame_timer *which);
-double timer_firetime(mame_timer *which);
-
-#ifdef __cplusplus
+/* ticks since the timer was armed or last fired, and until it fires */
+timer_ticks timer_elapsed(timer *which);
+timer_ticks timer_left(timer *which);
+timer_ticks timer_period(timer *which);
+
+void timer_fire_expired();
+
+static inline void timer_advance(timer_ticks ticks) {
+	timer_now += ticks;
+	if (timer_now >= timer_next_expire) timer_fire_expired();
 }
-#endif
 
 #endif
@@ -1,4 +1,378 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <time.h>
 #include "emu.h"
+#include "frontend/frontend.h"
 #include "trace.h"
 
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
 int trace_enabled = TRUE;
+
+/* categories */
+
+static trace_category *categories = NULL;
+static pthread_mutex_t categories_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* level for categories registered after "all" was set, -1 if not set */
+static int all_level = -1;
+
+static trace_category *find_category(const char *name) {
+	for(trace_category *category = categories; category; category = category->next) {
+		if (!strcmp(category->name, name)) return category;
+	}
+	return NULL;
+}
+
+static trace_category *new_category(const char *name, int level) {
+	trace_category *category = malloc(sizeof(trace_category));
+	category->name  = strdup(name);
+	category->level = all_level >= 0 ? all_level : level;
+	category->next  = categories;
+	categories = category;
+	return category;
+}
+
+trace_category *trace_get_category(const char *name, int default_level) {
+	pthread_mutex_lock(&categories_mutex);
+	trace_category *category = find_category(name);
+	if (!category) category = new_category(name, default_level);
+	pthread_mutex_unlock(&categories_mutex);
+	return category;
+}
+
+static int parse_level(const char *level) {
+	if (!strcmp(level, "off") || !strcmp(level, "0")) return TRACE_LEVEL_OFF;
+	if (!strcmp(level, "error") || !strcmp(level, "e")) return TRACE_LEVEL_ERROR;
+	if (!strcmp(level, "verbose") || !strcmp(level, "v")) return TRACE_LEVEL_VERBOSE;
+	return -1;
+}
+
+static const char *level_name(int level) {
+	switch(level) {
+	case TRACE_LEVEL_OFF:   return "off";
+	case TRACE_LEVEL_ERROR: return "error";
+	default:                return "verbose";
+	}
+}
+
+bool trace_set_level(const char *name, const char *level_text) {
+	int level = parse_level(level_text);
+	if (level < 0) return FALSE;
+
+	pthread_mutex_lock(&categories_mutex);
+	if (!strcmp(name, "all")) {
+		all_level = level;
+		for(trace_category *category = categories; category; category = category->next) {
+			category->level = level;
+		}
+	} else {
+		/* categories are also created before their first message */
+		trace_category *category = find_category(name);
+		if (category) {
+			category->level = level;
+		} else {
+			new_category(name, level)->level = level;
+		}
+	}
+	pthread_mutex_unlock(&categories_mutex);
+	return TRUE;
+}
+
+/* TAG=level,TAG=level... */
+void trace_set_levels(const char *spec) {
+	char *specs = strdup(spec);
+	char *saveptr;
+	for(char *item = strtok_r(specs, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+		char *level = strchr(item, '=');
+		if (level) *level++ = 0;
+		if (!trace_set_level(item, level ? level : "verbose")) {
+			fprintf(stderr, "unknown log level %s for %s\n", level, item);
+		}
+	}
+	free(specs);
+}
+
+void trace_list_levels() {
+	pthread_mutex_lock(&categories_mutex);
+	for(trace_category *category = categories; category; category = category->next) {
+		printf("%-10s %s\n", category->name, level_name(category->level));
+	}
+	pthread_mutex_unlock(&categories_mutex);
+}
+
+/*
+ * Log records
+ *
+ * The queue is a bounded ring with a sequence number per slot, producers
+ * (the emulation and the storage workers) claim slots with a compare and
+ * swap and never wait. A full queue drops the record.
+ */
+
+#define TRACE_QUEUE_SIZE 4096
+#define TRACE_MAX_ARGS   8
+#define TRACE_STRINGS    160
+
+enum {ARG_INT, ARG_LONG, ARG_LLONG, ARG_DOUBLE, ARG_PTR, ARG_STRING};
+
+typedef struct {
+	volatile UINT32 sequence;
+	trace_category *category;
+	UINT8 level;
+	UINT8 args_count;
+	UINT8 types[TRACE_MAX_ARGS];
+	const char *format;
+	union {
+		long long i;
+		double    d;
+		void     *p;
+		UINT32    s; /* offset in strings */
+	} args[TRACE_MAX_ARGS];
+	char strings[TRACE_STRINGS];
+} trace_record;
+
+static trace_record queue[TRACE_QUEUE_SIZE];
+static UINT32 enqueue_pos;
+static UINT32 dequeue_pos;
+static UINT32 dropped;
+
+static pthread_t writer_thread;
+static volatile bool writer_running = FALSE;
+
+/* skip flags, width, precision and length of a conversion, returns the conversion char */
+static const char *parse_conversion(const char *c, int *length) {
+	while (*c && strchr("-+ #0123456789.", *c)) c++;
+	*length = 0;
+	while (*c && strchr("hlLqjzt", *c)) {
+		if (*c == 'l') (*length)++;
+		c++;
+	}
+	return c;
+}
+
+static void capture_args(trace_record *record, const char *format, va_list args) {
+	UINT32 strings_used = 0;
+	record->args_count = 0;
+
+	for(const char *c = format; *c && record->args_count < TRACE_MAX_ARGS; c++) {
+		if (*c != '%') continue;
+
+		int length;
+		c = parse_conversion(c+1, &length);
+		if (!*c) break;
+
+		int n = record->args_count;
+		switch(*c) {
+		case '%':
+			continue;
+		case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+			if (length == 0) {
+				record->types[n] = ARG_INT;
+				record->args[n].i = va_arg(args, int);
+			} else if (length == 1) {
+				record->types[n] = ARG_LONG;
+				record->args[n].i = va_arg(args, long);
+			} else {
+				record->types[n] = ARG_LLONG;
+				record->args[n].i = va_arg(args, long long);
+			}
+			break;
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			record->types[n] = ARG_DOUBLE;
+			record->args[n].d = va_arg(args, double);
+			break;
+		case 's': {
+			const char *s = va_arg(args, const char *);
+			if (!s) s = "(null)";
+			UINT32 len = strlen(s);
+			if (strings_used + len + 1 > TRACE_STRINGS) {
+				len = strings_used < TRACE_STRINGS ? TRACE_STRINGS - strings_used - 1 : 0;
+			}
+			record->types[n] = ARG_STRING;
+			record->args[n].s = strings_used < TRACE_STRINGS ? strings_used : TRACE_STRINGS - 1;
+			if (strings_used < TRACE_STRINGS) {
+				memcpy(record->strings + strings_used, s, len);
+				record->strings[strings_used + len] = 0;
+				strings_used += len + 1;
+			}
+			break;
+		}
+		default:
+			record->types[n] = ARG_PTR;
+			record->args[n].p = va_arg(args, void *);
+			break;
+		}
+		record->args_count++;
+	}
+}
+
+static void format_record(trace_record *record, char *buffer, int size) {
+	int used = 0;
+	int arg = 0;
+	const char *c = record->format;
+
+	while (*c && used < size - 1) {
+		if (*c != '%') {
+			buffer[used++] = *c++;
+			continue;
+		}
+
+		int length;
+		const char *end = parse_conversion(c+1, &length);
+		if (!*end) break;
+		end++;
+
+		char spec[32];
+		int spec_len = end - c;
+		if (spec_len >= sizeof(spec)) spec_len = sizeof(spec) - 1;
+		memcpy(spec, c, spec_len);
+		spec[spec_len] = 0;
+		c = end;
+
+		int written;
+		if (spec[spec_len-1] == '%') {
+			written = snprintf(buffer + used, size - used, "%%");
+		} else if (arg >= record->args_count) {
+			break;
+		} else {
+			switch(record->types[arg]) {
+			case ARG_INT:    written = snprintf(buffer + used, size - used, spec, (int)record->args[arg].i); break;
+			case ARG_LONG:   written = snprintf(buffer + used, size - used, spec, (long)record->args[arg].i); break;
+			case ARG_LLONG:  written = snprintf(buffer + used, size - used, spec, record->args[arg].i); break;
+			case ARG_DOUBLE: written = snprintf(buffer + used, size - used, spec, record->args[arg].d); break;
+			case ARG_STRING: written = snprintf(buffer + used, size - used, spec, record->strings + record->args[arg].s); break;
+			default:         written = snprintf(buffer + used, size - used, spec, record->args[arg].p); break;
+			}
+			arg++;
+		}
+		used += written;
+		if (used > size - 1) used = size - 1;
+	}
+	buffer[used] = 0;
+}
+
+static void write_message(const char *tag, int level, const char *message) {
+#ifdef __ANDROID__
+	__android_log_print(level == TRACE_LEVEL_ERROR ? ANDROID_LOG_ERROR : ANDROID_LOG_INFO, tag, "%s", message);
+#else
+	if (level == TRACE_LEVEL_ERROR) {
+		frontend_trace_err((char *)tag, "%s", message);
+	} else {
+		frontend_trace_msg((char *)tag, "%s", message);
+	}
+#endif
+}
+
+static bool write_next() {
+	trace_record *record = &queue[dequeue_pos & (TRACE_QUEUE_SIZE - 1)];
+	if (__atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE) != dequeue_pos + 1) return FALSE;
+
+	char message[1024];
+	format_record(record, message, sizeof(message));
+	write_message(record->category->name, record->level, message);
+
+	__atomic_store_n(&record->sequence, dequeue_pos + TRACE_QUEUE_SIZE, __ATOMIC_RELEASE);
+	dequeue_pos++;
+	return TRUE;
+}
+
+static void write_dropped() {
+	UINT32 count = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+	if (count) {
+		char message[100];
+		sprintf(message, "%u messages dropped", count);
+		write_message("TRACE", TRACE_LEVEL_ERROR, message);
+	}
+}
+
+static void *writer(void *arg) {
+	struct timespec wait = {0, 1000000};
+	while (writer_running) {
+		if (!write_next()) {
+			write_dropped();
+			nanosleep(&wait, NULL);
+		}
+	}
+	while (write_next());
+	write_dropped();
+	return NULL;
+}
+
+void trace_log(trace_category *category, int level, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+
+	if (!writer_running) {
+		/* no writer yet or anymore, write directly */
+		trace_record record;
+		record.level    = level;
+		record.format   = format;
+		capture_args(&record, format, args);
+
+		char message[1024];
+		format_record(&record, message, sizeof(message));
+		write_message(category->name, level, message);
+		va_end(args);
+		return;
+	}
+
+	trace_record *record;
+	UINT32 pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+	for(;;) {
+		record = &queue[pos & (TRACE_QUEUE_SIZE - 1)];
+		UINT32 sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+		INT32 diff = (INT32)(sequence - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, TRUE, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+		} else if (diff < 0) {
+			__atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+			va_end(args);
+			return;
+		} else {
+			pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+		}
+	}
+
+	record->category = category;
+	record->level    = level;
+	record->format   = format;
+	capture_args(record, format, args);
+	va_end(args);
+
+	__atomic_store_n(&record->sequence, pos + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * -log TAG=level,...   set log levels, level is off, error or verbose
+ */
+void trace_init(int argc, char *argv[]) {
+	for(int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "-log") && i<argc-1) {
+			trace_set_levels(argv[++i]);
+		}
+	}
+
+	for(UINT32 i=0; i<TRACE_QUEUE_SIZE; i++) {
+		queue[i].sequence = i;
+	}
+	enqueue_pos = 0;
+	dequeue_pos = 0;
+	dropped = 0;
+
+	writer_running = TRUE;
+	if (pthread_create(&writer_thread, NULL, writer, NULL)) {
+		writer_running = FALSE;
+	}
+}
+
+void trace_done() {
+	if (!writer_running) return;
+
+	writer_running = FALSE;
+	pthread_join(writer_thread, NULL);
+}
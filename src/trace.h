@@ -1,19 +1,61 @@
 #ifndef _TRACE_H_
 #define _TRACE_H_
 
+/*
+ * Logging
+ *
+ * LOGV and LOGE are compiled in for files that define TRACE (from their
+ * TRACE_<TAG> flag), or for all files with TRACE_ALL.
+ *
+ * Each tag is a category with a log level that can be changed at run time
+ * with "-log TAG=level,..." or the monitor "log" command. Categories of
+ * files built with TRACE start at verbose, the rest at error.
+ *
+ * Records only keep the format and the arguments (strings are copied),
+ * they are formatted and written by a background thread.
+ */
+
 extern int trace_enabled;
 
-#ifdef TRACE
-	#ifdef __ANDROID__
-		#include <android/log.h>
-		#define LOGV(TAG, ...)   if (trace_enabled) __android_log_print((int)ANDROID_LOG_INFO, TAG, __VA_ARGS__)
-		#define LOGE(TAG, ...)   if (trace_enabled) __android_log_print((int)ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+#define TRACE_LEVEL_OFF     0
+#define TRACE_LEVEL_ERROR   1
+#define TRACE_LEVEL_VERBOSE 2
+
+typedef struct trace_category {
+	const char *name;
+	volatile int level;
+	struct trace_category *next;
+} trace_category;
+
+void trace_init(int argc, char *argv[]);
+void trace_done();
+
+trace_category *trace_get_category(const char *name, int default_level);
+
+/* "all" sets every category, returns FALSE if the level is unknown */
+bool trace_set_level(const char *name, const char *level);
+void trace_set_levels(const char *spec);
+void trace_list_levels();
+
+void trace_log(trace_category *category, int level, const char *format, ...);
+
+#if defined(TRACE) || defined(TRACE_ALL)
+	#ifdef TRACE
+		#define TRACE_DEFAULT_LEVEL TRACE_LEVEL_VERBOSE
 	#else
-		#include <stdarg.h>
-		#include "frontend/frontend.h"
-		#define LOGV(TAG, ...)   if (trace_enabled) {frontend_trace_msg(TAG, __VA_ARGS__);}
-		#define LOGE(TAG, ...)   if (trace_enabled) {frontend_trace_err(TAG, __VA_ARGS__);}
+		#define TRACE_DEFAULT_LEVEL TRACE_LEVEL_ERROR
 	#endif
+
+	#define TRACE_LOG(LEVEL, TAG, ...) do { \
+		static trace_category *trace_log_category = NULL; \
+		if (trace_enabled) { \
+			if (!trace_log_category) trace_log_category = trace_get_category(TAG, TRACE_DEFAULT_LEVEL); \
+			if (trace_log_category->level >= LEVEL) trace_log(trace_log_category, LEVEL, __VA_ARGS__); \
+		} \
+	} while(0)
+
+	#define LOGV(TAG, ...) TRACE_LOG(TRACE_LEVEL_VERBOSE, TAG, __VA_ARGS__)
+	#define LOGE(TAG, ...) TRACE_LOG(TRACE_LEVEL_ERROR,   TAG, __VA_ARGS__)
 #else
 	#define LOGV(...)
 	#define LOGE(...)
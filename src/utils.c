@@ -5,6 +5,7 @@
 #include <time.h>
 #include "emu.h"
 #include "bus.h"
+#include "xex.h"
 
 #define LOGTAG "UTILS"
 #ifdef TRACE_UTILS
@@ -14,30 +15,10 @@
 #include "utils.h"
 
 void utils_load_xex(char *filename) {
-	UINT8 buffer[0x10000];
+	xex_file *xex = xex_read(filename);
+	if (!xex) return;
 
-	FILE *f = fopen(filename, "rb");
-	if (!f) {
-		LOGE(LOGTAG, "Error opening %s: %s", filename, strerror(errno));
-		return;
-	}
-
-	int n=0;
-	while((n = fread(buffer, 2, 1, f))) {
-		if (buffer[0] & (buffer[1] == 0xFF)) {
-			LOGV(LOGTAG, "skipping header");
-			continue;
-		}
-		UINT16 offset = buffer[0] + (buffer[1] << 8);
-		fread(buffer, 2, 1, f);
-		UINT16 size = buffer[0] + (buffer[1] << 8) - offset + 1;
-		LOGV(LOGTAG, "reading offset %04X size: %04X", offset, size);
-		fread(buffer, size, 1, f);
-
-		bus_write(offset, buffer, size);
-	}
-
-	fclose(f);
+	xex_stage(xex);
 }
 
 void utils_dump_mem(UINT16 offset, UINT16 size) {
@@ -138,7 +119,7 @@ char **utils_split(const char *s, unsigned *count) {
 }
 
 char *utils_format_date(time_t time) {
-	static char buffer[100];
+	char buffer[100];
 
 	int len = sizeof(buffer);
 	struct tm t;
@@ -154,7 +135,7 @@ char *utils_format_date(time_t time) {
 }
 
 char *utils_format_time(time_t time) {
-	static char buffer[100];
+	char buffer[100];
 
 	int len = sizeof(buffer);
 	struct tm t;
@@ -13,7 +13,7 @@
 
 
 #define CPU_RUN(X) for(int nx=0; nx<X; nx++) CPU_GO(1)
-#define CPU_SCANLINE() CPU_RUN(144-8);CPU_RESUME();CPU_RUN(8)
+#define CPU_SCANLINE() cpu_wake();CPU_RUN(CHRONI_VBLANK_TICKS-8);CPU_RESUME();CPU_RUN(8)
 #define CPU_XPOS() if ((xpos++ & 3) == 0) CPU_GO(1)
 
 #define VRAM_WORD(addr) (WORD(VRAM_DATA(addr), VRAM_DATA(addr+1)))
@@ -48,8 +48,11 @@ static UINT32 sprites;
 static UINT32 tileset_small;
 static UINT32 tileset_big;
 
-// this is an RGB565 -> RGB888 conversion array for emulation only
-static UINT8 rgb565[0x10000 * 3];
+// RGB565 -> RGB888 conversion for emulation only, same values as a lookup table
+#define RGB565_R(c) (((c) >> 8) & 0xF8)
+#define RGB565_G(c) (((c) >> 3) & 0xFC)
+#define RGB565_B(c) (((c) << 3) & 0xF8)
+
 static UINT8 pixel_color_r;
 static UINT8 pixel_color_g;
 static UINT8 pixel_color_b;
@@ -88,6 +91,19 @@ UINT8 chroni_vram_read(UINT16 index) {
 	return VRAM_DATA(PAGE_BASE(page) + index);
 }
 
+/* VRAM address seen through the window with the current page */
+UINT32 chroni_vram_address(UINT16 index) {
+	return (PAGE_BASE(page) + index) & 0x1FFFF;
+}
+
+UINT8 chroni_vram_peek(UINT32 addr) {
+	return VRAM_DATA(addr);
+}
+
+void chroni_vram_poke(UINT32 addr, UINT8 value) {
+	VRAM_DATA(addr) = value;
+}
+
 static void reg_addr_low(UINT32 *reg, UINT8 value) {
 	*reg = (*reg & 0xFFFE00) | (value << 1);
 }
@@ -171,9 +187,9 @@ UINT8 chroni_register_read(UINT8 index) {
 static inline void set_pixel_color(UINT8 color) {
 	UINT16 pixel_color_rgb565 = VRAM_WORD(palette + color*2 + 0);
 
-	pixel_color_r = rgb565[pixel_color_rgb565*3 + 0];
-	pixel_color_g = rgb565[pixel_color_rgb565*3 + 1];
-	pixel_color_b = rgb565[pixel_color_rgb565*3 + 2];
+	pixel_color_r = RGB565_B(pixel_color_rgb565);
+	pixel_color_g = RGB565_G(pixel_color_rgb565);
+	pixel_color_b = RGB565_R(pixel_color_rgb565);
 }
 
 #define SPRITE_ATTR_ENABLED 0x10
@@ -187,8 +203,10 @@ static inline void set_pixel_color(UINT8 color) {
 
 static UINT8 sprite_scanlines[SPRITES_MAX];
 
+/* status and the scanline counter change on every line, wake up idle loops polling them */
 static void do_scan_start() {
 	status |= STATUS_HBLANK;
+	cpu_wake();
 	if (post_dli && (status & STATUS_ENABLE_INTS)) {
 		LOGV(LOGTAG, "do_scan_start fire DLI");
 		cpuexec_nmi(1);
@@ -280,6 +298,7 @@ static void inline do_border(int offset, int size) {
 }
 
 static void inline do_scan_off(int offset, int size) {
+	cpu_wake();
 	for(int i=0; i<size; i++) {
 		screen[offset + xpos*3 + 0] = 0;
 		screen[offset + xpos*3 + 1] = 0;
@@ -652,6 +671,7 @@ static void do_screen() {
 	cpuexec_nmi(0);
 	LOGV(LOGTAG, "set status %02X enabled:%s", status, (status & STATUS_ENABLE_CHRONI) ? "true":"false");
 	status &= (255 - STATUS_VBLANK);
+	cpuexec_set_vblank(FALSE);
 	LOGV(LOGTAG, "set status %02X enabled:%s", status, (status & STATUS_ENABLE_CHRONI) ? "true":"false");
 
 	scanline = 0;
@@ -737,21 +757,8 @@ static void do_screen() {
 	}
 }
 
-static void init_rgb565_table() {
-	for(int c=0; c<0x10000; c++) {
-		UINT8 r = ((c & 0xF800) >> 11) * (256 / 32);
-		UINT8 g = ((c & 0X07E0) >> 5)  * (256 / 64);
-		UINT8 b = (c & 0X001F) * (256 / 32);
-
-		rgb565[c*3 + 0] = b;
-		rgb565[c*3 + 1] = g;
-		rgb565[c*3 + 2] = r;
-	}
-}
-
 void chroni_init() {
 	trace_enabled = TRUE;
-	init_rgb565_table();
 	chroni_reset();
 }
 
@@ -759,6 +766,8 @@ void chroni_run_frame() {
 	do_screen();
 
 	status |= STATUS_VBLANK;
+	cpuexec_set_vblank(TRUE);
+	cpu_wake();
 	if (status & STATUS_ENABLE_INTS) cpuexec_nmi(1);
 }
 
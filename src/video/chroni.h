@@ -6,10 +6,23 @@ void  chroni_vram_write(UINT16 index, UINT8 value);
 
 UINT8 chroni_register_read(UINT8 index);
 UINT8 chroni_vram_read(UINT16 index);
+UINT32 chroni_vram_address(UINT16 index);
+
+/* VRAM by its 17 bit address, without the window */
+UINT8 chroni_vram_peek(UINT32 addr);
+void  chroni_vram_poke(UINT32 addr, UINT8 value);
 
 void  chroni_init();
 void  chroni_run_frame();
 
+/*
+ * chroni runs the CPU as it draws, one master clock tick per CPU cycle.
+ * Ticks of a vblank scanline, of a displayed scanline and of a frame
+ */
+#define CHRONI_VBLANK_TICKS   144
+#define CHRONI_SCANLINE_TICKS 114
+#define CHRONI_FRAME_TICKS    (8*CHRONI_VBLANK_TICKS + 240*CHRONI_SCANLINE_TICKS)
+
 void  chroni_set_scan_callback(void (*scan_callback)(unsigned scanline));
 
 #endif
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <string.h>
+#include "emu.h"
+#include "bus.h"
+#include "cpu.h"
+#include "memory.h"
+#include "video/chroni.h"
+#include "coproc.h"
+#include "cputrace.h"
+#include "coverage.h"
+#include "watch.h"
+
+#define LOGTAG "WATCH"
+#ifdef TRACE_WATCH
+#define TRACE
+#endif
+#include "trace.h"
+
+#define MAX_WATCHPOINTS 32
+
+#define VRAM_SIZE  0x20000
+
+typedef struct {
+	UINT32   start;
+	UINT32   end;
+	UINT8    type;
+	unsigned hits;
+} watchpoint;
+
+static watchpoint watchpoints[MAX_WATCHPOINTS];
+static unsigned watchpoints_count = 0;
+
+UINT8 watch_pages[0x100];
+static bool trace_pages = FALSE;
+static bool coverage_pages = FALSE;
+
+static struct {
+	bool     pending;
+	unsigned index;
+	UINT32   addr;
+	UINT8    type;
+	int      old_value;
+	UINT8    value;
+} hit;
+
+/* write and change watchpoints are both checked on writes */
+#define PAGE_FLAGS(type) ((type) & (WATCH_READ | WATCH_WRITE | WATCH_CHANGE))
+
+static void update_pages() {
+	UINT8 flags = (trace_pages ? WATCH_TRACE : 0) | (coverage_pages ? WATCH_COVERAGE : 0);
+	for(int page=0; page<0x100; page++) {
+		watch_pages[page] = flags | (watch_pages[page] & WATCH_CODE);
+	}
+
+	for(int i=0; i<watchpoints_count; i++) {
+		watchpoint *w = &watchpoints[i];
+		UINT8 flags = PAGE_FLAGS(w->type);
+		if (w->type & WATCH_VRAM) {
+			/* any page of the window can show the watched address */
+			for(UINT32 page = CHRONI_MEM_START >> 8; page <= CHRONI_MEM_END >> 8; page++) {
+				watch_pages[page] |= flags;
+			}
+		} else {
+			for(UINT32 page = w->start >> 8; page <= w->end >> 8; page++) {
+				watch_pages[page] |= flags;
+			}
+		}
+	}
+}
+
+bool watch_add(UINT32 addr, UINT32 size, UINT8 type) {
+	UINT32 limit = (type & WATCH_VRAM) ? VRAM_SIZE : 0x10000;
+	if (watchpoints_count == MAX_WATCHPOINTS || size == 0 || addr >= limit) return FALSE;
+	if (addr + size > limit) size = limit - addr;
+
+	watchpoint *w = &watchpoints[watchpoints_count++];
+	w->start = addr;
+	w->end   = addr + size - 1;
+	w->type  = type;
+	w->hits  = 0;
+	update_pages();
+	return TRUE;
+}
+
+void watch_del(unsigned index) {
+	if (index >= watchpoints_count) return;
+
+	for(int i = index; i<watchpoints_count-1; i++) {
+		watchpoints[i] = watchpoints[i+1];
+	}
+	watchpoints_count--;
+	update_pages();
+}
+
+static const char *type_name(UINT8 type) {
+	if (type & WATCH_READ)  return "read";
+	if (type & WATCH_WRITE) return "write";
+	return "change";
+}
+
+void watch_list() {
+	for(int i=0; i<watchpoints_count; i++) {
+		watchpoint *w = &watchpoints[i];
+		printf("%02d: %s %-6s %05X-%05X hits:%u\n", i,
+				w->type & WATCH_VRAM ? "vram" : "cpu ",
+				type_name(w->type), w->start, w->end, w->hits);
+	}
+}
+
+static void watch_hit(unsigned index, UINT32 addr, UINT8 type, int old_value, UINT8 value) {
+	watchpoints[index].hits++;
+	LOGV(LOGTAG, "watchpoint %d %s %05X = %02X", index, type_name(type), addr, value);
+
+	if (hit.pending) return;
+	hit.pending   = TRUE;
+	hit.index     = index;
+	hit.addr      = addr;
+	hit.type      = type;
+	hit.old_value = old_value;
+	hit.value     = value;
+
+	cpu_request_instrumented();
+}
+
+static void check(UINT16 addr, UINT8 access, int old_value, UINT8 value) {
+	bool   in_window = addr >= CHRONI_MEM_START && addr <= CHRONI_MEM_END;
+	UINT32 vram_addr = in_window ? chroni_vram_address(addr - CHRONI_MEM_START) : 0;
+
+	for(int i=0; i<watchpoints_count; i++) {
+		watchpoint *w = &watchpoints[i];
+		UINT32 target = addr;
+		if (w->type & WATCH_VRAM) {
+			if (!in_window) continue;
+			target = vram_addr;
+		}
+		if (target < w->start || target > w->end) continue;
+
+		if ((w->type & access & (WATCH_READ | WATCH_WRITE))
+			|| ((w->type & WATCH_CHANGE) && access == WATCH_WRITE && old_value != value)) {
+			watch_hit(i, target, w->type, old_value, value);
+		}
+	}
+}
+
+void watch_set_trace(bool enabled) {
+	trace_pages = enabled;
+	update_pages();
+}
+
+void watch_set_coverage(bool enabled) {
+	coverage_pages = enabled;
+	update_pages();
+}
+
+void watch_read(UINT16 addr, UINT8 value) {
+	if (coverage_pages) coverage_access(addr, COVERAGE_READ);
+	if (trace_pages) cputrace_bus(CPUTRACE_READ, addr, value);
+	if (watchpoints_count) check(addr, WATCH_READ, value, value);
+}
+
+void watch_write(UINT16 addr, UINT8 value) {
+	if (coverage_pages) coverage_access(addr, COVERAGE_WRITE);
+	if (trace_pages) cputrace_bus(CPUTRACE_WRITE, addr, value);
+	if (!watchpoints_count) return;
+
+	/* the previous value of a register cannot be read without side effects */
+	int old_value = -1;
+	if (addr >= CHRONI_MEM_START && addr <= CHRONI_MEM_END) {
+		old_value = chroni_vram_read(addr - CHRONI_MEM_START);
+	} else if (addr >= Z80_MAILBOX_START && addr <= Z80_MAILBOX_END) {
+		old_value = coproc_mailbox_read(addr - Z80_MAILBOX_START);
+	} else if (addr >= Z80_WINDOW_START && addr <= Z80_WINDOW_END) {
+		old_value = coproc_window_read(addr - Z80_WINDOW_START);
+	} else if (addr < CHRONI_START || addr > Z80_WINDOW_END) {
+		old_value = mem_readmem16(addr);
+	}
+	check(addr, WATCH_WRITE, old_value, value);
+}
+
+bool watch_is_hit() {
+	return hit.pending;
+}
+
+void watch_report_hit() {
+	if (!hit.pending) return;
+	hit.pending = FALSE;
+
+	if (hit.old_value >= 0 && !(hit.type & WATCH_READ)) {
+		printf("Watchpoint %02d: %s %s %05X = %02X (was %02X)\n", hit.index,
+				hit.type & WATCH_VRAM ? "vram" : "cpu", type_name(hit.type),
+				hit.addr, hit.value, hit.old_value);
+	} else {
+		printf("Watchpoint %02d: %s %s %05X = %02X\n", hit.index,
+				hit.type & WATCH_VRAM ? "vram" : "cpu", type_name(hit.type),
+				hit.addr, hit.value);
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef _WATCH_H
+#define _WATCH_H
+
+/*
+ * Memory watchpoints on CPU and VRAM addresses
+ *
+ * Each 256 byte page of the CPU address space has a flags byte, the bus
+ * only calls into this module for pages with watchpoints. VRAM watchpoints
+ * flag the pages of the VRAM window, the VRAM address is resolved here.
+ *
+ * A hit stops in the monitor before the next instruction.
+ */
+
+#define WATCH_READ   0x01
+#define WATCH_WRITE  0x02
+#define WATCH_CHANGE 0x04
+#define WATCH_VRAM   0x08
+#define WATCH_TRACE  0x10  /* page flag: bus events go to the execution trace */
+#define WATCH_COVERAGE 0x20  /* page flag: bus events go to the coverage map */
+#define WATCH_CODE   0x40  /* page flag: holds cached CPU code, owned by the CPU core */
+
+extern UINT8 watch_pages[0x100];
+
+/* type is WATCH_READ, WATCH_WRITE or WATCH_CHANGE, plus WATCH_VRAM for VRAM addresses */
+bool watch_add(UINT32 addr, UINT32 size, UINT8 type);
+void watch_del(unsigned index);
+void watch_list();
+
+void watch_read(UINT16 addr, UINT8 value);
+void watch_write(UINT16 addr, UINT8 value);
+
+void watch_set_trace(bool enabled);
+void watch_set_coverage(bool enabled);
+
+bool watch_is_hit();
+void watch_report_hit();
+
+#endif
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <zlib.h>
+
+#include "emu.h"
+#include "bus.h"
+#include "xex.h"
+
+#define LOGTAG "UTILS"
+#ifdef TRACE_UTILS
+#define TRACE
+#endif
+#include "trace.h"
+
+#define XEX_CHUNK_SIZE 0x10000
+
+/* file being loaded by stages, only used from the emulation thread */
+static xex_file *staged_xex = NULL;
+
+/* value of a vector if the segment writes both bytes */
+static bool segment_vector(xex_segment *segment, UINT16 addr, UINT16 *vector) {
+	UINT32 end = segment->start + segment->size;
+	if (addr < segment->start || addr + 2 > end) return FALSE;
+
+	const UINT8 *data = segment->data + (addr - segment->start);
+	*vector = data[0] + (data[1] << 8);
+	return TRUE;
+}
+
+/* data is a malloc'ed buffer, owned by the xex from now on */
+xex_file *xex_parse(UINT8 *data, UINT32 size) {
+	xex_file *xex = calloc(1, sizeof(xex_file));
+	xex->buffer = data;
+
+	int segments_size = 0;
+	UINT32 pos = 0;
+	while (pos + 4 <= size) {
+		const UINT8 *header = xex->buffer + pos;
+		if (header[0] == 0xFF && header[1] == 0xFF) {
+			LOGV(LOGTAG, "skipping header");
+			pos += 2;
+			continue;
+		}
+
+		UINT16 start = header[0] + (header[1] << 8);
+		UINT16 end   = header[2] + (header[3] << 8);
+		pos += 4;
+		if (end < start || pos + (end - start + 1) > size) {
+			LOGE(LOGTAG, "invalid segment %04X-%04X at %d", start, end, pos - 4);
+			xex_free(xex);
+			return NULL;
+		}
+
+		if (xex->segments_count == segments_size) {
+			segments_size = segments_size ? segments_size * 2 : 16;
+			xex->segments = realloc(xex->segments, segments_size * sizeof(xex_segment));
+		}
+		xex_segment *segment = &xex->segments[xex->segments_count++];
+		segment->start = start;
+		segment->size  = end - start + 1;
+		segment->data  = xex->buffer + pos;
+		pos += segment->size;
+
+		LOGV(LOGTAG, "segment %04X size: %04X", segment->start, segment->size);
+
+		if (segment_vector(segment, XEX_RUNAD, &xex->run)) xex->has_run = TRUE;
+		segment->has_init = segment_vector(segment, XEX_INITAD, &segment->init);
+		if (segment->has_init && !xex->has_init) {
+			xex->has_init = TRUE;
+			xex->init = segment->init;
+		}
+	}
+
+	if (pos != size) {
+		LOGE(LOGTAG, "%d trailing bytes ignored", size - pos);
+	}
+	return xex;
+}
+
+/*
+ * xex files are read through zlib, so plain and gzip compressed files are handled the same.
+ * If the file does not exist, a compressed version with .gz extension is tried
+ */
+static gzFile open_xex(const char *filename) {
+	gzFile f = gzopen(filename, "rb");
+	if (f || errno != ENOENT) return f;
+
+	char gz_filename[1000];
+	snprintf(gz_filename, sizeof(gz_filename), "%s.gz", filename);
+	return gzopen(gz_filename, "rb");
+}
+
+xex_file *xex_read(const char *filename) {
+	gzFile f = open_xex(filename);
+	if (!f) {
+		LOGE(LOGTAG, "Error opening %s: %s", filename, strerror(errno));
+		return NULL;
+	}
+
+	UINT32 size = 0;
+	UINT32 capacity = XEX_CHUNK_SIZE;
+	UINT8 *data = malloc(capacity);
+	int n;
+	while ((n = gzread(f, data + size, capacity - size)) > 0) {
+		size += n;
+		if (size == capacity) {
+			capacity *= 2;
+			data = realloc(data, capacity);
+		}
+	}
+	gzclose(f);
+
+	if (n < 0) {
+		free(data);
+		return NULL;
+	}
+	return xex_parse(data, size);
+}
+
+/* writes the segments up to the next one that sets INITAD */
+static bool load_stage(xex_file *xex) {
+	if (xex->next_segment == xex->segments_count) return FALSE;
+
+	while (xex->next_segment < xex->segments_count) {
+		xex_segment *segment = &xex->segments[xex->next_segment++];
+		bus_write(segment->start, (UINT8 *)segment->data, segment->size);
+		if (segment->has_init) break;
+	}
+	return TRUE;
+}
+
+void xex_load(xex_file *xex) {
+	while (load_stage(xex));
+}
+
+/* the xex is owned by the loader from now on, a previous file not fully loaded is dropped */
+void xex_stage(xex_file *xex) {
+	if (staged_xex) xex_free(staged_xex);
+	staged_xex = xex;
+	xex_next_stage();
+}
+
+bool xex_next_stage() {
+	if (!staged_xex) return FALSE;
+
+	bool loaded = load_stage(staged_xex);
+	if (staged_xex->next_segment == staged_xex->segments_count) {
+		xex_free(staged_xex);
+		staged_xex = NULL;
+	}
+	return loaded;
+}
+
+void xex_free(xex_file *xex) {
+	free(xex->segments);
+	free(xex->buffer);
+	free(xex);
+}
@@ -0,0 +1,52 @@
+#ifndef _XEX_H
+#define _XEX_H
+
+/*
+ * XEX executables
+ *
+ * A xex file is a list of segments: start address, end address (inclusive)
+ * and contents. Segments may be preceded by a $FFFF header.
+ * A segment that writes RUNAD sets the address where the program starts,
+ * a segment that writes INITAD sets a routine that is called as soon as
+ * that segment is loaded, before the rest of the file
+ *
+ * The file is parsed once, then written to memory in stages: each stage
+ * ends with a segment that writes INITAD, or with the end of the file.
+ * Programs are loaded with xex_stage and the guest calls INITAD and asks
+ * for the next stage (see CMD_LOAD_XEX_NEXT in storage.c) until there is
+ * no INITAD left. xex_load writes the whole file in one pass, for images
+ * that do not run code while loading
+ */
+
+#define XEX_RUNAD  0x02E0
+#define XEX_INITAD 0x02E2
+
+typedef struct {
+	UINT16 start;
+	UINT32 size;
+	const UINT8 *data;
+	bool has_init;
+	UINT16 init;
+} xex_segment;
+
+typedef struct {
+	UINT8 *buffer;
+	xex_segment *segments;
+	int segments_count;
+	int next_segment;
+
+	/* the last RUNAD and the INITAD of the first stage */
+	bool has_run;
+	bool has_init;
+	UINT16 run;
+	UINT16 init;
+} xex_file;
+
+xex_file *xex_parse(UINT8 *data, UINT32 size);
+xex_file *xex_read(const char *filename);
+void      xex_load(xex_file *xex);
+void      xex_stage(xex_file *xex);
+bool      xex_next_stage();
+void      xex_free(xex_file *xex);
+
+#endif
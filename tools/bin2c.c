@@ -0,0 +1,46 @@
+/*
+ * bin2c: embed a binary file in the emulator
+ *
+ * usage: bin2c name input output.c
+ *
+ * Writes a C file that defines
+ *   const unsigned char name[];
+ *   const unsigned int  name_size;
+ */
+#include <stdio.h>
+
+int main(int argc, char *argv[]) {
+	if (argc != 4) {
+		fprintf(stderr, "usage: bin2c name input output.c\n");
+		return 1;
+	}
+
+	FILE *in = fopen(argv[2], "rb");
+	if (!in) {
+		fprintf(stderr, "cannot open file %s\n", argv[2]);
+		return 1;
+	}
+
+	FILE *out = fopen(argv[3], "wt");
+	if (!out) {
+		fprintf(stderr, "cannot create file %s\n", argv[3]);
+		fclose(in);
+		return 1;
+	}
+
+	fprintf(out, "/* generated by bin2c from %s */\n\n", argv[2]);
+	fprintf(out, "const unsigned char %s[] = {", argv[1]);
+
+	unsigned size = 0;
+	int c;
+	while ((c = fgetc(in)) != EOF) {
+		fprintf(out, "%s0x%02X,", (size % 16) ? " " : "\n\t", c);
+		size++;
+	}
+	fprintf(out, "\n};\n\n");
+	fprintf(out, "const unsigned int %s_size = %u;\n", argv[1], size);
+
+	fclose(in);
+	fclose(out);
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * covlist: annotate assembler listings with a coverage map
+ *
+ * usage: covlist coverage.bin listing.lst [listing.lst ...]
+ *
+ * Each listing line with an address is prefixed with the flags of the
+ * bytes it emits: X executed opcode, o executed operand, R read, W written,
+ * '-' for bytes never touched. A summary per listing is printed at the end.
+ * See src/coverage.h for the format
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/emu.h"
+#include "../src/coverage.h"
+#include "../src/symbols.h"
+
+/* logging is not compiled in the tool */
+int trace_enabled = 0;
+
+static UINT8 map[COVERAGE_CPU_SIZE];
+
+static int is_hex(char c) {
+	return ('0' <= c && c <= '9') || ('A' <= c && c <= 'F');
+}
+
+/* flags of the bytes emitted by a line, from the hex bytes after the address */
+static UINT8 line_flags(const char *line, int len, UINT16 addr, int *size) {
+	int start = 12;
+	if (len >= 17 && !strncmp(line + 7, "FFFF>", 5)) start = 18;
+
+	*size = 0;
+	for(int i = start; i + 1 < len && *size < 8; i += 3) {
+		if (!is_hex(line[i]) || !is_hex(line[i+1])) break;
+		if (i + 2 < len && line[i+2] != ' ' && line[i+2] != '\t') break;
+		(*size)++;
+	}
+
+	UINT8 flags = 0;
+	for(int i=0; i<*size; i++) {
+		flags |= map[(UINT16)(addr + i)];
+	}
+	return flags;
+}
+
+static void annotate(const char *filename) {
+	FILE *f = fopen(filename, "r");
+	if (!f) {
+		fprintf(stderr, "cannot open file %s\n", filename);
+		return;
+	}
+
+	unsigned lines = 0, executed = 0, accessed = 0;
+
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		int len = strlen(line);
+		while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r')) line[--len] = 0;
+
+		int addr = symbols_listing_addr(line, len);
+		int size = 0;
+		UINT8 flags = addr >= 0 ? line_flags(line, len, addr, &size) : 0;
+		if (size == 0) {
+			printf("     %s\n", line);
+			continue;
+		}
+
+		printf("%c%c%c%c %s\n",
+				flags & COVERAGE_OPCODE  ? 'X' : '-',
+				flags & COVERAGE_OPERAND ? 'o' : '-',
+				flags & COVERAGE_READ    ? 'R' : '-',
+				flags & COVERAGE_WRITE   ? 'W' : '-',
+				line);
+
+		lines++;
+		if (flags & (COVERAGE_OPCODE | COVERAGE_OPERAND)) executed++;
+		else if (flags & (COVERAGE_READ | COVERAGE_WRITE)) accessed++;
+	}
+	fclose(f);
+
+	fprintf(stderr, "%s: %u lines, %u executed, %u accessed as data, %u untouched\n",
+			filename, lines, executed, accessed, lines - executed - accessed);
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 3) {
+		fprintf(stderr, "usage: covlist coverage.bin listing.lst [listing.lst ...]\n");
+		return 1;
+	}
+
+	FILE *f = fopen(argv[1], "rb");
+	if (!f) {
+		fprintf(stderr, "cannot open file %s\n", argv[1]);
+		return 1;
+	}
+
+	coverage_header header;
+	if (fread(&header, sizeof(header), 1, f) != 1
+		|| memcmp(header.magic, COVERAGE_MAGIC, sizeof(header.magic))
+		|| header.version != COVERAGE_VERSION
+		|| header.cpu_size != COVERAGE_CPU_SIZE
+		|| fread(map, 1, sizeof(map), f) != sizeof(map)) {
+		fprintf(stderr, "invalid coverage file %s\n", argv[1]);
+		fclose(f);
+		return 1;
+	}
+	fclose(f);
+
+	for(int arg = 2; arg < argc; arg++) {
+		annotate(argv[arg]);
+	}
+	return 0;
+}
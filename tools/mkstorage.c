@@ -0,0 +1,203 @@
+/*
+ * mkstorage: pack a host directory into a storage image
+ *
+ * usage: mkstorage [-a align] rootdir image.bin
+ *
+ * The image can be mounted with "clc88 -storage image.bin"
+ * See src/storage_image.h for the format
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include "../src/emu.h"
+#include "../src/storage_image.h"
+
+#define PATH_MAX_SIZE 1000
+
+typedef struct {
+	char  *path;  /* relative to root */
+	int    index; /* position before sorting */
+	int    parent;
+	struct stat st;
+} pack_entry;
+
+static pack_entry *entries = NULL;
+static int entries_count = 0;
+static int entries_size  = 0;
+
+static char root[PATH_MAX_SIZE];
+
+static void add_entry(const char *path, int parent, struct stat *st) {
+	if (entries_count == entries_size) {
+		entries_size = entries_size ? entries_size * 2 : 256;
+		entries = realloc(entries, entries_size * sizeof(pack_entry));
+	}
+	pack_entry *entry = &entries[entries_count++];
+	entry->path   = strdup(path);
+	entry->index  = entries_count - 1;
+	entry->parent = parent;
+	entry->st     = *st;
+}
+
+static void scan_dir(const char *path, int parent) {
+	char dirname[PATH_MAX_SIZE*2];
+	snprintf(dirname, sizeof(dirname), "%s/%s", root, path);
+
+	DIR *dir = opendir(dirname);
+	if (!dir) {
+		fprintf(stderr, "cannot open dir %s\n", dirname);
+		exit(1);
+	}
+
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		if (!strcmp(dirent->d_name, ".") || !strcmp(dirent->d_name, "..")) continue;
+
+		char entry_path[PATH_MAX_SIZE];
+		char host_path[PATH_MAX_SIZE*2];
+		if (path[0]) {
+			snprintf(entry_path, PATH_MAX_SIZE, "%s/%s", path, dirent->d_name);
+		} else {
+			snprintf(entry_path, PATH_MAX_SIZE, "%s", dirent->d_name);
+		}
+		snprintf(host_path, sizeof(host_path), "%s/%s", root, entry_path);
+
+		/* links to files are followed, links to directories are skipped as they may loop */
+		struct stat st;
+		if (lstat(host_path, &st)) continue;
+		if (S_ISLNK(st.st_mode) && (stat(host_path, &st) || S_ISDIR(st.st_mode))) continue;
+		if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode)) continue;
+
+		add_entry(entry_path, parent, &st);
+		if (S_ISDIR(st.st_mode)) {
+			scan_dir(entry_path, entries_count - 1);
+		}
+	}
+	closedir(dir);
+}
+
+static int compare_entries(const void *a, const void *b) {
+	return strcmp(((pack_entry *)a)->path, ((pack_entry *)b)->path);
+}
+
+static UINT32 align_offset(UINT32 offset, UINT32 align) {
+	return (offset + align - 1) / align * align;
+}
+
+static void write_padding(FILE *f, UINT32 offset) {
+	long pos = ftell(f);
+	while (pos++ < offset) fputc(0, f);
+}
+
+static bool write_file_data(FILE *f, pack_entry *entry) {
+	char host_path[PATH_MAX_SIZE*2];
+	snprintf(host_path, sizeof(host_path), "%s/%s", root, entry->path);
+
+	FILE *src = fopen(host_path, "rb");
+	if (!src) {
+		fprintf(stderr, "cannot open file %s\n", host_path);
+		return FALSE;
+	}
+
+	char buffer[0x10000];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), src)) > 0) {
+		fwrite(buffer, 1, n, f);
+	}
+	fclose(src);
+	return TRUE;
+}
+
+int main(int argc, char *argv[]) {
+	UINT32 align = STORAGE_IMAGE_ALIGN;
+
+	int arg = 1;
+	if (argc > 2 && !strcmp(argv[1], "-a")) {
+		align = atoi(argv[2]);
+		arg = 3;
+	}
+	if (argc - arg != 2 || align == 0) {
+		fprintf(stderr, "usage: mkstorage [-a align] rootdir image.bin\n");
+		return 1;
+	}
+
+	strncpy(root, argv[arg], PATH_MAX_SIZE-1);
+	int last_char = strlen(root)-1;
+	if (last_char > 0 && root[last_char] == '/') root[last_char] = 0;
+
+	scan_dir("", STORAGE_IMAGE_ROOT);
+
+	/* sort by path and remap the parent indexes */
+	int *order = malloc(entries_count * sizeof(int));
+	qsort(entries, entries_count, sizeof(pack_entry), compare_entries);
+	for(int i=0; i<entries_count; i++) {
+		order[entries[i].index] = i;
+	}
+
+	storage_image_entry *image_entries = calloc(entries_count, sizeof(storage_image_entry));
+
+	UINT32 names_offset = sizeof(storage_image_header) + entries_count * sizeof(storage_image_entry);
+	UINT32 names_size = 0;
+	for(int i=0; i<entries_count; i++) {
+		image_entries[i].name = names_size;
+		names_size += strlen(entries[i].path) + 1;
+	}
+
+	UINT32 data_offset = align_offset(names_offset + names_size, align);
+	UINT32 offset = data_offset;
+	for(int i=0; i<entries_count; i++) {
+		pack_entry *entry = &entries[i];
+		storage_image_entry *image_entry = &image_entries[i];
+
+		image_entry->parent = entry->parent == STORAGE_IMAGE_ROOT ? STORAGE_IMAGE_ROOT : order[entry->parent];
+		image_entry->mtime  = entry->st.st_mtime;
+		if (S_ISDIR(entry->st.st_mode)) {
+			image_entry->flags  = STORAGE_IMAGE_DIR;
+			image_entry->offset = 0;
+		} else {
+			image_entry->size   = entry->st.st_size;
+			image_entry->offset = offset;
+			offset = align_offset(offset + image_entry->size, align);
+		}
+	}
+
+	storage_image_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, STORAGE_IMAGE_MAGIC, sizeof(header.magic));
+	header.version      = STORAGE_IMAGE_VERSION;
+	header.entries      = entries_count;
+	header.names_offset = names_offset;
+	header.names_size   = names_size;
+	header.data_offset  = data_offset;
+	header.align        = align;
+
+	FILE *f = fopen(argv[arg+1], "wb");
+	if (!f) {
+		fprintf(stderr, "cannot create image %s\n", argv[arg+1]);
+		return 1;
+	}
+
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(image_entries, sizeof(storage_image_entry), entries_count, f);
+	for(int i=0; i<entries_count; i++) {
+		fwrite(entries[i].path, strlen(entries[i].path) + 1, 1, f);
+	}
+
+	for(int i=0; i<entries_count; i++) {
+		if (S_ISDIR(entries[i].st.st_mode)) continue;
+
+		write_padding(f, image_entries[i].offset);
+		if (!write_file_data(f, &entries[i])) {
+			fclose(f);
+			return 1;
+		}
+	}
+	printf("%d entries, %ld bytes\n", entries_count, ftell(f));
+	fclose(f);
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * tracedump: decode a binary execution trace
+ *
+ * usage: tracedump [-n count] [-65c02|-65ce02|-4510] trace.bin [listing.lst ...]
+ *
+ * Prints the records in the ring from the oldest one, or only the last
+ * count records. -65c02, -65ce02 and -4510 disassemble with the opcodes
+ * of that CPU. Listings are used to show the enclosing label of each
+ * instruction. See src/cputrace.h for the format
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../src/emu.h"
+#include "../src/cputrace.h"
+#include "../src/symbols.h"
+#include "../src/cpu/m6502/m6502.h"
+#include "../src/cpu/m6502/m65ce02.h"
+#include "../src/cpu/m6502/m4510.h"
+
+unsigned Dasm6502(char *buffer, unsigned pc);
+
+/* logging is not compiled in the tool */
+int trace_enabled = 0;
+
+/* the disassembler reads the opcode bytes of the record being decoded */
+static const cputrace_record *current;
+
+UINT8 cpu_readop(UINT16 pc) {
+	UINT16 offset = pc - current->addr;
+	return offset < 3 ? current->bytes[offset] : 0;
+}
+UINT8 cpu_readop_arg(UINT16 pc) {
+	return cpu_readop(pc);
+}
+UINT8 cpu_readmem16(UINT16 addr) {
+	return 0;
+}
+UINT8 cpu_readmem20(UINT32 addr) {
+	return 0;
+}
+
+/* the disassembler asks for the cpu subtype */
+static unsigned subtype = SUBTYPE_6502;
+
+unsigned m6502_get_reg(int regnum) {
+	return regnum == M6502_SUBTYPE ? subtype : 0;
+}
+unsigned m65ce02_get_reg(int regnum) {
+	return 0;
+}
+unsigned m4510_get_reg(int regnum) {
+	return 0;
+}
+
+static unsigned (*disassemble)(char *buffer, unsigned pc) = Dasm6502;
+
+static void print_label(UINT16 addr) {
+	UINT16 label_addr;
+	const char *label = symbols_get_enclosing_label(addr, &label_addr);
+	if (!label) return;
+
+	if (label_addr == addr) {
+		printf("  %s", label);
+	} else {
+		printf("  %s+%d", label, addr - label_addr);
+	}
+}
+
+static void print_record(const cputrace_record *record) {
+	if (record->type != CPUTRACE_INSN) {
+		printf("%10u        %c %04X = %02X\n", record->cycle,
+				record->type == CPUTRACE_READ ? 'R' : 'W', record->addr, record->bytes[0]);
+		return;
+	}
+
+	current = record;
+	char disasm[100];
+	unsigned size = disassemble(disasm, record->addr) & 0xFF;
+	for(char *c = disasm; *c; c++) *c = toupper(*c);
+
+	char bytes[20] = "";
+	for(int i=0; i<3; i++) {
+		char hex[4] = "   ";
+		if (i < size) sprintf(hex, "%02X ", record->bytes[i]);
+		strcat(bytes, hex);
+	}
+
+	printf("%10u %04X %s %-16s A:%02X X:%02X Y:%02X P:%02X S:%02X",
+			record->cycle, record->addr, bytes, disasm,
+			record->regs[0], record->regs[1], record->regs[2], record->regs[3], record->regs[4]);
+	print_label(record->addr);
+	printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+	UINT64 last = 0;
+	int arg = 1;
+	if (arg + 1 < argc && !strcmp(argv[arg], "-n")) {
+		last = strtoull(argv[arg+1], NULL, 10);
+		arg += 2;
+	}
+	if (arg < argc && !strcmp(argv[arg], "-65c02")) {
+		subtype = SUBTYPE_65C02;
+		arg++;
+	} else if (arg < argc && !strcmp(argv[arg], "-65ce02")) {
+		disassemble = Dasm65ce02;
+		arg++;
+	} else if (arg < argc && !strcmp(argv[arg], "-4510")) {
+		disassemble = Dasm4510;
+		arg++;
+	}
+	if (arg >= argc) {
+		fprintf(stderr, "usage: tracedump [-n count] [-65c02|-65ce02|-4510] trace.bin [listing.lst ...]\n");
+		return 1;
+	}
+
+	FILE *f = fopen(argv[arg], "rb");
+	if (!f) {
+		fprintf(stderr, "cannot open file %s\n", argv[arg]);
+		return 1;
+	}
+
+	cputrace_header header;
+	if (fread(&header, sizeof(header), 1, f) != 1
+		|| memcmp(header.magic, CPUTRACE_MAGIC, sizeof(header.magic))
+		|| header.version != CPUTRACE_VERSION
+		|| header.record_size != sizeof(cputrace_record)
+		|| header.capacity == 0) {
+		fprintf(stderr, "invalid trace file %s\n", argv[arg]);
+		fclose(f);
+		return 1;
+	}
+
+	cputrace_record *records = malloc((size_t)header.capacity * sizeof(cputrace_record));
+	if (fread(records, sizeof(cputrace_record), header.capacity, f) != header.capacity) {
+		fprintf(stderr, "truncated trace file %s\n", argv[arg]);
+		fclose(f);
+		return 1;
+	}
+	fclose(f);
+
+	symbols_init();
+	for(arg++; arg < argc; arg++) {
+		symbols_load_listing(argv[arg]);
+	}
+
+	UINT64 end   = header.count;
+	UINT64 start = end > header.capacity ? end - header.capacity : 0;
+	if (last && end - start > last) start = end - last;
+
+	for(UINT64 i = start; i < end; i++) {
+		print_record(&records[i % header.capacity]);
+	}
+	if (header.frozen) printf("(frozen)\n");
+
+	free(records);
+	return 0;
+}
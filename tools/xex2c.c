@@ -0,0 +1,276 @@
+/*
+ * xex2c: translate the code of an xex to C
+ *
+ * usage: xex2c name input.xex input.lst output.c [start end]
+ *
+ * Code is found from the NMI, reset and IRQ vectors, from the listing lines
+ * that hold an instruction and from the targets of branches and jumps.
+ * Each run of consecutive instructions that have a micro-op in
+ * src/cpu/m6502/b6502.c becomes one function, entered at any of its
+ * instructions. Branches, jumps, stack frames, interrupt flag and illegal
+ * instructions are left to the interpreter.
+ *
+ * Only code from start to end (hex, inclusive) is translated, by default
+ * the whole image except the registers and the VRAM window.
+ * See src/cpu/m6502/a6502.h for the generated tables
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../src/emu.h"
+#include "../src/symbols.h"
+#include "../src/cpu/m6502/a6502.h"
+
+unsigned Dasm6502(char *buffer, unsigned pc);
+
+/* logging is not compiled in the tool */
+int trace_enabled = 0;
+
+/* opcodes with a micro-op, see uop_info in src/cpu/m6502/b6502.c */
+static const UINT8 translated_opcodes[] = {
+	0x01, 0x05, 0x06, 0x09, 0x0a, 0x0d, 0x0e, 0x11, 0x15, 0x16, 0x18, 0x19, 0x1d, 0x1e,
+	0x21, 0x24, 0x25, 0x26, 0x29, 0x2a, 0x2c, 0x2d, 0x2e, 0x31, 0x35, 0x36, 0x38, 0x39, 0x3d, 0x3e,
+	0x41, 0x45, 0x46, 0x48, 0x49, 0x4a, 0x4d, 0x4e, 0x51, 0x55, 0x56, 0x59, 0x5d, 0x5e,
+	0x61, 0x65, 0x66, 0x68, 0x69, 0x6a, 0x6d, 0x6e, 0x71, 0x75, 0x76, 0x79, 0x7d, 0x7e,
+	0x81, 0x84, 0x85, 0x86, 0x88, 0x8a, 0x8c, 0x8d, 0x8e, 0x91, 0x94, 0x95, 0x96, 0x98, 0x99, 0x9a, 0x9d,
+	0xa0, 0xa1, 0xa2, 0xa4, 0xa5, 0xa6, 0xa8, 0xa9, 0xaa, 0xac, 0xad, 0xae,
+	0xb1, 0xb4, 0xb5, 0xb6, 0xb8, 0xb9, 0xba, 0xbc, 0xbd, 0xbe,
+	0xc0, 0xc1, 0xc4, 0xc5, 0xc6, 0xc8, 0xc9, 0xca, 0xcc, 0xcd, 0xce, 0xd1, 0xd5, 0xd6, 0xd8, 0xd9, 0xdd, 0xde,
+	0xe0, 0xe1, 0xe4, 0xe5, 0xe6, 0xe8, 0xe9, 0xea, 0xec, 0xed, 0xee, 0xf1, 0xf5, 0xf6, 0xf8, 0xf9, 0xfd, 0xfe,
+};
+
+static bool translated[0x100];
+
+static UINT8 image[0x10000];
+static bool  loaded[0x10000];
+static UINT8 insn_size[0x10000];  /* nonzero where an instruction starts */
+static bool  claimed[0x10000];    /* byte of a decoded instruction */
+
+static unsigned range_start = 0;
+static unsigned range_end   = 0xFFFF;
+
+/* the disassembler reads the image */
+UINT8 cpu_readop(UINT16 pc) {
+	return image[pc];
+}
+UINT8 cpu_readop_arg(UINT16 pc) {
+	return image[pc];
+}
+UINT8 cpu_readmem16(UINT16 addr) {
+	return image[addr];
+}
+
+/* the disassembler asks for the cpu subtype, the image is for a plain 6502 */
+unsigned m6502_get_reg(int regnum) {
+	return 0;
+}
+
+static bool in_range(unsigned addr) {
+	if (addr < range_start || addr > range_end) return FALSE;
+	/* registers and VRAM window, the same address can hold different bytes */
+	return addr < 0x9000 || addr >= 0xE000;
+}
+
+static bool load_xex(const char *filename) {
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		fprintf(stderr, "cannot open file %s\n", filename);
+		return FALSE;
+	}
+
+	UINT8 header[4];
+	while (fread(header, 1, 2, f) == 2) {
+		if (header[0] == 0xFF && header[1] == 0xFF) continue;
+		if (fread(header + 2, 1, 2, f) != 2) break;
+
+		unsigned start = header[0] + (header[1] << 8);
+		unsigned end   = header[2] + (header[3] << 8);
+		if (end < start || fread(image + start, 1, end - start + 1, f) != end - start + 1) {
+			fprintf(stderr, "invalid segment %04X-%04X in %s\n", start, end, filename);
+			fclose(f);
+			return FALSE;
+		}
+		for(unsigned addr = start; addr <= end; addr++) loaded[addr] = TRUE;
+	}
+	fclose(f);
+	return TRUE;
+}
+
+static unsigned opcode_size(UINT16 pc) {
+	char buffer[100];
+	return Dasm6502(buffer, pc) & 0xFF;
+}
+
+/* decode from each entry point, following branches and jumps */
+static void trace_code(UINT16 entry) {
+	/* each instruction adds at most one target */
+	static UINT16 pending[0x10001];
+	int pending_count = 0;
+	pending[pending_count++] = entry;
+
+	while (pending_count) {
+		unsigned pc = pending[--pending_count];
+		for(;;) {
+			if (!in_range(pc) || insn_size[pc]) break;
+
+			unsigned size = opcode_size(pc);
+			bool valid = size > 0;
+			for(unsigned i=0; i<size; i++) {
+				unsigned addr = pc + i;
+				if (addr > 0xFFFF || !loaded[addr] || claimed[addr] || !in_range(addr)) valid = FALSE;
+			}
+			if (!valid) break;
+
+			for(unsigned i=0; i<size; i++) claimed[pc + i] = TRUE;
+			insn_size[pc] = size;
+
+			UINT8 op = image[pc];
+			UINT16 next = pc + size;
+			if ((op & 0x1F) == 0x10) {
+				/* branch */
+				pending[pending_count++] = next + (INT8)image[pc + 1];
+			} else if (op == 0x20 || op == 0x4C) {
+				/* JSR, JMP */
+				pending[pending_count++] = image[pc + 1] + (image[pc + 2] << 8);
+				if (op == 0x4C) break;
+			} else if (op == 0x00 || op == 0x40 || op == 0x60 || op == 0x6C) {
+				/* BRK, RTI, RTS, JMP indirect */
+				break;
+			}
+			pc = next;
+		}
+	}
+}
+
+static void trace_vector(UINT16 vector) {
+	if (!loaded[vector] || !loaded[vector + 1]) return;
+	trace_code(image[vector] + (image[vector + 1] << 8));
+}
+
+/* listing lines whose source is the instruction at their address */
+static void trace_listing(const char *filename) {
+	FILE *f = fopen(filename, "r");
+	if (!f) {
+		fprintf(stderr, "cannot open file %s\n", filename);
+		return;
+	}
+
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		int len = strlen(line);
+		int addr = symbols_listing_addr(line, len);
+		if (addr < 0 || !loaded[addr]) continue;
+
+		/* skip the bytes, then an optional label */
+		int pos = len >= 17 && !strncmp(line + 7, "FFFF>", 5) ? 18 : 12;
+		while (pos + 2 < len && isxdigit(line[pos]) && isxdigit(line[pos+1]) && isspace(line[pos+2])) pos += 3;
+		while (pos < len && isspace(line[pos])) pos++;
+
+		char word[16];
+		int n = 0;
+		while (pos < len && !isspace(line[pos]) && n < sizeof(word) - 1) word[n++] = tolower(line[pos++]);
+		word[n] = 0;
+		if (n > 0 && word[n-1] == ':') {
+			while (pos < len && isspace(line[pos])) pos++;
+			n = 0;
+			while (pos < len && !isspace(line[pos]) && n < sizeof(word) - 1) word[n++] = tolower(line[pos++]);
+			word[n] = 0;
+		}
+		if (n != 3) continue;
+
+		char disasm[100];
+		Dasm6502(disasm, addr);
+		if (!strncmp(disasm, word, 3)) trace_code(addr);
+	}
+	fclose(f);
+}
+
+static bool is_translated(unsigned addr) {
+	return addr <= 0xFFFF && insn_size[addr] && translated[image[addr]];
+}
+
+static int write_block(FILE *out, const char *name, unsigned start) {
+	fprintf(out, "static void %s_%04X(UINT16 pc)\n{\n\tswitch (pc)\n\t{\n", name, start);
+
+	int count = 0;
+	unsigned addr;
+	for(addr = start; is_translated(addr); addr += insn_size[addr]) {
+		unsigned size = insn_size[addr];
+		unsigned arg = 0;
+		if (size > 1) arg  = image[addr + 1];
+		if (size > 2) arg |= image[addr + 2] << 8;
+		fprintf(out, "\tcase 0x%04X: AOT_UOP(%02x, 0x%04X, 0x%04X, 0x%04X);\n",
+				addr, image[addr], addr, (addr + size) & 0xFFFF, arg);
+		count++;
+	}
+	fprintf(out, "\t}\n}\n\n");
+
+	fprintf(out, "static const UINT16 %s_%04X_entries[] = {", name, start);
+	int n = 0;
+	for(addr = start; is_translated(addr); addr += insn_size[addr]) {
+		fprintf(out, "%s0x%04X,", (n++ % 8) ? " " : "\n\t", addr);
+	}
+	fprintf(out, "\n};\n\n");
+	return count;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 5 && argc != 7) {
+		fprintf(stderr, "usage: xex2c name input.xex input.lst output.c [start end]\n");
+		return 1;
+	}
+	const char *name = argv[1];
+	if (argc == 7) {
+		range_start = strtoul(argv[5], NULL, 16);
+		range_end   = strtoul(argv[6], NULL, 16);
+	}
+
+	for(int i=0; i<sizeof(translated_opcodes); i++) translated[translated_opcodes[i]] = TRUE;
+
+	if (!load_xex(argv[2])) return 1;
+
+	trace_vector(0xFFFA);
+	trace_vector(0xFFFC);
+	trace_vector(0xFFFE);
+	trace_listing(argv[3]);
+
+	FILE *out = fopen(argv[4], "wt");
+	if (!out) {
+		fprintf(stderr, "cannot create file %s\n", argv[4]);
+		return 1;
+	}
+	fprintf(out, "/* generated by xex2c from %s */\n\n", argv[2]);
+
+	/* runs of translated instructions, in address order */
+	static UINT16 starts[0x10000];
+	int blocks = 0, instructions = 0;
+	for(unsigned addr = 0; addr <= 0xFFFF; addr++) {
+		if (!is_translated(addr)) continue;
+
+		starts[blocks++] = addr;
+		instructions += write_block(out, name, addr);
+		while (is_translated(addr)) addr += insn_size[addr];
+	}
+
+	fprintf(out, "static const m6502_aot_block %s[] = {\n", name);
+	for(int i=0; i<blocks; i++) {
+		unsigned start = starts[i], end = start, count = 0;
+		while (is_translated(end)) {
+			end += insn_size[end];
+			count++;
+		}
+
+		UINT32 hash = M6502_AOT_HASH_INIT;
+		for(unsigned addr = start; addr < end; addr++) hash = m6502_aot_hash(hash, image[addr]);
+
+		fprintf(out, "\t{0x%04X, 0x%04X, 0x%08X, %s_%04X, %s_%04X_entries, %u},\n",
+				start, end - start, hash, name, start, name, start, count);
+	}
+	fprintf(out, "\t{0, 0, 0, NULL, NULL, 0}\n};\n");
+	fclose(out);
+
+	fprintf(stderr, "%s: %d blocks, %d instructions\n", argv[4], blocks, instructions);
+	return 0;
+}